@@ -0,0 +1,109 @@
+#include <memory>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "entity_conversion.hpp"
+#include "message_wrapper.hpp"
+#include "payloads.hpp"
+#include "state_conversion.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+TEST_CASE("MessageWrapper", "[!benchmark][conversion]")
+{
+    const auto light_state = std::make_shared<proto::LightStateResponse>(make_light_state());
+    const MessageWrapper wrapper{light_state};
+    const std::shared_ptr<google::protobuf::Message> message = light_state;
+
+    BENCHMARK("construct")
+    {
+        return MessageWrapper{light_state};
+    };
+    BENCHMARK("share")
+    {
+        return wrapper.share();
+    };
+    BENCHMARK("move")
+    {
+        auto shared = wrapper.share();
+        return MessageWrapper{std::move(shared)};
+    };
+    BENCHMARK("holds_message<T>, cached id")
+    {
+        return wrapper.holds_message<proto::LightStateResponse>();
+    };
+    BENCHMARK("id from the descriptor options, the previous holds_message<T>")
+    {
+        return proto::LightStateResponse::GetDescriptor()->options().GetExtension(proto::id) == wrapper.message_id();
+    };
+    BENCHMARK("get_if<T> matching")
+    {
+        return wrapper.get_if<proto::LightStateResponse>();
+    };
+    BENCHMARK("as<T> matching")
+    {
+        return wrapper.as<proto::LightStateResponse>();
+    };
+    BENCHMARK("dynamic_pointer_cast, the previous as<T>")
+    {
+        return std::dynamic_pointer_cast<proto::LightStateResponse>(message);
+    };
+    BENCHMARK("as<T> not matching")
+    {
+        return wrapper.as<proto::SensorStateResponse>();
+    };
+}
+
+// the work of ApiConnection::dispatch_message and the receive operations for a message with four waiting receivers.
+TEST_CASE("dispatching a message to four receivers", "[!benchmark][conversion]")
+{
+    constexpr std::size_t kReceivers = 4;
+    const auto light_state = std::make_shared<proto::LightStateResponse>(make_light_state());
+    const std::shared_ptr<google::protobuf::Message> message = light_state;
+    const auto light_state_id = proto::LightStateResponse::GetDescriptor()->options().GetExtension(proto::id);
+
+    BENCHMARK("shared to all but the last receiver, moved out by id")
+    {
+        MessageWrapper dispatched{light_state};
+        std::size_t received{};
+        for (std::size_t i = 0; i < kReceivers; i++)
+        {
+            auto result = i + 1 == kReceivers ? std::move(dispatched) : dispatched.share();
+            received += std::move(result).as<proto::LightStateResponse>() != nullptr ? 1 : 0;
+        }
+        return received;
+    };
+    BENCHMARK("copied to every receiver, descriptor lookup and dynamic_pointer_cast")
+    {
+        std::size_t received{};
+        for (std::size_t i = 0; i < kReceivers; i++)
+        {
+            auto result = message;
+            if (proto::LightStateResponse::GetDescriptor()->options().GetExtension(proto::id) == light_state_id)
+            {
+                received += std::dynamic_pointer_cast<proto::LightStateResponse>(result) != nullptr ? 1 : 0;
+            }
+        }
+        return received;
+    };
+}
+
+TEST_CASE("pb2entity_info and pb2state", "[!benchmark][conversion]")
+{
+    const auto light_entity = make_light_entity();
+    const auto sensor_entity = make_sensor_entity();
+    const auto light_state = make_light_state();
+
+    BENCHMARK("pb2entity_info light")
+    {
+        return pb2entity_info(light_entity);
+    };
+    BENCHMARK("pb2entity_info sensor")
+    {
+        return pb2entity_info(sensor_entity);
+    };
+    BENCHMARK("pb2state light")
+    {
+        return pb2state(light_state);
+    };
+}
@@ -0,0 +1,201 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <vector>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cppesphomeapi/api_client.hpp>
+#include "fake_device.hpp"
+#include "loopback.hpp"
+
+namespace asio = boost::asio;
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+using namespace std::chrono_literals;
+using namespace boost::asio::experimental::awaitable_operators;
+
+TEST_CASE("connect against a device with network latency", "[!benchmark][e2e]")
+{
+    for (const auto latency : {0ms, 5ms, 20ms})
+    {
+        Loopback loopback;
+        FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 8, .sensors = 16, .latency = latency}};
+
+        BENCHMARK(std::format("sequential connect, latency {}", latency))
+        {
+            bool ready{false};
+            loopback.run([&]() -> asio::awaitable<void> {
+                auto &client = loopback.add_client(device);
+                ready = (co_await client.async_connect()).has_value() and
+                        (co_await client.async_device_info()).has_value() and
+                        (co_await client.async_list_entities_services()).has_value() and
+                        (co_await client.subscribe_states()).has_value();
+                co_await client.async_disconnect();
+            }());
+            return ready;
+        };
+        BENCHMARK(std::format("pipelined connect, latency {}", latency))
+        {
+            bool ready{false};
+            loopback.run([&]() -> asio::awaitable<void> {
+                auto &client = loopback.add_client(device);
+                ready = (co_await client.async_connect_pipelined()).has_value();
+                co_await client.async_disconnect();
+            }());
+            return ready;
+        };
+    }
+}
+
+TEST_CASE("light command to state round trip", "[!benchmark][e2e]")
+{
+    Loopback loopback;
+    FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 1, .sensors = 0}};
+    auto &client = loopback.add_client(device);
+    bool connected{false};
+    loopback.run([&]() -> asio::awaitable<void> {
+        connected = (co_await client.async_connect_pipelined()).has_value();
+    }());
+    REQUIRE(connected);
+
+    std::size_t command{};
+    BENCHMARK("light command -> light state")
+    {
+        bool echoed{false};
+        loopback.run([&]() -> asio::awaitable<void> {
+            const auto effect = std::format("effect_{}", command++);
+            const auto deadline = Clock::now() + 1s;
+            // the receive is started first, states that arrive without a pending receive are not delivered.
+            const auto [received, sent] = co_await (receive_light_state(client, effect, deadline) &&
+                                                    client.async_light_command({.key = 0, .effect = effect}, deadline));
+            echoed = received and sent.has_value();
+        }());
+        return echoed;
+    };
+    loopback.run([&]() -> asio::awaitable<void> { co_await client.async_disconnect(); }());
+}
+
+TEST_CASE("state stream from connect to the last state", "[!benchmark][e2e]")
+{
+    constexpr std::size_t kStates = 5000;
+
+    // 0 writes every frame at once, 7 splits every frame and its header across several reads.
+    for (const std::size_t fragment_size : {std::size_t{0}, std::size_t{7}})
+    {
+        BENCHMARK(std::format("{} states, fragment size {}", kStates, fragment_size))
+        {
+            Loopback loopback;
+            FakeDevice device{
+                loopback.executor(),
+                FakeDeviceConfig{
+                    .lights = 4, .sensors = 2, .fragment_size = fragment_size, .streamed_states = kStates}};
+            auto &client = loopback.add_client(device);
+            std::size_t delivered{};
+            loopback.run([&]() -> asio::awaitable<void> {
+                const auto snapshot = co_await client.async_connect_pipelined();
+                if (not snapshot.has_value())
+                {
+                    co_return;
+                }
+                delivered = snapshot->initial_states.size();
+                while (delivered < kStates and
+                       (co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+                {
+                    delivered++;
+                }
+                co_await client.async_disconnect();
+            }());
+            return delivered;
+        };
+    }
+}
+
+TEST_CASE("replay of a captured state stream", "[!benchmark][e2e]")
+{
+    constexpr std::size_t kStates = 5000;
+    const auto capture_file = std::filesystem::temp_directory_path() / "cppesphomeapi_benchmark.capture";
+    {
+        Loopback loopback;
+        FakeDevice device{
+            loopback.executor(),
+            FakeDeviceConfig{.lights = 4, .sensors = 0, .fragment_size = 7, .streamed_states = kStates}};
+        auto &client = loopback.add_client(device);
+        REQUIRE(client.start_capture(capture_file).has_value());
+        loopback.run([&]() -> asio::awaitable<void> {
+            if (not(co_await client.async_connect_pipelined()).has_value())
+            {
+                co_return;
+            }
+            // the stream is complete once the device is silent.
+            while ((co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+            {
+            }
+            client.stop_capture();
+            co_await client.async_disconnect();
+        }());
+    }
+
+    Loopback loopback;
+    BENCHMARK(std::format("replay of {} states", kStates))
+    {
+        // a client replays a capture only while it is not connected, so every run takes a new one.
+        auto &client = loopback.add_client(0);
+        std::size_t delivered{};
+        loopback.run([&]() -> asio::awaitable<void> {
+            const auto replay = [&]() -> asio::awaitable<void> {
+                co_await client.async_replay(capture_file, ReplayPace::AsFastAsPossible);
+            };
+            const auto receive = [&]() -> asio::awaitable<void> {
+                while ((co_await client.async_receive_state(Clock::now() + 200ms)).has_value())
+                {
+                    delivered++;
+                }
+            };
+            co_await (replay() && receive());
+        }());
+        return delivered;
+    };
+    std::filesystem::remove(capture_file);
+}
+
+TEST_CASE("many clients on a shared multi threaded io_context", "[!benchmark][e2e]")
+{
+    constexpr std::size_t kClients = 32;
+    constexpr std::size_t kStatesPerClient = 500;
+    for (const std::size_t io_threads : {1U, 2U, 4U, 8U})
+    {
+        BENCHMARK(std::format("{} clients with {} states on {} io threads", kClients, kStatesPerClient, io_threads))
+        {
+            Loopback loopback{io_threads};
+            FakeDevice device{loopback.executor(),
+                              FakeDeviceConfig{.lights = 4, .sensors = 0, .streamed_states = kStatesPerClient}};
+            std::vector<ApiClient *> clients;
+            for (std::size_t i = 0; i < kClients; i++)
+            {
+                clients.emplace_back(&loopback.add_client(device));
+            }
+            std::vector<std::size_t> delivered(kClients);
+            loopback.run([&]() -> asio::awaitable<void> {
+                co_await run_concurrently(kClients, [&](std::size_t index) -> asio::awaitable<void> {
+                    auto &client = *clients[index];
+                    const auto snapshot = co_await client.async_connect_pipelined(Clock::now() + 5s);
+                    if (not snapshot.has_value())
+                    {
+                        co_return;
+                    }
+                    delivered[index] = snapshot->initial_states.size();
+                    while (delivered[index] < kStatesPerClient and
+                           (co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+                    {
+                        delivered[index]++;
+                    }
+                    co_await client.async_disconnect();
+                });
+            }());
+            return delivered;
+        };
+    }
+}
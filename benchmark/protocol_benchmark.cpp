@@ -0,0 +1,90 @@
+#include <numeric>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "entity_interest.hpp"
+#include "payloads.hpp"
+#include "plain_text_protocol.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+TEST_CASE("PlainTextProtocol::serialize", "[!benchmark][protocol]")
+{
+    const auto light_state = make_light_state();
+    const auto sensor_state = make_sensor_state();
+    const auto light_entity = make_light_entity();
+    const auto log = make_log();
+
+    BENCHMARK("light state")
+    {
+        return PlainTextProtocol::serialize(light_state);
+    };
+    BENCHMARK("sensor state")
+    {
+        return PlainTextProtocol::serialize(sensor_state);
+    };
+    BENCHMARK("light entity")
+    {
+        return PlainTextProtocol::serialize(light_entity);
+    };
+    BENCHMARK("log")
+    {
+        return PlainTextProtocol::serialize(log);
+    };
+
+    std::vector<std::byte> buffer;
+    BENCHMARK("light state into a reused buffer")
+    {
+        buffer.clear();
+        return PlainTextProtocol::serialize_to(light_state, buffer);
+    };
+}
+
+TEST_CASE("PlainTextProtocol::decode_multiple", "[!benchmark][protocol]")
+{
+    PlainTextProtocol protocol;
+    const auto light_state = frame_of(make_light_state());
+    const auto log = frame_of(make_log());
+    const auto states = state_frames(64);
+    const auto entities = entity_list_frames(20, 40);
+    std::size_t decoded{};
+    const auto count = [&decoded](MessageWrapper /*message*/) { decoded++; };
+
+    BENCHMARK("single light state frame")
+    {
+        return protocol.decode_multiple<proto::LightStateResponse>(light_state, count);
+    };
+    BENCHMARK("single log frame")
+    {
+        return protocol.decode_multiple<proto::SubscribeLogsResponse>(log, count);
+    };
+    BENCHMARK("64 state frames")
+    {
+        return protocol.decode_multiple<proto::LightStateResponse, proto::SensorStateResponse>(states, count);
+    };
+    BENCHMARK("entity list with 60 entities")
+    {
+        return protocol.decode_multiple<proto::ListEntitiesDoneResponse,
+                                        proto::ListEntitiesLightResponse,
+                                        proto::ListEntitiesSensorResponse>(entities, count);
+    };
+}
+
+TEST_CASE("EntityInterest", "[!benchmark][protocol]")
+{
+    const auto light_state = frame_of(make_light_state());
+    const auto frame = single_frame(light_state);
+    EntityInterest interest;
+    std::vector<std::uint32_t> keys(64);
+    std::iota(keys.begin(), keys.end(), 0U);
+    interest.set(keys);
+
+    BENCHMARK("accepts, 64 keys of interest")
+    {
+        return interest.accepts(frame);
+    };
+    BENCHMARK("decode of the same frame")
+    {
+        return PlainTextProtocol::decode<proto::LightStateResponse>(frame, [](MessageWrapper /*message*/) {});
+    };
+}
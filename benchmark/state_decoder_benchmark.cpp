@@ -0,0 +1,59 @@
+#include <utility>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "payloads.hpp"
+#include "state_conversion.hpp"
+#include "state_decoder.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+TEST_CASE("state decoding", "[!benchmark][protocol]")
+{
+    const auto light_payload = payload_of(make_light_state());
+    const auto sensor_payload = payload_of(make_sensor_state());
+
+    BENCHMARK("light state: protobuf message and pb2state")
+    {
+        proto::LightStateResponse message;
+        message.ParseFromArray(light_payload.data(), static_cast<int>(light_payload.size()));
+        return pb2state(message);
+    };
+    BENCHMARK("light state: wire decoder")
+    {
+        return decode_light_state(light_payload);
+    };
+    BENCHMARK("sensor state: protobuf message and pb2state")
+    {
+        proto::SensorStateResponse message;
+        message.ParseFromArray(sensor_payload.data(), static_cast<int>(sensor_payload.size()));
+        return pb2state(message);
+    };
+    BENCHMARK("sensor state: wire decoder")
+    {
+        return decode_sensor_state(sensor_payload);
+    };
+}
+
+TEST_CASE("log decoding", "[!benchmark][protocol]")
+{
+    const auto log_payload = payload_of(make_log());
+    const Frame frame{.message_type = detail::get_message_id<proto::SubscribeLogsResponse>(), .payload = log_payload};
+    const auto frame_pool = ReceivedFramePool::create();
+
+    BENCHMARK("protobuf message and LogEntry copy")
+    {
+        proto::SubscribeLogsResponse message;
+        message.ParseFromArray(log_payload.data(), static_cast<int>(log_payload.size()));
+        return LogEntry{.log_level = EspHomeLogLevel{std::to_underlying(message.level())},
+                        .message = message.message()};
+    };
+    BENCHMARK("view into the pinned frame")
+    {
+        return decode_view(frame, *frame_pool);
+    };
+    BENCHMARK("view into the pinned frame and owning copy")
+    {
+        return std::get<LogEntryView>(decode_view(frame, *frame_pool).value()).to_owned();
+    };
+}
@@ -1,8 +1,11 @@
 macro(declare_dependencies)
     set(CMAKE_THREAD_PREFER_PTHREAD TRUE)
     set(THREADS_PREFER_PTHREAD_FLAG TRUE)
-    set(BUILD_TESTING ${project_build_testing})
-    if(BUILD_TESTING)
+    # a project that adds this one as a subproject does not build its tests.
+    if(NOT PROJECT_IS_TOP_LEVEL)
+        set(BUILD_TESTING OFF)
+    endif()
+    if(BUILD_TESTING OR CPPESPHOMEAPI_BUILD_BENCHMARKS)
         set(CATCH_INSTALL_DOCS OFF)
         FetchContent_Declare(
             Catch2
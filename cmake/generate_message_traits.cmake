@@ -0,0 +1,104 @@
+# Generates the constexpr MessageTraits of every message of api.proto that has an id, and the list of those messages.
+# cmake -DPROTO_FILE=<api.proto> -DOUTPUT_FILE=<message_traits.hpp> -P generate_message_traits.cmake
+
+file(READ "${PROTO_FILE}" proto_content)
+# semicolons and brackets would split the lines as cmake list elements.
+string(REPLACE ";" "" proto_content "${proto_content}")
+string(REPLACE "[" "" proto_content "${proto_content}")
+string(REPLACE "]" "" proto_content "${proto_content}")
+string(REPLACE "\n" ";" proto_lines "${proto_content}")
+
+set(traits "")
+set(message_name "")
+set(entity_key_message_ids "")
+set(message_types "")
+
+macro(append_message_traits)
+    if(NOT message_name STREQUAL "" AND NOT message_id STREQUAL "")
+        # a message guarded by an ifdef follows the CPPESPHOMEAPI_<ifdef> option of features.hpp.
+        if(message_ifdef STREQUAL "")
+            set(message_enabled "true")
+        else()
+            set(message_enabled "CPPESPHOMEAPI_${message_ifdef}")
+        endif()
+        string(APPEND traits
+            "template <>\n"
+            "struct MessageTraits<proto::${message_name}>\n"
+            "{\n"
+            "    static constexpr std::uint32_t id = ${message_id};\n"
+            "    static constexpr MessageSource source = MessageSource::${message_source};\n"
+            "    static constexpr bool no_delay = ${message_no_delay};\n"
+            "    static constexpr std::string_view ifdef = \"${message_ifdef}\";\n"
+            "    static constexpr bool has_entity_key = ${message_has_entity_key};\n"
+            "    static constexpr bool enabled = ${message_enabled};\n"
+            "};\n\n"
+        )
+        list(APPEND message_types "proto::${message_name}")
+        if(message_has_entity_key AND NOT message_source STREQUAL "Client")
+            list(APPEND entity_key_message_ids "${message_id}")
+        endif()
+    endif()
+    set(message_name "")
+endmacro()
+
+foreach(line IN LISTS proto_lines)
+    if(line MATCHES "^message ([A-Za-z0-9_]+)")
+        append_message_traits()
+        set(message_name "${CMAKE_MATCH_1}")
+        set(message_id "")
+        set(message_source "Both")
+        set(message_no_delay "false")
+        set(message_ifdef "")
+        set(message_has_entity_key "false")
+    elseif(message_name STREQUAL "")
+        continue()
+    elseif(line MATCHES "^  option \\(id\\) = ([0-9]+)")
+        set(message_id "${CMAKE_MATCH_1}")
+    elseif(line MATCHES "^  option \\(source\\) = SOURCE_SERVER")
+        set(message_source "Server")
+    elseif(line MATCHES "^  option \\(source\\) = SOURCE_CLIENT")
+        set(message_source "Client")
+    elseif(line MATCHES "^  option \\(no_delay\\) = (true|false)")
+        set(message_no_delay "${CMAKE_MATCH_1}")
+    elseif(line MATCHES "^  option \\(ifdef\\) = \"([A-Za-z0-9_]+)\"")
+        set(message_ifdef "${CMAKE_MATCH_1}")
+    elseif(line MATCHES "^  fixed32 key = 1$")
+        set(message_has_entity_key "true")
+    elseif(line MATCHES "^}")
+        append_message_traits()
+    endif()
+endforeach()
+append_message_traits()
+list(LENGTH entity_key_message_ids entity_key_message_count)
+list(JOIN entity_key_message_ids ", " entity_key_message_ids)
+list(JOIN message_types ",\n                                      " message_types)
+
+file(CONFIGURE OUTPUT "${OUTPUT_FILE}" CONTENT [=[
+// Generated from api.proto by cmake/generate_message_traits.cmake. Do not edit.
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <cppesphomeapi/features.hpp>
+#include "api.pb.h"
+
+namespace cppesphomeapi::detail
+{
+enum class MessageSource
+{
+    Both,
+    Server,
+    Client,
+};
+
+// the options of a message of api.proto. Only messages with an id are specialized.
+template <typename TMsg>
+struct MessageTraits;
+
+@traits@// the messages sent by the device about a single entity, which start with its key as field 1, e.g. the states.
+inline constexpr std::array<std::uint32_t, @entity_key_message_count@> kEntityKeyMessageIds{@entity_key_message_ids@};
+// every message with MessageTraits, in the order of api.proto.
+using MessagesWithTraits = std::tuple<@message_types@>;
+} // namespace cppesphomeapi::detail
+]=] @ONLY)
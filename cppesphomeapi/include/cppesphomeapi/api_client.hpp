@@ -1,27 +1,56 @@
 #ifndef CPPESPHOMEAPI_API_CLIENT_HPP
 #define CPPESPHOMEAPI_API_CLIENT_HPP
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <stop_token>
 #include <string>
+#include <vector>
 #include <cppesphomeapi/cppesphomeapi_export.hpp>
 #include "api_version.hpp"
 #include "async_result.hpp"
+#include "camera.hpp"
+#include "command_submission.hpp"
 #include "commands.hpp"
+#include "connection_metrics.hpp"
+#include "deadline.hpp"
 #include "cppesphomeapi/log_entry.hpp"
 #include "device_info.hpp"
 #include "entity.hpp"
+#include "message_tracing.hpp"
+#include "send_metrics.hpp"
 #include "state.hpp"
+#include "string_views.hpp"
+#include "traffic_capture.hpp"
+#include "user_service.hpp"
+#include "voice_assistant.hpp"
 
 namespace cppesphomeapi
 {
 class ApiConnection;
 
-using EntityInfoVariant = std::variant<EntityInfo, LightEntityInfo>;
+using EntityInfoVariant = std::variant<EntityInfo, LightEntityInfo, UserService>;
 using EntityInfoList = std::vector<EntityInfoVariant>;
 
-using EntityStateVariant = std::variant<LightState>;
+struct DeviceSnapshot
+{
+    DeviceInfo device_info;
+    EntityInfoList entities;
+    // states received until the entity list was complete. Later states are delivered through async_receive_state().
+    std::vector<EntityStateVariant> initial_states;
+};
 
+/**
+ * The client may be used from coroutines on any thread of a shared, multi threaded io_context.
+ * The connection state lives on its own strand: every async operation is spawned onto it and completes on the executor
+ * of the awaiting coroutine. device_name(), api_version(), pending_receive_handlers(), submit_command(), the metrics
+ * and close() are safe to call from any thread.
+ * A stop requested on the stop source passed to the constructor closes the client. Many clients may share it.
+ * Every async operation accepts an optional deadline. Once it passed, the operation including all of its nested
+ * requests is cancelled and completes with ApiErrorCode::DeadlineExceeded. Without a deadline each request is bound by
+ * an adaptive timeout derived from the measured round trip times of the connection. Receiving unsolicited messages,
+ * like logs and states, waits for the next one until the deadline passes.
+ */
 class CPPESPHOMEAPI_EXPORT ApiClient
 {
   public:
@@ -33,17 +62,87 @@ class CPPESPHOMEAPI_EXPORT ApiClient
     ~ApiClient();
 
     [[nodiscard]] std::optional<ApiVersion> api_version() const;
-    [[nodiscard]] const std::string &device_name() const;
-    AsyncResult<void> async_connect();
-    AsyncResult<void> async_disconnect();
-    AsyncResult<DeviceInfo> async_device_info();
-    AsyncResult<EntityInfoList> async_list_entities_services();
-    AsyncResult<void> async_light_command(LightCommand light_command);
-    AsyncResult<LogEntry> async_receive_log();
-    AsyncResult<EntityStateVariant> async_receive_state();
-    AsyncResult<void> subscribe_logs(EspHomeLogLevel log_level, bool config_dump);
-    AsyncResult<void> subscribe_states();
+    [[nodiscard]] std::string device_name() const;
+    // number of receive operations that currently wait for a message. Abandoned operations are removed immediately.
+    [[nodiscard]] std::size_t pending_receive_handlers() const;
+    AsyncResult<void> async_connect(OptionalDeadline deadline = std::nullopt);
+    // connects and writes hello, connect, device info, list entities and subscribe states requests in one burst.
+    // The responses are matched afterwards, so the device is usable after about one round trip.
+    AsyncResult<DeviceSnapshot> async_connect_pipelined(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_disconnect(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<DeviceInfo> async_device_info(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<EntityInfoList> async_list_entities_services(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_light_command(LightCommand light_command, OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_execute_service(ServiceCall call, OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_execute_services(std::vector<ServiceCall> calls, OptionalDeadline deadline = std::nullopt);
+    AsyncResult<LogEntry> async_receive_log(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<EntityStateVariant> async_receive_state(OptionalDeadline deadline = std::nullopt);
+    // like async_receive_log and the text sensor states of async_receive_state, but the strings are views into the
+    // received frame instead of copies, see string_views.hpp.
+    AsyncResult<LogEntryView> async_receive_log_view(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<TextSensorStateView> async_receive_text_sensor_state_view(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> subscribe_logs(EspHomeLogLevel log_level,
+                                     bool config_dump,
+                                     OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> subscribe_states(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> subscribe_voice_assistant(VoiceAssistantConfig config = {},
+                                                OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> unsubscribe_voice_assistant(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<VoiceAssistantRequest> async_receive_voice_assistant_request(OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_send_voice_assistant_response(bool error = false, OptionalDeadline deadline = std::nullopt);
+    AsyncResult<void> async_send_voice_assistant_event(VoiceAssistantEvent event,
+                                                       std::vector<VoiceAssistantEventData> data = {},
+                                                       OptionalDeadline deadline = std::nullopt);
+    AsyncResult<AudioBlock> async_receive_voice_audio(OptionalDeadline deadline = std::nullopt);
+    // queues the pcm for the paced playback, all of it or nothing. A pcm larger than
+    // VoiceAssistantConfig::max_playback_chunk() fails with InvalidArgument, a full jitter buffer with SendError.
+    AsyncResult<void> async_send_voice_audio(std::span<const std::byte> pcm,
+                                             bool end = false,
+                                             OptionalDeadline deadline = std::nullopt);
+    // asks for a single image, or a stream of images until the device stops it. Sent in the bulk class, so commands
+    // and requests are not queued behind it.
+    AsyncResult<void> async_request_camera_image(bool stream = false, OptionalDeadline deadline = std::nullopt);
+    // receives the chunks of the next camera image until it is complete.
+    AsyncResult<CameraImage> async_receive_camera_image(OptionalDeadline deadline = std::nullopt);
+    // enqueues the command without blocking or allocating a coroutine. Safe to call from any thread, e.g. an ui thread
+    // outside of the io_context. Returns false if the submission queue is full, the callback is not invoked then.
+    // A command of a disabled domain, e.g. a light command without CPPESPHOMEAPI_USE_LIGHT, fails with FeatureDisabled.
+    bool submit_command(SubmittedCommand command, CommandCallback callback = {});
+    // queue depth and wait time per outgoing priority class. Safe to call from any thread.
+    [[nodiscard]] SendMetrics send_metrics() const;
+    // traffic, errors, queue depths and latencies of the connection. Lock free, safe to call from any thread.
+    [[nodiscard]] ConnectionMetrics metrics() const;
+    // records the latency of every received message per type and samples messages for chrome_trace(). Safe to call
+    // from any thread, calling it again starts over with an empty tracer.
+    void enable_message_tracing(TraceOptions options = {});
+    // per message type: decode, dispatch and consume latency. Empty if tracing is not enabled. Safe to call from any
+    // thread.
+    [[nodiscard]] std::vector<MessageLatencies> message_latencies() const;
+    // the sampled messages as Chrome trace event JSON, viewable in chrome://tracing or Perfetto. Safe to call from any
+    // thread.
+    [[nodiscard]] std::string chrome_trace() const;
+    // records every byte received from now on with its time into the file. Safe to call from any thread.
+    Result<void> start_capture(const std::filesystem::path &capture_file);
+    void stop_capture();
+    // only the states and other messages of the entities with the keys are decoded and delivered, the frames of all
+    // other entities are dropped without decoding them. Safe to call from any thread, applies to the frames received
+    // afterwards.
+    void set_entity_interest(std::vector<std::uint32_t> keys);
+    // delivers the messages of every entity again.
+    void clear_entity_interest();
+    // feeds a capture through the decoding and dispatching of this client instead of a device. The client must not be
+    // connected. The messages are delivered to the receive operations like received ones, e.g. async_receive_state().
+    AsyncResult<void> async_replay(std::filesystem::path capture_file,
+                                   ReplayPace pace = ReplayPace::AsFastAsPossible,
+                                   OptionalDeadline deadline = std::nullopt);
+    // stops this client only, other clients created with the same stop source keep running.
     void close();
+    // closes the client and completes once its background loops finished. A connected client must be closed this way
+    // before it is destroyed.
+    AsyncResult<void> async_close();
+    // decode received messages on a strand of the given executor, e.g. a boost::asio::thread_pool, instead of the
+    // connection strand. Must be called before async_connect.
+    void set_decode_executor(const boost::asio::any_io_executor &executor);
 
     ApiClient(const ApiClient &) = delete;
     ApiClient(ApiClient &&) = delete;
@@ -0,0 +1,16 @@
+#ifndef CPPESPHOMEAPI_CAMERA_HPP
+#define CPPESPHOMEAPI_CAMERA_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cppesphomeapi
+{
+// an image of an ESP32 camera, assembled from the chunks the device streams it in.
+struct CameraImage
+{
+    std::uint32_t key{};
+    std::vector<std::byte> data;
+};
+} // namespace cppesphomeapi
+#endif
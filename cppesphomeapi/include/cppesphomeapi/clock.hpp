@@ -0,0 +1,17 @@
+#ifndef CPPESPHOMEAPI_CLOCK_HPP
+#define CPPESPHOMEAPI_CLOCK_HPP
+#include <chrono>
+
+#ifdef CPPESPHOMEAPI_CLOCK_HEADER
+// a test build of the library brings its own clock, see tests/virtual_clock.hpp.
+#include CPPESPHOMEAPI_CLOCK_HEADER
+#else
+namespace cppesphomeapi
+{
+/**
+ * The clock of every timer, timeout and deadline of the library. Deadlines must be computed from Clock::now().
+ */
+using Clock = std::chrono::steady_clock;
+} // namespace cppesphomeapi
+#endif
+#endif
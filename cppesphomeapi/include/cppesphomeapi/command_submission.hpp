@@ -0,0 +1,15 @@
+#ifndef CPPESPHOMEAPI_COMMAND_SUBMISSION_HPP
+#define CPPESPHOMEAPI_COMMAND_SUBMISSION_HPP
+#include <functional>
+#include <variant>
+#include "commands.hpp"
+#include "result.hpp"
+#include "user_service.hpp"
+
+namespace cppesphomeapi
+{
+using SubmittedCommand = std::variant<LightCommand, ServiceCall>;
+// invoked on the connection strand once the command was written or failed. Must not block.
+using CommandCallback = std::move_only_function<void(Result<void>)>;
+} // namespace cppesphomeapi
+#endif
@@ -0,0 +1,75 @@
+#ifndef CPPESPHOMEAPI_CONNECTION_METRICS_HPP
+#define CPPESPHOMEAPI_CONNECTION_METRICS_HPP
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cppesphomeapi/cppesphomeapi_export.hpp>
+
+namespace cppesphomeapi
+{
+/**
+ * Durations in power of two buckets. Bucket i counts the samples below upper_bound(i), the last bucket also counts
+ * every longer sample.
+ */
+struct CPPESPHOMEAPI_EXPORT LatencyHistogram
+{
+    static constexpr std::size_t kBucketCount = 18;
+    static constexpr std::chrono::microseconds kFirstUpperBound{64};
+
+    std::array<std::uint64_t, kBucketCount> buckets{};
+    std::uint64_t count{};
+    std::chrono::nanoseconds sum{};
+    std::chrono::nanoseconds max{};
+
+    [[nodiscard]] static constexpr std::chrono::microseconds upper_bound(std::size_t bucket)
+    {
+        return kFirstUpperBound * (std::int64_t{1} << bucket);
+    }
+    [[nodiscard]] static std::size_t bucket_of(std::chrono::nanoseconds duration);
+    // the upper bound of the bucket that contains the percentile, e.g. 0.99. Zero without samples.
+    [[nodiscard]] std::chrono::microseconds percentile(double fraction) const;
+    [[nodiscard]] std::chrono::nanoseconds mean() const;
+
+    LatencyHistogram &operator+=(const LatencyHistogram &rhs);
+};
+
+// the message ids of api.proto are below this bound.
+inline constexpr std::size_t kMessageTypeCount = 128;
+
+/**
+ * A snapshot of the counters of a connection. Snapshots of several connections are aggregated with operator+=.
+ */
+struct CPPESPHOMEAPI_EXPORT ConnectionMetrics
+{
+    std::uint64_t bytes_received{};
+    std::uint64_t bytes_sent{};
+    std::uint64_t frames_received{};
+    std::uint64_t frames_sent{};
+    // indexed by the message id of the frame.
+    std::array<std::uint64_t, kMessageTypeCount> messages_received{};
+    std::array<std::uint64_t, kMessageTypeCount> messages_sent{};
+    // frames of an accepted message type that could not be parsed and broken frame headers.
+    std::uint64_t decode_errors{};
+    // frames of message types the client does not handle.
+    std::uint64_t skipped_messages{};
+    // frames of entities outside of the interest set, dropped before decoding.
+    std::uint64_t filtered_messages{};
+    // messages dispatched while no receive operation was waiting, they are dropped.
+    std::uint64_t unclaimed_messages{};
+    // every connect after the first one of a connection is a reconnect.
+    std::uint64_t connects{};
+    std::uint64_t reconnects{};
+
+    std::size_t pending_receive_handlers{};
+    std::size_t send_queue_depth{};
+
+    // request/response round trips, including the tcp handshake.
+    LatencyHistogram round_trip_time;
+    // time from reading a frame until its message was handed to the waiting receivers.
+    LatencyHistogram dispatch_latency;
+
+    ConnectionMetrics &operator+=(const ConnectionMetrics &rhs);
+};
+} // namespace cppesphomeapi
+#endif
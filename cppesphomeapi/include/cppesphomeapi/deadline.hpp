@@ -0,0 +1,13 @@
+#ifndef CPPESPHOMEAPI_DEADLINE_HPP
+#define CPPESPHOMEAPI_DEADLINE_HPP
+#include <optional>
+#include "clock.hpp"
+
+namespace cppesphomeapi
+{
+// the point in time at which an operation and all of its nested steps are aborted.
+using Deadline = Clock::time_point;
+using OptionalDeadline = std::optional<Deadline>;
+} // namespace cppesphomeapi
+
+#endif
@@ -46,7 +46,31 @@ struct LightEntityInfo : public EntityInfo
     std::vector<std::string> effects;
 };
 
+enum class ServiceArgType
+{
+    Bool,
+    Int,
+    Float,
+    String,
+    BoolArray,
+    IntArray,
+    FloatArray,
+    StringArray,
+    // a type of a newer api version. A service with such an argument can not be called.
+    Unknown,
+};
+
+struct UserServiceArg
+{
+    std::string name;
+    ServiceArgType type{};
+};
+
 struct UserService
-{};
+{
+    std::string name;
+    std::uint32_t key{};
+    std::vector<UserServiceArg> args;
+};
 } // namespace cppesphomeapi
 #endif
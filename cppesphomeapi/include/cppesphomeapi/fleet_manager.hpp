@@ -0,0 +1,109 @@
+#ifndef CPPESPHOMEAPI_FLEET_MANAGER_HPP
+#define CPPESPHOMEAPI_FLEET_MANAGER_HPP
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/strand.hpp>
+#include <cppesphomeapi/cppesphomeapi_export.hpp>
+#include "api_client.hpp"
+#include "connection_metrics.hpp"
+#include "detail/awaitable.hpp"
+#include "result.hpp"
+
+namespace cppesphomeapi
+{
+struct FleetDevice
+{
+    std::string hostname;
+    std::uint16_t port{6053};
+    std::string password;
+};
+
+struct FleetOptions
+{
+    // number of devices that are bootstrapped at the same time.
+    std::size_t max_concurrent{16};
+    // minimum distance between two admitted devices, so the resolver and the network are not hit by a burst.
+    std::chrono::milliseconds admission_interval{10};
+    // the time a single device may take from admission until it is ready.
+    std::chrono::milliseconds device_timeout{std::chrono::seconds{10}};
+    // use ApiClient::async_connect_pipelined instead of the sequential requests.
+    bool pipelined{true};
+};
+
+/**
+ * The readiness timeline of a single device. All points in time are relative to the start of the bootstrap and are
+ * only set if the device reached the stage.
+ */
+struct DeviceReadiness
+{
+    using Duration = std::chrono::steady_clock::duration;
+
+    std::size_t index{};
+    std::optional<Duration> admitted;
+    std::optional<Duration> connected;
+    std::optional<Duration> ready;
+    std::optional<ApiError> error;
+    DeviceSnapshot snapshot;
+};
+
+struct FleetReport
+{
+    std::vector<DeviceReadiness> devices;
+    std::size_t ready_count{};
+    // time until the last device became ready or failed.
+    std::chrono::steady_clock::duration time_to_all_ready{};
+};
+
+/**
+ * Connects many devices with a bounded number of concurrent handshakes. Devices are admitted in the given order, at
+ * most one per admission_interval. A ready device is connected, its device info and entities are known and its states
+ * are subscribed.
+ */
+class CPPESPHOMEAPI_EXPORT FleetManager
+{
+  public:
+    explicit FleetManager(const boost::asio::any_io_executor &executor,
+                          std::stop_source &stop_source,
+                          FleetOptions options = {});
+    ~FleetManager();
+
+    // closes the clients of a previous bootstrap first. precondition: not called concurrently
+    awaitable<FleetReport> async_bootstrap(std::vector<FleetDevice> devices);
+    // closes every client and waits until their loops finished. Must be awaited before the manager is destroyed.
+    awaitable<void> async_close();
+
+    [[nodiscard]] std::size_t size() const;
+    // the client of the device at the index of the last bootstrap.
+    [[nodiscard]] ApiClient &client(std::size_t index);
+    // the sum of the metrics of all clients. Safe to call from any thread, also while a bootstrap replaces the clients.
+    [[nodiscard]] ConnectionMetrics metrics() const;
+
+    FleetManager(const FleetManager &) = delete;
+    FleetManager(FleetManager &&) = delete;
+    FleetManager &operator=(const FleetManager &) = delete;
+    FleetManager &operator=(FleetManager &&) = delete;
+
+  private:
+    awaitable<void> admission_worker(std::chrono::steady_clock::time_point started, FleetReport &report);
+    awaitable<void> bootstrap_device(std::chrono::steady_clock::time_point started, DeviceReadiness &readiness);
+
+  private:
+    boost::asio::any_io_executor executor_;
+    // the workers and the bookkeeping of a bootstrap are confined to this strand.
+    boost::asio::strand<boost::asio::any_io_executor> strand_;
+    std::stop_source &stop_source_;
+    FleetOptions options_;
+    // replaced on the strand, guarded for size(), client() and metrics() from other threads.
+    mutable std::mutex clients_mutex_;
+    std::vector<std::unique_ptr<ApiClient>> clients_;
+    std::size_t next_device_{};
+};
+} // namespace cppesphomeapi
+#endif
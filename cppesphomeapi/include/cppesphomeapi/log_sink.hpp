@@ -0,0 +1,51 @@
+#ifndef CPPESPHOMEAPI_LOG_SINK_HPP
+#define CPPESPHOMEAPI_LOG_SINK_HPP
+#include <cstdint>
+#include <string_view>
+#include <cppesphomeapi/cppesphomeapi_export.hpp>
+
+namespace cppesphomeapi
+{
+// the levels of the library's own diagnostics. The logs of a device are EspHomeLogLevel.
+enum class LogLevel : std::uint8_t
+{
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+/**
+ * Receives the diagnostics of all clients. write() is called concurrently from every thread that runs a connection.
+ * A record is only formatted if its level is at least level() and it was not compiled out with
+ * CPPESPHOMEAPI_LOG_LEVEL.
+ */
+class CPPESPHOMEAPI_EXPORT LogSink
+{
+  public:
+    virtual ~LogSink() = default;
+
+    [[nodiscard]] virtual LogLevel level() const = 0;
+    virtual void write(LogLevel level, std::string_view message) = 0;
+};
+
+// writes every record with its level as a line to stdout.
+class CPPESPHOMEAPI_EXPORT ConsoleLogSink : public LogSink
+{
+  public:
+    explicit ConsoleLogSink(LogLevel level = LogLevel::Info);
+
+    [[nodiscard]] LogLevel level() const override;
+    void write(LogLevel level, std::string_view message) override;
+
+  private:
+    LogLevel level_;
+};
+
+// installs the sink, nullptr disables the diagnostics. Nothing is logged until a sink was installed.
+// The level of the sink is read once here. The sink must outlive every connection that may still log.
+CPPESPHOMEAPI_EXPORT void set_log_sink(LogSink *sink);
+} // namespace cppesphomeapi
+#endif
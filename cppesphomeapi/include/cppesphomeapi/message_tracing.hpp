@@ -0,0 +1,32 @@
+#ifndef CPPESPHOMEAPI_MESSAGE_TRACING_HPP
+#define CPPESPHOMEAPI_MESSAGE_TRACING_HPP
+#include <cstddef>
+#include <cstdint>
+#include "connection_metrics.hpp"
+
+namespace cppesphomeapi
+{
+struct TraceOptions
+{
+    // every sample_interval-th received message is kept for the trace export, 0 keeps none.
+    std::size_t sample_interval{100};
+    // the oldest sampled messages are dropped beyond this count.
+    std::size_t max_sampled_messages{4096};
+};
+
+/**
+ * The latencies of the received messages of one type, split at the stages of the receive pipeline:
+ * read from the socket -> decoded -> dispatched to the waiting receive operations -> consumed, i.e. returned by a
+ * receive operation of the client. A message that is returned by several receive operations is consumed several times.
+ */
+struct MessageLatencies
+{
+    std::uint32_t message_type{};
+    LatencyHistogram decode;
+    LatencyHistogram dispatch;
+    LatencyHistogram consume;
+    // from the read until it was consumed.
+    LatencyHistogram total;
+};
+} // namespace cppesphomeapi
+#endif
@@ -12,7 +12,15 @@ enum ApiErrorCode
     ParseError,
     UnexpectedMessage,
     SendError,
-    AuthentificationError
+    AuthentificationError,
+    NotSubscribed,
+    InvalidArgument,
+    DeadlineExceeded,
+    IoError,
+    // the message belongs to an ifdef domain of api.proto disabled by its CPPESPHOMEAPI_USE_* cmake option.
+    FeatureDisabled,
+    // the device did not answer a request within the timeout derived from the measured round trip time.
+    ResponseTimeout
 };
 
 struct ApiError
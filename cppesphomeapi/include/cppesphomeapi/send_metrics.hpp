@@ -0,0 +1,33 @@
+#ifndef CPPESPHOMEAPI_SEND_METRICS_HPP
+#define CPPESPHOMEAPI_SEND_METRICS_HPP
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace cppesphomeapi
+{
+// outgoing packets of a higher class are always written before queued packets of a lower class.
+enum class SendPriority : std::uint8_t
+{
+    Control,
+    Interactive,
+    Bulk
+};
+inline constexpr std::size_t kSendPriorityCount = 3;
+
+struct SendLaneMetrics
+{
+    std::size_t queue_depth{};
+    std::size_t max_queue_depth{};
+    std::uint64_t packets{};
+    std::uint64_t bytes{};
+    // time between enqueueing a packet and the start of its write.
+    std::chrono::nanoseconds total_wait{};
+    std::chrono::nanoseconds max_wait{};
+};
+
+// indexed by SendPriority
+using SendMetrics = std::array<SendLaneMetrics, kSendPriorityCount>;
+} // namespace cppesphomeapi
+#endif
@@ -1,6 +1,9 @@
 #ifndef CPPESPHOMEAPI_STATE_HPP
 #define CPPESPHOMEAPI_STATE_HPP
 #include <cstdint>
+#include <string>
+#include <variant>
+#include <cppesphomeapi/features.hpp>
 #include "entity.hpp"
 
 namespace cppesphomeapi
@@ -23,7 +26,76 @@ struct LightState : EntityState
     float color_temperature{};
     float cold_white{};
     float warm_white{};
+    // owning, unlike the log views: states outlive their frame, e.g. in the initial states of a snapshot. Short effect
+    // names fit into the small string buffer.
     std::string effect;
 };
+
+struct SensorState : EntityState
+{
+    float state{};
+    // the sensor has no valid state yet.
+    bool missing_state{};
+};
+
+struct BinarySensorState : EntityState
+{
+    bool state{};
+    // the binary sensor has no valid state yet.
+    bool missing_state{};
+};
+
+struct SwitchState : EntityState
+{
+    bool state{};
+};
+
+struct TextSensorState : EntityState
+{
+    std::string state;
+    // the text sensor has no valid state yet.
+    bool missing_state{};
+};
+
+namespace detail
+{
+template <bool Enabled, typename TState>
+struct Feature
+{};
+
+// collects the states of the enabled features into the variant. Without any, the variant holds std::monostate.
+template <typename TVariant, typename... TFeatures>
+struct FilterVariant;
+
+template <typename... TStates>
+struct FilterVariant<std::variant<TStates...>>
+{
+    using type = std::variant<TStates...>;
+};
+
+template <>
+struct FilterVariant<std::variant<>>
+{
+    using type = std::variant<std::monostate>;
+};
+
+template <typename... TStates, typename TState, typename... TFeatures>
+struct FilterVariant<std::variant<TStates...>, Feature<true, TState>, TFeatures...>
+    : FilterVariant<std::variant<TStates..., TState>, TFeatures...>
+{};
+
+template <typename... TStates, typename TState, typename... TFeatures>
+struct FilterVariant<std::variant<TStates...>, Feature<false, TState>, TFeatures...>
+    : FilterVariant<std::variant<TStates...>, TFeatures...>
+{};
+} // namespace detail
+
+// the states of the domains enabled by the CPPESPHOMEAPI_USE_* cmake options.
+using EntityStateVariant = detail::FilterVariant<std::variant<>,
+                                                 detail::Feature<CPPESPHOMEAPI_USE_LIGHT, LightState>,
+                                                 detail::Feature<CPPESPHOMEAPI_USE_SENSOR, SensorState>,
+                                                 detail::Feature<CPPESPHOMEAPI_USE_BINARY_SENSOR, BinarySensorState>,
+                                                 detail::Feature<CPPESPHOMEAPI_USE_SWITCH, SwitchState>,
+                                                 detail::Feature<CPPESPHOMEAPI_USE_TEXT_SENSOR, TextSensorState>>::type;
 } // namespace cppesphomeapi
 #endif
@@ -0,0 +1,42 @@
+#ifndef CPPESPHOMEAPI_STRING_VIEWS_HPP
+#define CPPESPHOMEAPI_STRING_VIEWS_HPP
+#include <memory>
+#include <string>
+#include <string_view>
+#include "log_entry.hpp"
+#include "state.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * Received messages with their strings as views into the received frame instead of copies. The frame is reference
+ * counted and lives as long as any view of it. Copies of a view share the frame. to_owned() copies the strings.
+ */
+struct LogEntryView
+{
+    EspHomeLogLevel log_level{};
+    std::string_view message;
+    bool send_failed{};
+    // keeps message valid.
+    std::shared_ptr<const void> frame;
+
+    [[nodiscard]] LogEntry to_owned() const
+    {
+        return LogEntry{.log_level = log_level, .message = std::string{message}};
+    }
+};
+
+struct TextSensorStateView : EntityState
+{
+    std::string_view state;
+    bool missing_state{};
+    // keeps state valid.
+    std::shared_ptr<const void> frame;
+
+    [[nodiscard]] TextSensorState to_owned() const
+    {
+        return TextSensorState{{key}, std::string{state}, missing_state};
+    }
+};
+} // namespace cppesphomeapi
+#endif
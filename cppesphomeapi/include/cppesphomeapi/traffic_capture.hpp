@@ -0,0 +1,16 @@
+#ifndef CPPESPHOMEAPI_TRAFFIC_CAPTURE_HPP
+#define CPPESPHOMEAPI_TRAFFIC_CAPTURE_HPP
+#include <cstdint>
+
+namespace cppesphomeapi
+{
+// the speed with which ApiClient::async_replay feeds a capture file through the receive pipeline.
+enum class ReplayPace : std::uint8_t
+{
+    // the records are processed with the time between them at capture time.
+    Original,
+    // the records are processed back to back.
+    AsFastAsPossible
+};
+} // namespace cppesphomeapi
+#endif
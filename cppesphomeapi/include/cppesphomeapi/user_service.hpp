@@ -0,0 +1,56 @@
+#ifndef CPPESPHOMEAPI_USER_SERVICE_HPP
+#define CPPESPHOMEAPI_USER_SERVICE_HPP
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <cppesphomeapi/cppesphomeapi_export.hpp>
+#include "entity.hpp"
+#include "result.hpp"
+
+namespace cppesphomeapi
+{
+// the alternatives are ordered like ServiceArgType, so the index of a value is its argument type.
+using ServiceArgValue = std::variant<bool,
+                                     std::int32_t,
+                                     float,
+                                     std::string,
+                                     std::vector<bool>,
+                                     std::vector<std::int32_t>,
+                                     std::vector<float>,
+                                     std::vector<std::string>>;
+
+/**
+ * The argument layout of a user defined service, compiled once from the discovered UserService.
+ * Arguments are passed positionally in the order of the service definition.
+ */
+class CPPESPHOMEAPI_EXPORT ServiceSchema
+{
+  public:
+    explicit ServiceSchema(const UserService &service);
+    static std::shared_ptr<const ServiceSchema> compile(const UserService &service);
+
+    [[nodiscard]] std::uint32_t key() const;
+    [[nodiscard]] const std::string &name() const;
+    [[nodiscard]] std::span<const ServiceArgType> arg_types() const;
+    [[nodiscard]] std::optional<std::size_t> arg_index(std::string_view arg_name) const;
+    [[nodiscard]] Result<void> validate(std::span<const ServiceArgValue> args) const;
+
+  private:
+    std::string name_;
+    std::uint32_t key_{};
+    std::vector<std::string> arg_names_;
+    std::vector<ServiceArgType> arg_types_;
+};
+
+struct ServiceCall
+{
+    std::shared_ptr<const ServiceSchema> schema;
+    std::vector<ServiceArgValue> args;
+};
+} // namespace cppesphomeapi
+#endif
@@ -0,0 +1,114 @@
+#ifndef CPPESPHOMEAPI_VOICE_ASSISTANT_HPP
+#define CPPESPHOMEAPI_VOICE_ASSISTANT_HPP
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <cppesphomeapi/cppesphomeapi_export.hpp>
+
+namespace cppesphomeapi
+{
+enum class VoiceAssistantEvent
+{
+    Error = 0,
+    RunStart = 1,
+    RunEnd = 2,
+    SttStart = 3,
+    SttEnd = 4,
+    IntentStart = 5,
+    IntentEnd = 6,
+    TtsStart = 7,
+    TtsEnd = 8,
+    WakeWordStart = 9,
+    WakeWordEnd = 10,
+    SttVadStart = 11,
+    SttVadEnd = 12,
+    TtsStreamStart = 98,
+    TtsStreamEnd = 99,
+};
+
+struct VoiceAssistantEventData
+{
+    std::string name;
+    std::string value;
+};
+
+struct VoiceAssistantAudioSettings
+{
+    std::uint32_t noise_suppression_level{};
+    std::uint32_t auto_gain{};
+    float volume_multiplier{};
+};
+
+struct VoiceAssistantRequest
+{
+    bool start{};
+    std::string conversation_id;
+    std::uint32_t flags{};
+    VoiceAssistantAudioSettings audio_settings;
+    std::string wake_word_phrase;
+};
+
+struct VoiceAssistantConfig
+{
+    // defaults match the 16kHz 16bit mono PCM stream of the esphome voice assistant: 512 samples per block.
+    std::size_t block_size{1024};
+    std::chrono::milliseconds block_duration{32};
+    // blocks shared by the microphone and the response stream.
+    std::size_t pool_size{64};
+    // response blocks buffered before the paced playback starts.
+    std::size_t jitter_blocks{2};
+
+    // half of the pool is reserved for the response audio, the other half for the microphone.
+    [[nodiscard]] constexpr std::size_t playback_blocks() const
+    {
+        return pool_size / 2;
+    }
+    // the largest pcm chunk a single async_send_voice_audio accepts. Larger responses are sent in chunks of at most
+    // this size, a chunk is refused while the blocks queued before it leave too little space.
+    [[nodiscard]] constexpr std::size_t max_playback_chunk() const
+    {
+        return playback_blocks() * block_size;
+    }
+};
+
+class AudioBlockPool;
+
+/**
+ * A fixed size PCM block borrowed from a connection owned pool.
+ * The block returns to the pool when it gets destroyed.
+ */
+class CPPESPHOMEAPI_EXPORT AudioBlock
+{
+  public:
+    AudioBlock() = default;
+    ~AudioBlock();
+    AudioBlock(AudioBlock &&other) noexcept;
+    AudioBlock &operator=(AudioBlock &&other) noexcept;
+    AudioBlock(const AudioBlock &) = delete;
+    AudioBlock &operator=(const AudioBlock &) = delete;
+
+    [[nodiscard]] std::span<const std::byte> data() const;
+    [[nodiscard]] std::size_t capacity() const;
+    [[nodiscard]] bool full() const;
+    // true for the last block of an audio stream.
+    [[nodiscard]] bool end() const;
+
+    std::size_t append(std::span<const std::byte> bytes);
+    void mark_end();
+
+  private:
+    friend class AudioBlockPool;
+    AudioBlock(std::shared_ptr<AudioBlockPool> pool, std::span<std::byte> storage);
+    void release();
+
+  private:
+    std::shared_ptr<AudioBlockPool> pool_;
+    std::span<std::byte> storage_;
+    std::size_t size_{};
+    bool end_{};
+};
+} // namespace cppesphomeapi
+#endif
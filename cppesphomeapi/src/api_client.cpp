@@ -13,49 +13,121 @@ ApiClient::ApiClient(const boost::asio::any_io_executor &executor,
 
 ApiClient::~ApiClient() = default;
 
-AsyncResult<void> ApiClient::async_connect()
+AsyncResult<void> ApiClient::async_connect(OptionalDeadline deadline)
 {
-    co_return co_await connection_->connect();
+    co_return co_await connection_->run(connection_->connect(), deadline);
 }
 
-AsyncResult<void> ApiClient::async_disconnect()
+AsyncResult<DeviceSnapshot> ApiClient::async_connect_pipelined(OptionalDeadline deadline)
 {
-    co_return co_await connection_->disconnect();
+    co_return co_await connection_->run(connection_->connect_pipelined(), deadline);
 }
 
-AsyncResult<DeviceInfo> ApiClient::async_device_info()
+AsyncResult<void> ApiClient::async_disconnect(OptionalDeadline deadline)
 {
-    co_return co_await connection_->request_device_info();
+    co_return co_await connection_->run(connection_->disconnect(), deadline);
 }
 
-AsyncResult<EntityInfoList> ApiClient::async_list_entities_services()
+AsyncResult<DeviceInfo> ApiClient::async_device_info(OptionalDeadline deadline)
 {
-    co_return co_await connection_->request_entities_and_services();
+    co_return co_await connection_->run(connection_->request_device_info(), deadline);
 }
 
-AsyncResult<void> ApiClient::async_light_command(LightCommand light_command)
+AsyncResult<EntityInfoList> ApiClient::async_list_entities_services(OptionalDeadline deadline)
 {
-    co_return co_await connection_->light_command(std::move(light_command));
+    co_return co_await connection_->run(connection_->request_entities_and_services(), deadline);
 }
 
-AsyncResult<void> ApiClient::subscribe_logs(EspHomeLogLevel log_level, bool config_dump)
+AsyncResult<void> ApiClient::async_light_command(LightCommand light_command, OptionalDeadline deadline)
 {
-    co_return co_await connection_->enable_logs(log_level, config_dump);
+    co_return co_await connection_->run(connection_->light_command(std::move(light_command)), deadline);
 }
 
-AsyncResult<LogEntry> ApiClient::async_receive_log()
+AsyncResult<void> ApiClient::async_execute_service(ServiceCall call, OptionalDeadline deadline)
 {
-    co_return co_await connection_->receive_log();
+    co_return co_await connection_->run(connection_->execute_service(std::move(call)), deadline);
 }
 
-AsyncResult<void> ApiClient::subscribe_states()
+AsyncResult<void> ApiClient::async_execute_services(std::vector<ServiceCall> calls, OptionalDeadline deadline)
 {
-    co_return co_await connection_->subscribe_states();
+    co_return co_await connection_->run(connection_->execute_services(calls), deadline);
 }
 
-AsyncResult<EntityStateVariant> ApiClient::async_receive_state()
+AsyncResult<void> ApiClient::subscribe_logs(EspHomeLogLevel log_level, bool config_dump, OptionalDeadline deadline)
 {
-    co_return co_await connection_->receive_state();
+    co_return co_await connection_->run(connection_->enable_logs(log_level, config_dump), deadline);
+}
+
+AsyncResult<LogEntry> ApiClient::async_receive_log(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_log(), deadline);
+}
+
+AsyncResult<LogEntryView> ApiClient::async_receive_log_view(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_log_view(), deadline);
+}
+
+AsyncResult<TextSensorStateView> ApiClient::async_receive_text_sensor_state_view(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_text_sensor_state_view(), deadline);
+}
+
+AsyncResult<void> ApiClient::subscribe_states(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->subscribe_states(), deadline);
+}
+
+AsyncResult<EntityStateVariant> ApiClient::async_receive_state(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_state(), deadline);
+}
+
+AsyncResult<void> ApiClient::subscribe_voice_assistant(VoiceAssistantConfig config, OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->subscribe_voice_assistant(config), deadline);
+}
+
+AsyncResult<void> ApiClient::unsubscribe_voice_assistant(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->unsubscribe_voice_assistant(), deadline);
+}
+
+AsyncResult<VoiceAssistantRequest> ApiClient::async_receive_voice_assistant_request(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_voice_assistant_request(), deadline);
+}
+
+AsyncResult<void> ApiClient::async_send_voice_assistant_response(bool error, OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->send_voice_assistant_response(error), deadline);
+}
+
+AsyncResult<void> ApiClient::async_send_voice_assistant_event(VoiceAssistantEvent event,
+                                                              std::vector<VoiceAssistantEventData> data,
+                                                              OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->send_voice_assistant_event(event, std::move(data)), deadline);
+}
+
+AsyncResult<AudioBlock> ApiClient::async_receive_voice_audio(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_voice_audio(), deadline);
+}
+
+AsyncResult<void> ApiClient::async_send_voice_audio(std::span<const std::byte> pcm, bool end, OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->send_voice_audio(pcm, end), deadline);
+}
+
+AsyncResult<void> ApiClient::async_request_camera_image(bool stream, OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->request_camera_image(stream), deadline);
+}
+
+AsyncResult<CameraImage> ApiClient::async_receive_camera_image(OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->receive_camera_image(), deadline);
 }
 
 std::optional<ApiVersion> ApiClient::api_version() const
@@ -63,14 +135,86 @@ std::optional<ApiVersion> ApiClient::api_version() const
     return connection_->api_version();
 }
 
-const std::string &ApiClient::device_name() const
+std::string ApiClient::device_name() const
 {
     return connection_->device_name();
 }
 
+std::size_t ApiClient::pending_receive_handlers() const
+{
+    return connection_->pending_receive_handlers();
+}
+
+bool ApiClient::submit_command(SubmittedCommand command, CommandCallback callback)
+{
+    return connection_->submit_command(std::move(command), std::move(callback));
+}
+
+SendMetrics ApiClient::send_metrics() const
+{
+    return connection_->send_metrics();
+}
+
+ConnectionMetrics ApiClient::metrics() const
+{
+    return connection_->metrics();
+}
+
+void ApiClient::enable_message_tracing(TraceOptions options)
+{
+    connection_->enable_message_tracing(options);
+}
+
+std::vector<MessageLatencies> ApiClient::message_latencies() const
+{
+    return connection_->message_latencies();
+}
+
+std::string ApiClient::chrome_trace() const
+{
+    return connection_->chrome_trace();
+}
+
+Result<void> ApiClient::start_capture(const std::filesystem::path &capture_file)
+{
+    return connection_->start_capture(capture_file);
+}
+
+void ApiClient::stop_capture()
+{
+    connection_->stop_capture();
+}
+
+void ApiClient::set_entity_interest(std::vector<std::uint32_t> keys)
+{
+    connection_->set_entity_interest(std::move(keys));
+}
+
+void ApiClient::clear_entity_interest()
+{
+    connection_->clear_entity_interest();
+}
+
+AsyncResult<void> ApiClient::async_replay(std::filesystem::path capture_file,
+                                          ReplayPace pace,
+                                          OptionalDeadline deadline)
+{
+    co_return co_await connection_->run(connection_->replay(std::move(capture_file), pace), deadline);
+}
+
 void ApiClient::close()
 {
     connection_->cancel();
 }
 
+AsyncResult<void> ApiClient::async_close()
+{
+    co_return co_await connection_->run(connection_->shutdown());
+}
+
+void ApiClient::set_decode_executor(const boost::asio::any_io_executor &executor)
+{
+    connection_->set_decode_executor(executor);
+}
+
 } // namespace cppesphomeapi
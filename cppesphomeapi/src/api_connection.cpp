@@ -1,13 +1,21 @@
 #include "api_connection.hpp"
-#include <print>
+#include <deque>
+#include <tuple>
 #include <boost/asio.hpp>
+#include <boost/asio/experimental/channel.hpp>
 #include "api.pb.h"
+#include "enabled_messages.hpp"
 #include "entity_conversion.hpp"
 #include "executor.hpp"
+#include "get_message_id.hpp"
+#include "logging.hpp"
 #include "make_unexpected_result.hpp"
 #include "net.hpp"
 #include "plain_text_protocol.hpp"
+#include "service_conversion.hpp"
 #include "state_conversion.hpp"
+#include "state_decoder.hpp"
+#include "traffic_capture.hpp"
 
 namespace asio = boost::asio;
 namespace this_coro = asio::this_coro;
@@ -23,6 +31,251 @@ namespace this_coro = asio::this_coro;
 
 namespace cppesphomeapi
 {
+namespace
+{
+using ReceivedMessages = detail::EnabledMessages<proto::SubscribeLogsResponse,
+                                                 proto::DeviceInfoResponse,
+                                                 proto::ConnectResponse,
+                                                 proto::HelloResponse,
+                                                 proto::PingResponse,
+                                                 proto::DisconnectResponse,
+                                                 proto::ListEntitiesDoneResponse,
+                                                 proto::ListEntitiesAlarmControlPanelResponse,
+                                                 proto::ListEntitiesBinarySensorResponse,
+                                                 proto::ListEntitiesButtonResponse,
+                                                 proto::ListEntitiesCameraResponse,
+                                                 proto::ListEntitiesClimateResponse,
+                                                 proto::ListEntitiesCoverResponse,
+                                                 proto::ListEntitiesDateResponse,
+                                                 proto::ListEntitiesDateTimeResponse,
+                                                 proto::ListEntitiesEventResponse,
+                                                 proto::ListEntitiesFanResponse,
+                                                 proto::ListEntitiesLightResponse,
+                                                 proto::ListEntitiesLockResponse,
+                                                 proto::ListEntitiesMediaPlayerResponse,
+                                                 proto::ListEntitiesNumberResponse,
+                                                 proto::ListEntitiesSelectResponse,
+                                                 proto::ListEntitiesSensorResponse,
+                                                 proto::ListEntitiesServicesResponse,
+                                                 proto::ListEntitiesSwitchResponse,
+                                                 proto::ListEntitiesTextResponse,
+                                                 proto::ListEntitiesTextSensorResponse,
+                                                 proto::ListEntitiesTimeResponse,
+                                                 proto::ListEntitiesUpdateResponse,
+                                                 proto::ListEntitiesValveResponse,
+                                                 proto::LightStateResponse,
+                                                 proto::SensorStateResponse,
+                                                 proto::BinarySensorStateResponse,
+                                                 proto::SwitchStateResponse,
+                                                 proto::TextSensorStateResponse,
+                                                 proto::VoiceAssistantRequest,
+                                                 proto::VoiceAssistantAudio,
+                                                 proto::VoiceAssistantAnnounceFinished,
+                                                 proto::CameraImageResponse>;
+
+// a frame that was already pinned is viewed in its block instead of being pinned again.
+template <typename THandler>
+Result<void> decode_received_frame(const Frame &frame,
+                                   MessagePool &message_pool,
+                                   ReceivedFramePool &frame_pool,
+                                   THandler &&handler,
+                                   const PinnedFrame &pinned = nullptr)
+{
+    // logs and text sensor states are decoded into views of their frame, so their strings are not copied.
+    if (auto view = pinned != nullptr ? decode_view(frame.message_type, pinned) : decode_view(frame, frame_pool);
+        view.has_value())
+    {
+        handler(MessageWrapper{frame.message_type, std::move(view).value()});
+        return Result<void>{};
+    }
+    // the hot state messages skip the protobuf message, malformed or unusual payloads are left to the generic parser.
+    if (auto state = decode_state(frame.message_type, frame.payload); state.has_value())
+    {
+        handler(MessageWrapper{frame.message_type, std::move(state).value()});
+        return Result<void>{};
+    }
+    // the messages of disabled ifdef domains are not in the list, their frames are skipped without decoding.
+    return detail::ApplyMessages<ReceivedMessages>::invoke([&]<typename... TMsgs>() {
+        return PlainTextProtocol::decode<TMsgs...>(frame, message_pool, std::forward<THandler>(handler));
+    });
+}
+
+using ListEntitiesResponses = detail::EnabledMessages<proto::ListEntitiesAlarmControlPanelResponse,
+                                                      proto::ListEntitiesBinarySensorResponse,
+                                                      proto::ListEntitiesButtonResponse,
+                                                      proto::ListEntitiesCameraResponse,
+                                                      proto::ListEntitiesClimateResponse,
+                                                      proto::ListEntitiesCoverResponse,
+                                                      proto::ListEntitiesDateResponse,
+                                                      proto::ListEntitiesDateTimeResponse,
+                                                      proto::ListEntitiesEventResponse,
+                                                      proto::ListEntitiesFanResponse,
+                                                      proto::ListEntitiesLightResponse,
+                                                      proto::ListEntitiesLockResponse,
+                                                      proto::ListEntitiesMediaPlayerResponse,
+                                                      proto::ListEntitiesNumberResponse,
+                                                      proto::ListEntitiesSelectResponse,
+                                                      proto::ListEntitiesSensorResponse,
+                                                      proto::ListEntitiesServicesResponse,
+                                                      proto::ListEntitiesSwitchResponse,
+                                                      proto::ListEntitiesTextResponse,
+                                                      proto::ListEntitiesTextSensorResponse,
+                                                      proto::ListEntitiesTimeResponse,
+                                                      proto::ListEntitiesUpdateResponse,
+                                                      proto::ListEntitiesValveResponse>;
+
+template <typename TMsgs>
+struct EntityInfoAppender;
+
+template <typename... TMsgs>
+struct EntityInfoAppender<std::tuple<TMsgs...>>
+{
+    // returns false if the message is not a list entities response.
+    static bool append(const MessageWrapper &message, EntityInfoList &list)
+    {
+        return ((message.holds_message<TMsgs>() &&
+                 (list.emplace_back(pb2entity_info(*message.get_if<TMsgs>())), true)) ||
+                ...);
+    }
+};
+
+// fails for the messages of an ifdef domain that is compiled out, they would never be received.
+template <typename TMsg>
+Result<void> require_enabled()
+{
+    if constexpr (detail::MessageTraits<TMsg>::enabled)
+    {
+        return Result<void>{};
+    }
+    else
+    {
+        return make_unexpected_result(
+            ApiErrorCode::FeatureDisabled,
+            std::format("{} is disabled by the option CPPESPHOMEAPI_{}",
+                        TMsg::GetDescriptor()->name(),
+                        detail::MessageTraits<TMsg>::ifdef));
+    }
+}
+
+// moves the state out of a state message, whether decoded by the state decoder or by the generic parser.
+std::optional<EntityStateVariant> received_state(MessageWrapper &message)
+{
+    if (message.state() != nullptr)
+    {
+        return std::move(message).take_state();
+    }
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+    if (const auto *text_sensor_state = message.view_if<TextSensorStateView>(); text_sensor_state != nullptr)
+    {
+        return text_sensor_state->to_owned();
+    }
+#endif
+    std::optional<EntityStateVariant> state;
+    detail::ApplyMessages<detail::EnabledMessages<proto::LightStateResponse,
+                                                  proto::SensorStateResponse,
+                                                  proto::BinarySensorStateResponse,
+                                                  proto::SwitchStateResponse,
+                                                  proto::TextSensorStateResponse>>::invoke([&]<typename... TMsgs>() {
+        ((message.holds_message<TMsgs>() && (state = pb2state(*std::move(message).as<TMsgs>())).has_value()) || ...);
+    });
+    return state;
+}
+
+// the view of a received log. A log decoded by the generic parser is viewed in its protobuf message.
+std::optional<LogEntryView> received_log_view(MessageWrapper &message)
+{
+    if (const auto *log = message.view_if<LogEntryView>(); log != nullptr)
+    {
+        return *log;
+    }
+    auto log = std::move(message).as<proto::SubscribeLogsResponse>();
+    if (log == nullptr)
+    {
+        return std::nullopt;
+    }
+    return LogEntryView{
+        .log_level = EspHomeLogLevel{std::to_underlying(log->level())},
+        .message = log->message(),
+        .send_failed = log->send_failed(),
+        .frame = std::move(log),
+    };
+}
+
+std::optional<TextSensorStateView> received_text_sensor_state_view(MessageWrapper &message)
+{
+    if (const auto *text_sensor_state = message.view_if<TextSensorStateView>(); text_sensor_state != nullptr)
+    {
+        return *text_sensor_state;
+    }
+    auto text_sensor_state = std::move(message).as<proto::TextSensorStateResponse>();
+    if (text_sensor_state == nullptr)
+    {
+        return std::nullopt;
+    }
+    TextSensorStateView view;
+    view.key = text_sensor_state->key();
+    view.state = text_sensor_state->state();
+    view.missing_state = text_sensor_state->missing_state();
+    view.frame = std::move(text_sensor_state);
+    return view;
+}
+
+DeviceInfo pb2device_info(const proto::DeviceInfoResponse &message)
+{
+    return DeviceInfo{
+        .uses_password = message.uses_password(),
+        .has_deep_sleep = message.has_deep_sleep(),
+        .name = message.name(),
+        .friendly_name = message.friendly_name(),
+        .mac_address = message.mac_address(),
+        .compilation_time = message.compilation_time(), // todo: maybe parse directly into std::chrono?
+        .model = message.model(),
+        .manufacturer = message.manufacturer(),
+        .esphome_version = message.esphome_version(),
+        .webserver_port = static_cast<uint16_t>(message.webserver_port()),
+        .suggested_area = message.suggested_area(),
+    };
+}
+
+void light_command2pb(const LightCommand &light_command, proto::LightCommandRequest &request)
+{
+    request.set_key(light_command.key);
+    if (light_command.effect.has_value())
+    {
+        request.set_effect(light_command.effect.value());
+    }
+}
+
+constexpr std::size_t kInboxCapacity{256};
+constexpr std::size_t kCommandQueueCapacity{256};
+constexpr std::size_t kCommandBatchSize{32};
+constexpr auto kResolveTimeout = std::chrono::milliseconds{500};
+constexpr auto kHeartbeatInterval = std::chrono::seconds{20};
+// the device pings at least every 90 seconds, a connection without any message for longer is dead.
+constexpr auto kReceiveTimeout = std::chrono::seconds{100};
+constexpr std::size_t kReceiveBufferSize = 4096;
+} // namespace
+
+struct ApiConnection::MessageInbox
+{
+    explicit MessageInbox(const asio::any_io_executor &executor)
+        : channel{executor, kInboxCapacity}
+    {}
+
+    // removes the forwarding handler, so it does not take the first message after the handshake.
+    ~MessageInbox()
+    {
+        stop_forwarding.emit(asio::cancellation_type::terminal);
+    }
+
+    MessageInbox(const MessageInbox &) = delete;
+    MessageInbox &operator=(const MessageInbox &) = delete;
+
+    asio::experimental::channel<void(net::ErrorCode, MessageWrapper)> channel;
+    bool overflow{false};
+    asio::cancellation_signal stop_forwarding;
+};
+
 ApiConnection::ApiConnection(std::string hostname,
                              std::uint16_t port,
                              std::string password,
@@ -33,20 +286,210 @@ ApiConnection::ApiConnection(std::string hostname,
     , password_{std::move(password)}
     , strand_{asio::make_strand(executor)}
     , socket_{strand_}
+    , message_pool_{MessagePool::create()}
+    , frame_pool_{ReceivedFramePool::create()}
+    , packet_pool_{PacketBufferPool::create()}
+    , command_queue_{kCommandQueueCapacity}
+    , command_wake_timer_{strand_}
+    , send_wake_timer_{strand_}
+    , caller_stop_{stop_source.get_token(), RequestStop{.strand = strand_, .stop = stop_}}
+    , loops_done_timer_{strand_}
+    , receive_done_timer_{strand_}
+{}
+
+void ApiConnection::cancel()
 {
-    executor::addStopService(executor::getContext(executor), stop_source);
+    RequestStop{.strand = strand_, .stop = stop_}();
 }
 
-void ApiConnection::cancel()
+AsyncResult<void> ApiConnection::shutdown()
 {
-    executor::stopAssetOf(executor::getContext(socket_.get_executor())).request_stop();
+    stop_.request_stop();
+    while (running_loops_ > 0)
+    {
+        // woken up by the last loop that finishes.
+        loops_done_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+        co_await loops_done_timer_.async_wait();
+    }
+    // the frames handed to the decode strand are dispatched back on the connection strand, wait until they arrived.
+    if (decode_strand_.has_value())
+    {
+        co_await asio::post(*decode_strand_, asio::use_awaitable);
+        co_await asio::post(strand_, asio::use_awaitable);
+    }
+    co_return Result<void>{};
+}
+
+template <typename... TArgs>
+void ApiConnection::commission(asio::awaitable<void> (ApiConnection::*loop)(TArgs...), TArgs... args)
+{
+    running_loops_++;
+    executor::commission(
+        stop_,
+        strand_,
+        [this]() {
+            if (--running_loops_ == 0)
+            {
+                loops_done_timer_.cancel();
+            }
+        },
+        loop,
+        this,
+        std::move(args)...);
 }
 
 AsyncResult<void> ApiConnection::connect()
 {
+    REQUIRE_SUCCESS(co_await open_socket());
+    REQUIRE_SUCCESS(co_await send_message_hello());
+    REQUIRE_SUCCESS(co_await send_message_connect());
+    co_return Result<void>{};
+}
+
+AsyncResult<DeviceSnapshot> ApiConnection::connect_pipelined()
+{
+    REQUIRE_SUCCESS(co_await open_socket());
+
+    // the inbox is registered before the first byte is sent, so no response can be dispatched without a receiver.
+    auto inbox = std::make_shared<MessageInbox>(co_await this_coro::executor);
+    forward_to_inbox(inbox);
+
+    proto::HelloRequest hello_request;
+    hello_request.set_client_info(std::string{"cppapi"});
+    proto::ConnectRequest connect_request;
+    connect_request.set_password(password_);
+    const proto::DeviceInfoRequest device_info_request;
+    const proto::ListEntitiesRequest list_entities_request;
+    const proto::SubscribeStatesRequest subscribe_states_request;
+
+    // the device handles the requests in order, so all of them are written with a single send.
+    auto burst = packet_pool_->acquire();
+    const auto serialize_all = [&burst](const auto &...requests) {
+        Result<void> serialized;
+        ((serialized = PlainTextProtocol::serialize_to(requests, burst.bytes())).has_value() && ...);
+        return serialized;
+    };
+    REQUIRE_SUCCESS(serialize_all(
+        hello_request, connect_request, device_info_request, list_entities_request, subscribe_states_request));
+    const auto burst_sent_at = Clock::now();
+    REQUIRE_SUCCESS(co_await send_packet(burst.bytes(), SendPriority::Control));
+
+    namespace aex = boost::asio::experimental;
+    using aex::awaitable_operators::operator||;
+    net::Timer timer{co_await this_coro::executor};
+
+    // one bound for the whole handshake, a device that keeps trickling responses must not extend it. It allows for the
+    // entity list of a large device, a deadline of the caller bounds the handshake tighter.
+    timer.expires_at(burst_sent_at + RttEstimator::kMaxTimeout);
+
+    DeviceSnapshot snapshot;
+    bool hello_received{false};
+    bool connected{false};
+    bool device_info_received{false};
+    bool entities_done{false};
+    while (not(hello_received and connected and device_info_received and entities_done))
+    {
+        auto received_message_or_error =
+            co_await (inbox->channel.async_receive(asio::as_tuple(asio::use_awaitable)) || timer.async_wait());
+        if (std::holds_alternative<std::tuple<net::ErrorCode>>(received_message_or_error))
+        {
+            co_return make_unexpected_result(ApiErrorCode::UnexpectedMessage,
+                                             "device did not answer all pipelined requests in time");
+        }
+        auto &&[error, message] = std::get<std::tuple<net::ErrorCode, MessageWrapper>>(received_message_or_error);
+        if (error or inbox->overflow)
+        {
+            co_return make_unexpected_result(ApiErrorCode::UnexpectedMessage,
+                                             "could not receive all responses of the pipelined requests");
+        }
+        trace_consumed(message);
+
+        if (const auto *hello = message.get_if<proto::HelloResponse>(); hello != nullptr)
+        {
+            std::unique_lock l{device_mtx_};
+            device_name_ = hello->name();
+            api_version_ = ApiVersion{.major = hello->api_version_major(), .minor = hello->api_version_minor()};
+            hello_received = true;
+            add_rtt_sample(Clock::now() - burst_sent_at);
+        }
+        else if (const auto *connect = message.get_if<proto::ConnectResponse>(); connect != nullptr)
+        {
+            if (connect->invalid_password())
+            {
+                co_return make_unexpected_result(ApiErrorCode::AuthentificationError, "Invalid password");
+            }
+            connected = true;
+        }
+        else if (const auto *device_info = message.get_if<proto::DeviceInfoResponse>(); device_info != nullptr)
+        {
+            snapshot.device_info = pb2device_info(*device_info);
+            device_info_received = true;
+        }
+        else if (message.holds_message<proto::ListEntitiesDoneResponse>())
+        {
+            entities_done = true;
+        }
+        else if (auto state = received_state(message); state.has_value())
+        {
+            snapshot.initial_states.emplace_back(std::move(state).value());
+        }
+        else
+        {
+            EntityInfoAppender<ListEntitiesResponses>::append(message, snapshot.entities);
+        }
+    }
+    // states that arrived together with the last response belong to the snapshot, they have no other receiver.
+    while (inbox->channel.try_receive([this, &snapshot](net::ErrorCode /*error*/, MessageWrapper message) {
+        if (auto state = received_state(message); state.has_value())
+        {
+            trace_consumed(message);
+            snapshot.initial_states.emplace_back(std::move(state).value());
+        }
+        else
+        {
+            metrics_.record_unclaimed_message();
+        }
+    }))
+    {
+    }
+    co_return snapshot;
+}
+
+void ApiConnection::forward_to_inbox(const std::shared_ptr<MessageInbox> &inbox)
+{
+    // the handler is bound to the strand, so it runs inline within dispatch_message and is registered again before the
+    // next message gets dispatched. Destroying the inbox cancels it through the slot.
+    async_receive_message(asio::bind_cancellation_slot(
+        inbox->stop_forwarding.slot(),
+        asio::bind_executor(strand_,
+                            [this, weak_inbox = std::weak_ptr{inbox}](net::ErrorCode error, MessageWrapper message) {
+                                const auto inbox = weak_inbox.lock();
+                                if (error or inbox == nullptr)
+                                {
+                                    return;
+                                }
+                                if (not inbox->channel.try_send(net::ErrorCode{}, std::move(message)))
+                                {
+                                    inbox->overflow = true;
+                                }
+                                forward_to_inbox(inbox);
+                            })));
+}
+
+AsyncResult<void> ApiConnection::open_socket()
+{
+    // the receive loop of a previous connect ends once its socket is closed. It closes the socket when it ends, so it
+    // has to end before the socket is connected again.
+    net::close(socket_);
+    while (receiving_)
+    {
+        receive_done_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+        co_await receive_done_timer_.async_wait();
+    }
+
     auto executor = co_await this_coro::executor;
     net::Timer timer{executor};
-    timer.expires_after(std::chrono::milliseconds{500});
+    timer.expires_after(kResolveTimeout);
 
     auto endpoints = co_await net::resolveHostEndpoints(hostname_, net::Port{port_}, timer);
     if (not endpoints.has_value())
@@ -57,7 +500,9 @@ AsyncResult<void> ApiConnection::connect()
                 "Could not resolve host {}:{}. Failed with error: {}", hostname_, port_, endpoints.error().message()));
     }
 
-    timer.expires_after(std::chrono::milliseconds{500});
+    // the tcp handshake takes one round trip, which gives the first estimate before any request was sent.
+    timer.expires_after(rtt_.timeout());
+    const auto connect_started_at = Clock::now();
     auto connect_result = co_await net::connectTo(socket_, *endpoints, timer);
     if (not connect_result.has_value())
     {
@@ -65,26 +510,38 @@ AsyncResult<void> ApiConnection::connect()
                                          std::format("Could not connect to host {}:{}. Failed with error: {}",
                                                      hostname_,
                                                      port_,
-                                                     connect_result->address().to_string()));
+                                                     connect_result.error().message()));
     }
     else
     {
-        std::println("Connected to {}", connect_result->address().to_string());
+        add_rtt_sample(Clock::now() - connect_started_at);
+        metrics_.record_connect();
+        LOG_INFO("Connected to {}", connect_result->address().to_string());
     }
 
-    executor::commission(socket_.get_executor(), &ApiConnection::receive_loop, this);
-    executor::commission(socket_.get_executor(), &ApiConnection::heartbeat_loop, this);
-
-    REQUIRE_SUCCESS(co_await send_message_hello());
-    REQUIRE_SUCCESS(co_await send_message_connect());
+    receiving_ = true;
+    commission(&ApiConnection::receive_loop);
+    // the other loops do not depend on the socket and keep running across reconnects.
+    if (not loops_started_)
+    {
+        loops_started_ = true;
+        commission(&ApiConnection::send_writer_loop);
+        commission(&ApiConnection::heartbeat_loop);
+        commission(&ApiConnection::command_writer_loop);
+    }
     co_return Result<void>{};
 }
 
+void ApiConnection::add_rtt_sample(RttEstimator::Duration rtt)
+{
+    rtt_.add_sample(rtt);
+    metrics_.record_round_trip(rtt);
+}
+
 AsyncResult<void> ApiConnection::disconnect()
 {
     proto::DisconnectRequest request;
-    REQUIRE_SUCCESS(co_await send_message(request));
-    REQUIRE_SUCCESS(co_await receive_message<proto::DisconnectResponse>(asio::use_awaitable));
+    REQUIRE_SUCCESS(co_await request_response<proto::DisconnectResponse>(request, SendPriority::Control));
     co_return Result<void>{};
 }
 
@@ -92,12 +549,14 @@ AsyncResult<void> ApiConnection::send_message_hello()
 {
     proto::HelloRequest request;
     request.set_client_info(std::string{"cppapi"});
-    REQUIRE_SUCCESS(co_await send_message(request));
-    auto response = co_await receive_message<proto::HelloResponse>(asio::use_awaitable);
+    auto response = co_await request_response<proto::HelloResponse>(request, SendPriority::Control);
     REQUIRE_SUCCESS(response);
     auto message = std::move(response.value());
-    device_name_ = message->name();
-    api_version_ = ApiVersion{.major = message->api_version_major(), .minor = message->api_version_minor()};
+    {
+        std::unique_lock l{device_mtx_};
+        device_name_ = message->name();
+        api_version_ = ApiVersion{.major = message->api_version_major(), .minor = message->api_version_minor()};
+    }
     co_return Result<void>{};
 }
 
@@ -105,8 +564,7 @@ AsyncResult<void> ApiConnection::send_message_connect()
 {
     proto::ConnectRequest request;
     request.set_password(password_);
-    REQUIRE_SUCCESS(co_await send_message(request));
-    auto response = co_await receive_message<proto::ConnectResponse>(asio::use_awaitable);
+    auto response = co_await request_response<proto::ConnectResponse>(request, SendPriority::Control);
     REQUIRE_SUCCESS(response);
     auto message = std::move(response.value());
     if (message->invalid_password())
@@ -119,53 +577,16 @@ AsyncResult<void> ApiConnection::send_message_connect()
 AsyncResult<DeviceInfo> ApiConnection::request_device_info()
 {
     proto::DeviceInfoRequest device_request{};
-    REQUIRE_SUCCESS(co_await send_message(device_request));
-    const auto response = co_await receive_message<proto::DeviceInfoResponse>(asio::use_awaitable);
+    const auto response = co_await request_response<proto::DeviceInfoResponse>(device_request);
     REQUIRE_SUCCESS(response);
-    auto message = std::move(response.value());
-
-    co_return DeviceInfo{
-        .uses_password = message->uses_password(),
-        .has_deep_sleep = message->has_deep_sleep(),
-        .name = message->name(),
-        .friendly_name = message->friendly_name(),
-        .mac_address = message->mac_address(),
-        .compilation_time = message->compilation_time(), // todo: maybe parse directly into std::chrono?
-        .model = message->model(),
-        .manufacturer = message->manufacturer(),
-        .esphome_version = message->esphome_version(),
-        .webserver_port = static_cast<uint16_t>(message->webserver_port()),
-        .suggested_area = message->suggested_area(),
-    };
+    co_return pb2device_info(*response.value());
 }
 
 AsyncResult<EntityInfoList> ApiConnection::request_entities_and_services()
 {
     proto::ListEntitiesRequest request;
-    auto message_receiver = receive_messages<proto::ListEntitiesDoneResponse,
-                                             proto::ListEntitiesAlarmControlPanelResponse,
-                                             proto::ListEntitiesBinarySensorResponse,
-                                             proto::ListEntitiesButtonResponse,
-                                             proto::ListEntitiesCameraResponse,
-                                             proto::ListEntitiesClimateResponse,
-                                             proto::ListEntitiesCoverResponse,
-                                             proto::ListEntitiesDateResponse,
-                                             proto::ListEntitiesDateTimeResponse,
-                                             proto::ListEntitiesEventResponse,
-                                             proto::ListEntitiesFanResponse,
-                                             proto::ListEntitiesLightResponse,
-                                             proto::ListEntitiesLockResponse,
-                                             proto::ListEntitiesMediaPlayerResponse,
-                                             proto::ListEntitiesNumberResponse,
-                                             proto::ListEntitiesSelectResponse,
-                                             proto::ListEntitiesSensorResponse,
-                                             proto::ListEntitiesServicesResponse,
-                                             proto::ListEntitiesSwitchResponse,
-                                             proto::ListEntitiesTextResponse,
-                                             proto::ListEntitiesTextSensorResponse,
-                                             proto::ListEntitiesTimeResponse,
-                                             proto::ListEntitiesUpdateResponse,
-                                             proto::ListEntitiesValveResponse>(asio::deferred);
+    auto message_receiver = detail::ApplyMessages<ListEntitiesResponses>::invoke(
+        [this]<typename... TMsgs>() { return receive_messages<proto::ListEntitiesDoneResponse, TMsgs...>(); });
     REQUIRE_SUCCESS(co_await send_message(request));
     auto messages = co_await std::move(message_receiver);
     REQUIRE_SUCCESS(messages);
@@ -181,54 +602,281 @@ AsyncResult<EntityInfoList> ApiConnection::request_entities_and_services()
 
 AsyncResult<void> ApiConnection::light_command(LightCommand light_command)
 {
-    proto::LightCommandRequest request{};
-    request.set_key(light_command.key);
+    REQUIRE_SUCCESS(require_enabled<proto::LightCommandRequest>());
+    // send_message serializes the request before it first suspends, so the command writer can not interleave.
+    command_light_request_.Clear();
+    light_command2pb(light_command, command_light_request_);
+    co_return co_await send_message(command_light_request_, SendPriority::Control);
+}
 
-    if (light_command.effect.has_value())
+AsyncResult<void> ApiConnection::execute_service(ServiceCall call)
+{
+    co_return co_await execute_services(std::span{std::addressof(call), 1});
+}
+
+AsyncResult<void> ApiConnection::execute_services(std::span<const ServiceCall> calls)
+{
+    const bool legacy_int = uses_legacy_int_arguments();
+
+    // all calls are written with a single send.
+    auto batch = packet_pool_->acquire();
+    proto::ExecuteServiceRequest request;
+    for (auto &&call : calls)
     {
-        request.set_effect(std::move(light_command.effect.value()));
+        if (call.schema == nullptr)
+        {
+            co_return make_unexpected_result(ApiErrorCode::InvalidArgument, "service call without a schema");
+        }
+        REQUIRE_SUCCESS(call.schema->validate(call.args));
+        request.Clear();
+        service_call2pb(*call.schema, call.args, legacy_int, request);
+        REQUIRE_SUCCESS(PlainTextProtocol::serialize_to(request, batch.bytes()));
     }
-    co_return co_await send_message(request);
+    if (batch.bytes().empty())
+    {
+        co_return Result<void>{};
+    }
+    co_return co_await send_packet(batch.bytes(), SendPriority::Control);
+}
+
+bool ApiConnection::uses_legacy_int_arguments() const
+{
+    // ESPHome 1.14 (api v1.3) changed int arguments to signed values
+    const auto version = api_version();
+    return version.has_value() and std::tie(version->major, version->minor) < std::tuple{1U, 3U};
+}
+
+bool ApiConnection::submit_command(SubmittedCommand command, CommandCallback callback)
+{
+    CommandQueue::Entry entry{.command = std::move(command), .callback = std::move(callback)};
+    if (not command_queue_.try_push(entry))
+    {
+        return false;
+    }
+    // pairs with the fence of the command writer, either it sees the command or we see it idle.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (command_writer_idle_.exchange(false))
+    {
+        asio::post(strand_, [this]() { command_wake_timer_.cancel(); });
+    }
+    return true;
+}
+
+Result<void> ApiConnection::serialize_command(const SubmittedCommand &command, std::vector<std::byte> &batch)
+{
+    // the requests are reused, clearing them keeps the capacity of their strings and repeated fields.
+    return std::visit(detail::overloaded{
+                          [this, &batch](const LightCommand &light_command) -> Result<void> {
+                              if (auto enabled = require_enabled<proto::LightCommandRequest>(); not enabled)
+                              {
+                                  return enabled;
+                              }
+                              command_light_request_.Clear();
+                              light_command2pb(light_command, command_light_request_);
+                              return PlainTextProtocol::serialize_to(command_light_request_, batch);
+                          },
+                          [this, &batch](const ServiceCall &call) -> Result<void> {
+                              if (call.schema == nullptr)
+                              {
+                                  return make_unexpected_result(ApiErrorCode::InvalidArgument,
+                                                                "service call without a schema");
+                              }
+                              if (auto valid = call.schema->validate(call.args); not valid.has_value())
+                              {
+                                  return std::unexpected(std::move(valid.error()));
+                              }
+                              command_service_request_.Clear();
+                              service_call2pb(
+                                  *call.schema, call.args, uses_legacy_int_arguments(), command_service_request_);
+                              return PlainTextProtocol::serialize_to(command_service_request_, batch);
+                          },
+                      },
+                      command);
 }
 
-AsyncResult<void> ApiConnection::send_message(const google::protobuf::Message &message)
+boost::asio::awaitable<void> ApiConnection::command_writer_loop()
 {
-    const auto packet = PlainTextProtocol::serialize(message);
-    if (packet.has_value())
+    const auto watch_dog = executor::abort(stop_.get_token(), command_wake_timer_);
+
+    std::vector<std::byte> batch;
+    std::vector<CommandCallback> callbacks;
+    callbacks.reserve(kCommandBatchSize);
+    while (not stop_.stop_requested())
     {
-        std::println("Sending {}", message.GetTypeName());
-        auto executor = co_await this_coro::executor;
-        net::Timer timer{executor};
-        const auto watch_dog = executor::abort(socket_, timer);
-        timer.expires_after(std::chrono::milliseconds{500});
+        auto entry = command_queue_.try_pop();
+        if (not entry.has_value())
+        {
+            command_writer_idle_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (not command_queue_.empty())
+            {
+                command_writer_idle_.store(false);
+                continue;
+            }
+            // woken up by submit_command, which cancels the wait.
+            command_wake_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+            co_await command_wake_timer_.async_wait();
+            continue;
+        }
+
+        // drain a batch of commands and write it with a single send.
+        batch.clear();
+        callbacks.clear();
+        do
+        {
+            auto serialized = serialize_command(entry->command, batch);
+            if (not serialized.has_value())
+            {
+                if (entry->callback)
+                {
+                    entry->callback(std::move(serialized));
+                }
+                continue;
+            }
+            callbacks.emplace_back(std::move(entry->callback));
+        } while (callbacks.size() < kCommandBatchSize and (entry = command_queue_.try_pop()).has_value());
+
+        if (batch.empty())
+        {
+            continue;
+        }
+        const auto sent = co_await send_packet(batch, SendPriority::Control);
+        for (auto &&callback : callbacks)
+        {
+            if (callback)
+            {
+                callback(sent);
+            }
+        }
+    }
+
+    while (auto entry = command_queue_.try_pop())
+    {
+        if (entry->callback)
+        {
+            entry->callback(make_unexpected_result(ApiErrorCode::SendError, "connection is closed"));
+        }
+    }
+}
+
+AsyncResult<void> ApiConnection::send_message(const google::protobuf::Message &message,
+                                              std::uint32_t message_type,
+                                              SendPriority priority)
+{
+    // the buffer returns to the pool once the packet was written.
+    auto packet = packet_pool_->acquire();
+    REQUIRE_SUCCESS(PlainTextProtocol::serialize_to(message, message_type, packet.bytes()));
+    LOG_TRACE("Sending {}", message.GetTypeName());
+    co_return co_await send_packet(packet.bytes(), priority);
+}
+
+AsyncResult<void> ApiConnection::send_packet(std::span<const std::byte> packet, SendPriority priority)
+{
+    co_return co_await async_enqueue_send(priority, packet, asio::use_awaitable);
+}
+
+void ApiConnection::cancel_send(std::uint64_t send_id)
+{
+    auto pending = send_scheduler_.remove(send_id);
+    if (not pending.has_value())
+    {
+        return;
+    }
+    // called from within the cancellation slot, so the completion is posted instead of invoked inline.
+    auto work = boost::asio::make_work_guard(pending->handler);
+    auto alloc = boost::asio::get_associated_allocator(pending->handler, boost::asio::recycling_allocator<void>());
+    boost::asio::post(work.get_executor(),
+                      boost::asio::bind_allocator(alloc, [handler = std::move(pending->handler)]() mutable {
+                          std::move(handler)(make_unexpected_result(ApiErrorCode::SendError, "Sending was cancelled"));
+                      }));
+}
+
+SendMetrics ApiConnection::send_metrics() const
+{
+    return send_scheduler_.metrics();
+}
+
+ConnectionMetrics ApiConnection::metrics() const
+{
+    auto metrics = metrics_.snapshot();
+    metrics.pending_receive_handlers = pending_receive_handlers();
+    for (auto &&lane : send_scheduler_.metrics())
+    {
+        metrics.send_queue_depth += lane.queue_depth;
+    }
+    return metrics;
+}
+
+boost::asio::awaitable<void> ApiConnection::send_writer_loop()
+{
+    auto executor = co_await this_coro::executor;
+    net::Timer timer{executor};
+    const auto watch_dog = executor::abort(stop_.get_token(), socket_, timer, send_wake_timer_);
+
+    const auto complete = [](boost::asio::any_completion_handler<SendScheduler::SendSignature> handler,
+                             Result<void> result) {
+        auto work = boost::asio::make_work_guard(handler);
+        auto alloc = boost::asio::get_associated_allocator(handler, boost::asio::recycling_allocator<void>());
+        boost::asio::dispatch(work.get_executor(),
+                              boost::asio::bind_allocator(
+                                  alloc, [handler = std::move(handler), result = std::move(result)]() mutable {
+                                      std::move(handler)(std::move(result));
+                                  }));
+    };
+
+    while (not stop_.stop_requested())
+    {
+        auto pending = send_scheduler_.pop();
+        if (not pending.has_value())
+        {
+            send_wake_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+            co_await send_wake_timer_.async_wait();
+            continue;
+        }
+        // the write can not be aborted in the middle of a frame anymore.
+        boost::asio::get_associated_cancellation_slot(pending->handler).clear();
 
-        const auto written = co_await net::sendTo(socket_, timer, packet.value());
-        if (written.has_value() && written.value() != packet->size())
+        const auto packet = pending->packet;
+        timer.expires_after(rtt_.timeout());
+        const auto written = co_await net::sendTo(socket_, timer, packet);
+        if (written.has_value() && written.value() != packet.size())
         {
-            co_return make_unexpected_result(
-                ApiErrorCode::SendError,
-                std::format("Could not send message. Bytes written are different: expected={}, written={}",
-                            packet->size(),
-                            *written));
+            complete(std::move(pending->handler),
+                     make_unexpected_result(
+                         ApiErrorCode::SendError,
+                         std::format("Could not send message. Bytes written are different: expected={}, written={}",
+                                     packet.size(),
+                                     *written)));
         }
         else if (not written.has_value())
         {
-            co_return make_unexpected_result(
-                ApiErrorCode::SendError,
-                std::format("Could not send message in time. Error: {}", written.error().message()));
+            complete(std::move(pending->handler),
+                     make_unexpected_result(
+                         ApiErrorCode::SendError,
+                         std::format("Could not send message in time. Error: {}", written.error().message())));
+        }
+        else
+        {
+            metrics_.record_sent_packet(packet);
+            complete(std::move(pending->handler), Result<void>{});
         }
-        co_return Result<void>{};
     }
-    co_return std::unexpected(packet.error());
+
+    while (auto pending = send_scheduler_.pop())
+    {
+        complete(std::move(pending->handler), make_unexpected_result(ApiErrorCode::SendError, "connection is closed"));
+    }
 }
 
-const std::optional<ApiVersion> &ApiConnection::api_version() const
+std::optional<ApiVersion> ApiConnection::api_version() const
 {
+    std::unique_lock l{device_mtx_};
     return api_version_;
 }
 
-const std::string &ApiConnection::device_name() const
+std::string ApiConnection::device_name() const
 {
+    std::unique_lock l{device_mtx_};
     return device_name_;
 }
 
@@ -237,17 +885,25 @@ AsyncResult<void> ApiConnection::enable_logs(EspHomeLogLevel log_level, bool con
     proto::SubscribeLogsRequest request;
     request.set_dump_config(config_dump);
     request.set_level(::cppesphomeapi::proto::LogLevel(std::to_underlying(log_level)));
-    co_return co_await send_message(request);
+    co_return co_await send_message(request, SendPriority::Bulk);
 }
 
 AsyncResult<LogEntry> ApiConnection::receive_log()
 {
-    const auto message = co_await receive_message<proto::SubscribeLogsResponse>(asio::use_awaitable);
-    REQUIRE_SUCCESS(message);
-    co_return LogEntry{
-        .log_level = EspHomeLogLevel{std::to_underlying(message.value()->level())},
-        .message = message.value()->message(),
-    };
+    const auto log = co_await receive_log_view();
+    REQUIRE_SUCCESS(log);
+    co_return log->to_owned();
+}
+
+AsyncResult<LogEntryView> ApiConnection::receive_log_view()
+{
+    co_return co_await receive_converted<LogEntryView>(received_log_view);
+}
+
+AsyncResult<TextSensorStateView> ApiConnection::receive_text_sensor_state_view()
+{
+    REQUIRE_SUCCESS(require_enabled<proto::TextSensorStateResponse>());
+    co_return co_await receive_converted<TextSensorStateView>(received_text_sensor_state_view);
 }
 
 AsyncResult<void> ApiConnection::subscribe_states()
@@ -258,105 +914,573 @@ AsyncResult<void> ApiConnection::subscribe_states()
 
 AsyncResult<EntityStateVariant> ApiConnection::receive_state()
 {
-    const auto message = co_await receive_any_message<proto::LightStateResponse>(asio::use_awaitable);
+    while (true)
+    {
+        auto [error, message] = co_await async_receive_message(asio::as_tuple(asio::use_awaitable));
+        if (error)
+        {
+            co_return make_unexpected_result(ApiErrorCode::UnexpectedMessage,
+                                             std::format("Receiving aborted. Error: {}", error.message()));
+        }
+        if (auto state = received_state(message); state.has_value())
+        {
+            trace_consumed(message);
+            co_return std::move(state).value();
+        }
+    }
+}
+
+AsyncResult<void> ApiConnection::subscribe_voice_assistant(VoiceAssistantConfig config)
+{
+    REQUIRE_SUCCESS(require_enabled<proto::SubscribeVoiceAssistantRequest>());
+    if (voice_assistant_ == nullptr)
+    {
+        voice_assistant_ = std::make_shared<VoiceAssistantSession>(socket_.get_executor(), config);
+        commission(&ApiConnection::voice_playback_loop, std::shared_ptr{voice_assistant_});
+    }
+    proto::SubscribeVoiceAssistantRequest request;
+    request.set_subscribe(true);
+    request.set_flags(proto::VoiceAssistantSubscribeFlag::VOICE_ASSISTANT_SUBSCRIBE_API_AUDIO);
+    co_return co_await send_message(request);
+}
+
+AsyncResult<void> ApiConnection::unsubscribe_voice_assistant()
+{
+    proto::SubscribeVoiceAssistantRequest request;
+    request.set_subscribe(false);
+    REQUIRE_SUCCESS(co_await send_message(request));
+    if (auto session = std::exchange(voice_assistant_, nullptr); session != nullptr)
+    {
+        session->close();
+    }
+    co_return Result<void>{};
+}
+
+AsyncResult<VoiceAssistantRequest> ApiConnection::receive_voice_assistant_request()
+{
+    const auto message = co_await receive_any_message<proto::VoiceAssistantRequest>();
     REQUIRE_SUCCESS(message);
-    auto &&value = message.value();
+    const auto &request = *std::get<0>(message.value());
+    co_return VoiceAssistantRequest{
+        .start = request.start(),
+        .conversation_id = request.conversation_id(),
+        .flags = request.flags(),
+        .audio_settings =
+            VoiceAssistantAudioSettings{
+                .noise_suppression_level = request.audio_settings().noise_suppression_level(),
+                .auto_gain = request.audio_settings().auto_gain(),
+                .volume_multiplier = request.audio_settings().volume_multiplier(),
+            },
+        .wake_word_phrase = request.wake_word_phrase(),
+    };
+}
 
-    co_return std::visit([](auto &&msg) { return EntityStateVariant{pb2state(*msg)}; }, value);
+AsyncResult<void> ApiConnection::send_voice_assistant_response(bool error)
+{
+    proto::VoiceAssistantResponse response;
+    // port 0 tells the device to stream the audio through the api connection.
+    response.set_port(0);
+    response.set_error(error);
+    co_return co_await send_message(response);
+}
+
+AsyncResult<void> ApiConnection::send_voice_assistant_event(VoiceAssistantEvent event,
+                                                            std::vector<VoiceAssistantEventData> data)
+{
+    proto::VoiceAssistantEventResponse response;
+    response.set_event_type(proto::VoiceAssistantEvent(std::to_underlying(event)));
+    for (auto &&entry : data)
+    {
+        auto *pb_entry = response.add_data();
+        pb_entry->set_name(std::move(entry.name));
+        pb_entry->set_value(std::move(entry.value));
+    }
+    co_return co_await send_message(response);
+}
+
+AsyncResult<AudioBlock> ApiConnection::receive_voice_audio()
+{
+    const auto session = voice_assistant_;
+    if (session == nullptr)
+    {
+        co_return make_unexpected_result(ApiErrorCode::NotSubscribed, "voice assistant is not subscribed");
+    }
+    auto [error, block] = co_await session->capture().async_receive(asio::as_tuple(asio::use_awaitable));
+    if (error)
+    {
+        co_return make_unexpected_result(ApiErrorCode::NotSubscribed,
+                                         std::format("voice assistant audio stream closed: {}", error.message()));
+    }
+    co_return std::move(block);
+}
+
+AsyncResult<void> ApiConnection::send_voice_audio(std::span<const std::byte> pcm, bool end)
+{
+    if (voice_assistant_ == nullptr)
+    {
+        co_return make_unexpected_result(ApiErrorCode::NotSubscribed, "voice assistant is not subscribed");
+    }
+    co_return voice_assistant_->queue_playback(pcm, end);
+}
+
+AsyncResult<void> ApiConnection::request_camera_image(bool stream)
+{
+    REQUIRE_SUCCESS(require_enabled<proto::CameraImageRequest>());
+    proto::CameraImageRequest request;
+    request.set_single(not stream);
+    request.set_stream(stream);
+    co_return co_await send_message(request, SendPriority::Bulk);
+}
+
+AsyncResult<CameraImage> ApiConnection::receive_camera_image()
+{
+    REQUIRE_SUCCESS(require_enabled<proto::CameraImageResponse>());
+    CameraImage image;
+    while (true)
+    {
+        const auto chunk = co_await receive_message<proto::CameraImageResponse>();
+        REQUIRE_SUCCESS(chunk);
+        const auto &response = *chunk.value();
+        const auto data = std::as_bytes(std::span{response.data()});
+        image.key = response.key();
+        image.data.insert(image.data.end(), data.begin(), data.end());
+        if (response.done())
+        {
+            co_return image;
+        }
+    }
+}
+
+boost::asio::awaitable<void> ApiConnection::voice_playback_loop(std::shared_ptr<VoiceAssistantSession> session)
+{
+    auto executor = co_await this_coro::executor;
+    net::Timer pacer{executor};
+    // closing the session ends the wait for the next block.
+    const auto watch_dog = executor::abort(stop_.get_token(), pacer, *session);
+    const auto &config = session->config();
+
+    std::deque<AudioBlock> jitter_buffer;
+    // reused for every block so the data field keeps its capacity.
+    proto::VoiceAssistantAudio message;
+    while (true)
+    {
+        auto [error, block] = co_await session->playback().async_receive(asio::as_tuple(asio::use_awaitable));
+        if (error)
+        {
+            break;
+        }
+        session->on_playback_received();
+        jitter_buffer.emplace_back(std::move(block));
+        if (jitter_buffer.size() < config.jitter_blocks and not jitter_buffer.back().end())
+        {
+            continue;
+        }
+
+        // send the buffered blocks with the rate they are played back by the device. If the buffer runs empty,
+        // the loop above fills it up to the configured jitter again.
+        auto next_block_at = net::Timer::clock_type::now();
+        while (not jitter_buffer.empty())
+        {
+            const auto current = std::move(jitter_buffer.front());
+            jitter_buffer.pop_front();
+            const auto data = current.data();
+            message.mutable_data()->assign(reinterpret_cast<const char *>(data.data()), data.size());
+            message.set_end(current.end());
+            const auto sent = co_await send_message(message, SendPriority::Bulk);
+            if (not sent.has_value())
+            {
+                LOG_WARNING("Could not send voice assistant audio. Error {}", sent.error().message);
+            }
+
+            next_block_at += config.block_duration;
+            pacer.expires_at(next_block_at);
+            co_await pacer.async_wait();
+            while (session->playback().try_receive(
+                [&jitter_buffer, &session](net::ErrorCode receive_error, AudioBlock pending) {
+                    if (not receive_error)
+                    {
+                        session->on_playback_received();
+                        jitter_buffer.emplace_back(std::move(pending));
+                    }
+                }))
+            {
+            }
+        }
+    }
+}
+
+void ApiConnection::set_decode_executor(const boost::asio::any_io_executor &executor)
+{
+    asio::post(strand_, [this, decode_strand = asio::make_strand(executor)]() { decode_strand_ = decode_strand; });
+}
+
+void ApiConnection::enable_message_tracing(TraceOptions options)
+{
+    const std::scoped_lock lock{tracers_mutex_};
+    tracer_.store(tracers_.emplace_back(std::make_unique<MessageTracer>(options)).get(), std::memory_order_release);
+}
+
+std::vector<MessageLatencies> ApiConnection::message_latencies() const
+{
+    const auto *tracer = tracer_.load(std::memory_order_acquire);
+    return tracer != nullptr ? tracer->latencies() : std::vector<MessageLatencies>{};
+}
+
+std::string ApiConnection::chrome_trace() const
+{
+    const auto *tracer = tracer_.load(std::memory_order_acquire);
+    return tracer != nullptr ? tracer->chrome_trace() : std::string{R"({"traceEvents":[]})"};
+}
+
+void ApiConnection::trace_consumed(const MessageWrapper &message)
+{
+    if (auto *tracer = tracer_.load(std::memory_order_acquire); tracer != nullptr)
+    {
+        tracer->consumed(message);
+    }
 }
 
 boost::asio::awaitable<void> ApiConnection::receive_loop()
 {
-    std::array<std::byte, 4096> buffer{};
+    std::vector<std::byte> buffer(kReceiveBufferSize);
+    std::size_t buffered{};
     auto executor = co_await this_coro::executor;
     net::Timer timer{executor};
-    const auto watch_dog = executor::abort(socket_, timer);
+    const auto watch_dog = executor::abort(stop_.get_token(), socket_, timer);
 
     bool do_receive{true};
     while (do_receive)
     {
-        timer.expires_after(std::chrono::seconds{100}); // at least every 90secs. a message should be received
-        const auto received_bytes = co_await net::receiveFrom(socket_, timer, buffer);
+        timer.expires_after(kReceiveTimeout);
+        const auto received_bytes = co_await net::receiveFrom(socket_, timer, std::span{buffer}.subspan(buffered));
         if (not received_bytes.has_value())
         {
-            std::println("Could not receive bytes. Error {}", received_bytes.error().message());
+            LOG_WARNING("Could not receive bytes. Error {}", received_bytes.error().message());
             break;
         }
-        auto result = PlainTextProtocol{}
-                          .decode_multiple<proto::SubscribeLogsResponse,
-                                           proto::DeviceInfoResponse,
-                                           proto::ConnectResponse,
-                                           proto::HelloResponse,
-                                           proto::PingResponse,
-                                           proto::DisconnectResponse,
-                                           proto::ListEntitiesDoneResponse,
-                                           proto::ListEntitiesAlarmControlPanelResponse,
-                                           proto::ListEntitiesBinarySensorResponse,
-                                           proto::ListEntitiesButtonResponse,
-                                           proto::ListEntitiesCameraResponse,
-                                           proto::ListEntitiesClimateResponse,
-                                           proto::ListEntitiesCoverResponse,
-                                           proto::ListEntitiesDateResponse,
-                                           proto::ListEntitiesDateTimeResponse,
-                                           proto::ListEntitiesEventResponse,
-                                           proto::ListEntitiesFanResponse,
-                                           proto::ListEntitiesLightResponse,
-                                           proto::ListEntitiesLockResponse,
-                                           proto::ListEntitiesMediaPlayerResponse,
-                                           proto::ListEntitiesNumberResponse,
-                                           proto::ListEntitiesSelectResponse,
-                                           proto::ListEntitiesSensorResponse,
-                                           proto::ListEntitiesServicesResponse,
-                                           proto::ListEntitiesSwitchResponse,
-                                           proto::ListEntitiesTextResponse,
-                                           proto::ListEntitiesTextSensorResponse,
-                                           proto::ListEntitiesTimeResponse,
-                                           proto::ListEntitiesUpdateResponse,
-                                           proto::ListEntitiesValveResponse,
-                                           proto::LightStateResponse>(
-                              std::span{buffer.cbegin(), received_bytes.value()}, [this](auto &&message) {
-                                  std::vector<boost::asio::any_completion_handler<void(MessageWrapper)>> handlers;
-                                  {
-                                      std::unique_lock l{handler_mtx_};
-                                      handlers = std::exchange(handlers_, {});
-                                  }
-                                  // todo: add small ring buffer if the handlers are empty or try to return the
-                                  // acceptance from the handler.
-                                  for (auto &&handler : handlers)
-                                  {
-                                      auto work = boost::asio::make_work_guard(handler);
-                                      auto alloc = boost::asio::get_associated_allocator(
-                                          handler, boost::asio::recycling_allocator<void>());
-
-                                      // Dispatch the completion handler through the handler's associated
-                                      // executor, using the handler's associated allocator.
-                                      boost::asio::dispatch(
-                                          work.get_executor(),
-                                          boost::asio::bind_allocator(
-                                              alloc, [handler = std::move(handler), result = message]() mutable {
-                                                  std::move(handler)(std::move(result));
-                                              }));
-                                  }
-                                  std::println("Received message {}", message.ref().GetTypeName());
-                              });
-    }
-    std::println("RECEIVE ENDED!");
+        const auto read_at = Clock::now();
+        const auto received = std::span<const std::byte>{buffer}.subspan(buffered, received_bytes.value());
+        if (capture_ != nullptr)
+        {
+            if (const auto written = capture_->write(received); not written.has_value())
+            {
+                LOG_ERROR("Stopped capturing. {}", written.error().message);
+                capture_.reset();
+            }
+        }
+        metrics_.record_received_bytes(received.size());
+        const auto incomplete = process_received(buffer, buffered + received.size(), read_at);
+        if (not incomplete.has_value())
+        {
+            LOG_ERROR("Closing the connection to {}:{}. Error {}", hostname_, port_, incomplete.error().message);
+            break;
+        }
+        buffered = incomplete.value();
+    }
+    // a connection that stopped receiving, e.g. by the watchdog, is dead. Closing it fails the pending sends.
+    net::close(socket_);
+    receiving_ = false;
+    receive_done_timer_.cancel();
+    LOG_DEBUG("Receive loop of {}:{} ended", hostname_, port_);
+}
+
+Result<std::size_t> ApiConnection::process_received(std::vector<std::byte> &buffer,
+                                                    std::size_t buffered,
+                                                    std::chrono::steady_clock::time_point read_at)
+{
+    auto pending = std::span<const std::byte>{buffer}.first(buffered);
+    std::size_t required_size = buffer.size();
+    while (not pending.empty())
+    {
+        const auto header = PlainTextProtocol::read_frame_header(pending);
+        if (not header.has_value())
+        {
+            // there is no way to find the start of the next frame after a broken header.
+            metrics_.record_broken_frame();
+            return std::unexpected(header.error());
+        }
+        if (not header->has_value())
+        {
+            break;
+        }
+        const auto &frame_header = header->value();
+        if (pending.size() < frame_header.frame_size())
+        {
+            required_size = std::max(required_size, frame_header.frame_size());
+            break;
+        }
+        metrics_.record_received_frame(frame_header.message_type);
+        process_frame(
+            Frame{
+                .message_type = frame_header.message_type,
+                .payload = pending.subspan(frame_header.header_size, frame_header.payload_size),
+            },
+            read_at);
+        pending = pending.subspan(frame_header.frame_size());
+    }
+
+    // keep the incomplete frame at the front of the buffer until the remaining bytes are received.
+    std::ranges::copy(pending, buffer.begin());
+    if (required_size > buffer.size())
+    {
+        buffer.resize(required_size);
+    }
+    return pending.size();
+}
+
+AsyncResult<void> ApiConnection::replay(std::filesystem::path capture_file, ReplayPace pace)
+{
+    auto reader = CaptureReader::open(capture_file);
+    REQUIRE_SUCCESS(reader);
+
+    std::vector<std::byte> buffer(kReceiveBufferSize);
+    std::size_t buffered{};
+    net::Timer timer{co_await this_coro::executor};
+    const auto started = Clock::now();
+    while (true)
+    {
+        const auto record = reader->next();
+        REQUIRE_SUCCESS(record);
+        if (not record->has_value())
+        {
+            break;
+        }
+        const CaptureRecord &received = record->value();
+        if (pace == ReplayPace::Original)
+        {
+            timer.expires_at(started + received.offset);
+            co_await timer.async_wait();
+        }
+        else
+        {
+            // lets the receivers that were completed by the last record wait for the next message again.
+            co_await asio::post(strand_, asio::use_awaitable);
+        }
+
+        if (buffered + received.bytes.size() > buffer.size())
+        {
+            buffer.resize(buffered + received.bytes.size());
+        }
+        std::ranges::copy(received.bytes, buffer.begin() + static_cast<std::ptrdiff_t>(buffered));
+        metrics_.record_received_bytes(received.bytes.size());
+        const auto incomplete = process_received(buffer, buffered + received.bytes.size(), Clock::now());
+        REQUIRE_SUCCESS(incomplete);
+        buffered = incomplete.value();
+    }
+    if (buffered > 0)
+    {
+        co_return make_unexpected_result(ApiErrorCode::ParseError,
+                                         std::format("Capture ends within a frame, {} bytes left", buffered));
+    }
+    co_return Result<void>{};
+}
+
+Result<void> ApiConnection::start_capture(const std::filesystem::path &capture_file)
+{
+    auto writer = CaptureWriter::open(capture_file);
+    if (not writer.has_value())
+    {
+        return std::unexpected(writer.error());
+    }
+    asio::post(strand_, [this, writer = std::make_unique<CaptureWriter>(std::move(writer.value()))]() mutable {
+        capture_ = std::move(writer);
+    });
+    return Result<void>{};
+}
+
+void ApiConnection::stop_capture()
+{
+    asio::post(strand_, [this]() { capture_.reset(); });
+}
+
+void ApiConnection::set_entity_interest(std::vector<std::uint32_t> keys)
+{
+    asio::post(strand_, [this, keys = std::move(keys)]() mutable { entity_interest_.set(std::move(keys)); });
+}
+
+void ApiConnection::clear_entity_interest()
+{
+    asio::post(strand_, [this]() { entity_interest_.clear(); });
+}
+
+void ApiConnection::process_frame(const Frame &frame, std::chrono::steady_clock::time_point read_at)
+{
+    if (not entity_interest_.accepts(frame))
+    {
+        metrics_.record_filtered_message();
+        return;
+    }
+    const bool traced = tracer_.load(std::memory_order_acquire) != nullptr;
+    if (frame.message_type == detail::get_message_id<proto::VoiceAssistantAudio>() and voice_assistant_ != nullptr and
+        not traced)
+    {
+        // microphone audio is copied once, straight from the receive buffer into the pooled blocks of the session.
+        if (const auto audio = decode_voice_assistant_audio(frame.payload); audio.has_value())
+        {
+            voice_assistant_->on_device_audio(audio->data, audio->end);
+            record_decoded(Result<void>{}, true, read_at, frame.message_type);
+            return;
+        }
+    }
+    const auto stamp_decoded = [traced, read_at](MessageWrapper &message) {
+        if (traced)
+        {
+            message.timestamps().read_at = read_at;
+            message.timestamps().decoded_at = Clock::now();
+        }
+    };
+    if (decode_strand_.has_value())
+    {
+        // the decode strand keeps the order of the frames, dispatching them on the connection strand keeps the
+        // handlers confined to it. The payload leaves the receive buffer in a pooled block, views share that block.
+        asio::post(*decode_strand_,
+                   [this,
+                    read_at,
+                    stamp_decoded,
+                    message_type = frame.message_type,
+                    payload = frame_pool_->pin(frame.payload)]() {
+                       bool dispatched{false};
+                       const auto dispatch_on_strand = [this, &dispatched, &stamp_decoded](MessageWrapper message) {
+                           dispatched = true;
+                           stamp_decoded(message);
+                           asio::post(strand_, [this, message = std::move(message)]() mutable {
+                               dispatch_message(std::move(message));
+                           });
+                       };
+                       const auto decoded = decode_received_frame(
+                           Frame{.message_type = message_type, .payload = *payload},
+                           *message_pool_,
+                           *frame_pool_,
+                           dispatch_on_strand,
+                           payload);
+                       record_decoded(decoded, dispatched, read_at, message_type);
+                   });
+        return;
+    }
+
+    bool dispatched{false};
+    const auto dispatch = [this, &dispatched, &stamp_decoded](MessageWrapper message) {
+        dispatched = true;
+        stamp_decoded(message);
+        dispatch_message(std::move(message));
+    };
+    const auto decoded = decode_received_frame(frame, *message_pool_, *frame_pool_, dispatch);
+    record_decoded(decoded, dispatched, read_at, frame.message_type);
+}
+
+void ApiConnection::record_decoded(const Result<void> &decoded,
+                                   bool dispatched,
+                                   std::chrono::steady_clock::time_point read_at,
+                                   std::uint32_t message_type)
+{
+    if (not decoded.has_value())
+    {
+        metrics_.record_parse_error();
+        LOG_WARNING("Could not decode message {}. Error {}", message_type, decoded.error().message);
+    }
+    else if (not dispatched)
+    {
+        metrics_.record_skipped_message();
+    }
+    else
+    {
+        metrics_.record_dispatch_latency(Clock::now() - read_at);
+    }
+}
+
+void ApiConnection::cancel_handler(std::uint64_t handler_id)
+{
+    const auto it = std::ranges::find(handlers_, handler_id, &PendingHandler::id);
+    if (it == handlers_.end())
+    {
+        return;
+    }
+    auto handler = std::move(it->handler);
+    handlers_.erase(it);
+    pending_handlers_.store(handlers_.size(), std::memory_order_relaxed);
+
+    // called from within the cancellation slot, so the completion is posted instead of invoked inline.
+    auto work = boost::asio::make_work_guard(handler);
+    auto alloc = boost::asio::get_associated_allocator(handler, boost::asio::recycling_allocator<void>());
+    boost::asio::post(work.get_executor(),
+                      boost::asio::bind_allocator(alloc, [handler = std::move(handler)]() mutable {
+                          std::move(handler)(boost::asio::error::operation_aborted, MessageWrapper{});
+                      }));
+}
+
+std::size_t ApiConnection::pending_receive_handlers() const
+{
+    return pending_handlers_.load(std::memory_order_relaxed);
+}
+
+void ApiConnection::dispatch_message(MessageWrapper message)
+{
+    if (auto *tracer = tracer_.load(std::memory_order_acquire); tracer != nullptr)
+    {
+        message.timestamps().dispatched_at = Clock::now();
+        tracer->dispatched(message);
+    }
+    if (const auto *audio = message.get_if<proto::VoiceAssistantAudio>(); audio != nullptr)
+    {
+        // microphone audio is streamed into the session buffers, no handler waits for the single chunks. Only traced
+        // or unusual payloads take this way, the others are copied from the frame by process_frame.
+        if (voice_assistant_ != nullptr)
+        {
+            voice_assistant_->on_device_audio(std::as_bytes(std::span{audio->data()}), audio->end());
+        }
+        return;
+    }
+
+    LOG_TRACE("Received message {}", message.message_id());
+
+    if (handlers_.empty())
+    {
+        metrics_.record_unclaimed_message();
+    }
+    // handlers registered while dispatching wait for the next message. Swapping with the scratch vector keeps the
+    // capacity of both vectors, so dispatching does not allocate.
+    dispatching_handlers_.swap(handlers_);
+    pending_handlers_.store(0, std::memory_order_relaxed);
+    // todo: add small ring buffer if the handlers are empty or try to return the
+    // acceptance from the handler.
+    for (std::size_t i = 0; i < dispatching_handlers_.size(); i++)
+    {
+        auto &handler = dispatching_handlers_[i].handler;
+        // the operation completes now, a later cancellation must not find it anymore.
+        boost::asio::get_associated_cancellation_slot(handler).clear();
+        auto work = boost::asio::make_work_guard(handler);
+        auto alloc = boost::asio::get_associated_allocator(handler, boost::asio::recycling_allocator<void>());
+
+        // the last handler takes over the message, only the others need a reference of their own.
+        auto result = i + 1 == dispatching_handlers_.size() ? std::move(message) : message.share();
+
+        // Dispatch the completion handler through the handler's associated
+        // executor, using the handler's associated allocator.
+        boost::asio::dispatch(
+            work.get_executor(),
+            boost::asio::bind_allocator(alloc, [handler = std::move(handler), result = std::move(result)]() mutable {
+                std::move(handler)(net::ErrorCode{}, std::move(result));
+            }));
+    }
+    dispatching_handlers_.clear();
 }
 
 boost::asio::awaitable<void> ApiConnection::heartbeat_loop()
 {
     auto executor = co_await this_coro::executor;
-    asio::steady_timer timer{executor};
-    const auto watch_dog = executor::abort(timer);
-    while (not executor::stopAssetOf(executor).stop_requested())
-    {
-        timer.expires_after(std::chrono::seconds{20});
-        co_await timer.async_wait();
-        proto::PingRequest request;
-        co_await send_message(request);
+    net::Timer timer{executor};
+    const auto watch_dog = executor::abort(stop_.get_token(), timer);
+    while (not stop_.stop_requested())
+    {
+        timer.expires_after(kHeartbeatInterval);
+        if (not co_await net::expired(timer))
+        {
+            break;
+        }
+        proto::PingRequest ping_request;
         // todo: this should be in a different coroutine and only expect a response at the minimum of 20sec*4.5
         // otherwise the connection is dead.
-        co_await receive_message<proto::PingResponse>(asio::use_awaitable);
+        co_await request_response<proto::PingResponse>(ping_request, SendPriority::Control);
     }
 }
 
@@ -1,10 +1,23 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <concepts>
 #include <cstdint>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stop_token>
 #include <string>
+#include <vector>
 #include <boost/asio/any_completion_handler.hpp>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/associated_cancellation_slot.hpp>
+#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/executor.hpp>
 #include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <google/protobuf/message.h>
@@ -12,15 +25,40 @@
 #include "cppesphomeapi/api_client.hpp"
 #include "cppesphomeapi/api_version.hpp"
 #include "cppesphomeapi/async_result.hpp"
+#include "cppesphomeapi/command_submission.hpp"
 #include "cppesphomeapi/commands.hpp"
+#include "cppesphomeapi/connection_metrics.hpp"
+#include "cppesphomeapi/deadline.hpp"
 #include "cppesphomeapi/device_info.hpp"
+#include "cppesphomeapi/traffic_capture.hpp"
+#include "cppesphomeapi/voice_assistant.hpp"
+#include "command_queue.hpp"
+#include "entity_interest.hpp"
+#include "get_message_id.hpp"
 #include "make_unexpected_result.hpp"
+#include "message_pool.hpp"
+#include "message_tracer.hpp"
 #include "message_wrapper.hpp"
+#include "metrics_recorder.hpp"
 #include "net.hpp"
 #include "overloaded.hpp"
+#include "packet_buffer_pool.hpp"
+#include "plain_text_protocol.hpp"
+#include "received_frame_pool.hpp"
+#include "rtt_estimator.hpp"
+#include "send_scheduler.hpp"
+#include "traffic_capture.hpp"
+#include "voice_assistant_session.hpp"
 
 namespace cppesphomeapi
 {
+/**
+ * All members are confined to the connection strand. Public coroutines must be started through run(), which spawns
+ * them onto the strand and resumes the awaiting coroutine on its own executor.
+ * Only api_version(), device_name(), pending_receive_handlers(), submit_command(), send_metrics(), metrics(),
+ * message_latencies(), chrome_trace(), start_capture(), stop_capture(), set_entity_interest(), clear_entity_interest()
+ * and cancel() may be called from any thread.
+ */
 class ApiConnection
 {
   public:
@@ -31,91 +69,231 @@ class ApiConnection
                            const boost::asio::any_io_executor &executor);
 
     AsyncResult<void> connect();
+    AsyncResult<DeviceSnapshot> connect_pipelined();
     AsyncResult<void> disconnect();
     AsyncResult<void> send_message_hello();
     AsyncResult<void> send_message_connect();
     AsyncResult<DeviceInfo> request_device_info();
     AsyncResult<EntityInfoList> request_entities_and_services();
     AsyncResult<void> light_command(LightCommand light_command);
-    const std::optional<ApiVersion> &api_version() const;
-    const std::string &device_name() const;
+    AsyncResult<void> execute_service(ServiceCall call);
+    AsyncResult<void> execute_services(std::span<const ServiceCall> calls);
+    std::optional<ApiVersion> api_version() const;
+    std::string device_name() const;
     AsyncResult<void> enable_logs(EspHomeLogLevel log_level, bool config_dump);
     AsyncResult<LogEntry> receive_log();
+    AsyncResult<LogEntryView> receive_log_view();
+    AsyncResult<TextSensorStateView> receive_text_sensor_state_view();
     AsyncResult<void> subscribe_states();
     AsyncResult<EntityStateVariant> receive_state();
+    AsyncResult<void> subscribe_voice_assistant(VoiceAssistantConfig config);
+    AsyncResult<void> unsubscribe_voice_assistant();
+    AsyncResult<VoiceAssistantRequest> receive_voice_assistant_request();
+    AsyncResult<void> send_voice_assistant_response(bool error);
+    AsyncResult<void> send_voice_assistant_event(VoiceAssistantEvent event, std::vector<VoiceAssistantEventData> data);
+    AsyncResult<AudioBlock> receive_voice_audio();
+    AsyncResult<void> send_voice_audio(std::span<const std::byte> pcm, bool end);
+    AsyncResult<void> request_camera_image(bool stream);
+    AsyncResult<CameraImage> receive_camera_image();
+    // feeds the recorded bytes through framing, decoding and dispatching as if they were received.
+    AsyncResult<void> replay(std::filesystem::path capture_file, ReplayPace pace);
 
+    // thread safe, the connection is stopped on the strand.
     void cancel();
+    // stops the connection and completes once every loop spawned for it finished. The connection may be destroyed
+    // afterwards.
+    AsyncResult<void> shutdown();
+    // thread safe and lock free.
+    bool submit_command(SubmittedCommand command, CommandCallback callback);
+    SendMetrics send_metrics() const;
+    ConnectionMetrics metrics() const;
+    std::size_t pending_receive_handlers() const;
+    Result<void> start_capture(const std::filesystem::path &capture_file);
+    void stop_capture();
+    // thread safe, applied on the strand to the frames processed afterwards.
+    void set_entity_interest(std::vector<std::uint32_t> keys);
+    void clear_entity_interest();
+    // precondition: called before connect()
+    void set_decode_executor(const boost::asio::any_io_executor &executor);
+    // precondition: called before connect() or replay()
+    void enable_message_tracing(TraceOptions options);
+    // empty if tracing is not enabled.
+    std::vector<MessageLatencies> message_latencies() const;
+    std::string chrome_trace() const;
+
+    template <typename T>
+    AsyncResult<T> run(AsyncResult<T> operation, OptionalDeadline deadline = std::nullopt)
+    {
+        if (not deadline.has_value())
+        {
+            co_return co_await boost::asio::co_spawn(strand_, std::move(operation), boost::asio::use_awaitable);
+        }
+        using boost::asio::experimental::awaitable_operators::operator||;
+        // the expired deadline cancels the spawned operation and with it every nested step it currently awaits.
+        net::Timer timer{co_await boost::asio::this_coro::executor, *deadline};
+        auto result_or_deadline =
+            co_await (boost::asio::co_spawn(strand_, std::move(operation), boost::asio::use_awaitable) ||
+                      timer.async_wait());
+        if (std::holds_alternative<std::tuple<net::ErrorCode>>(result_or_deadline))
+        {
+            co_return make_unexpected_result(ApiErrorCode::DeadlineExceeded, "Deadline exceeded");
+        }
+        co_return std::get<Result<T>>(std::move(result_or_deadline));
+    }
 
   private:
-    AsyncResult<void> send_message(const google::protobuf::Message &message);
+    struct MessageInbox;
+
+    // the id of the message is taken from its generated traits, see PlainTextProtocol::serialize_to.
+    template <typename TMsg>
+    AsyncResult<void> send_message(const TMsg &message, SendPriority priority = SendPriority::Interactive)
+    {
+        return send_message(message, detail::get_message_id<TMsg>(), priority);
+    }
+    AsyncResult<void> send_message(const google::protobuf::Message &message,
+                                   std::uint32_t message_type,
+                                   SendPriority priority);
+    AsyncResult<void> send_packet(std::span<const std::byte> packet, SendPriority priority = SendPriority::Interactive);
 
-    template <boost::asio::completion_token_for<void(MessageWrapper)> CompletionToken>
+    // queues the packet in the lane of its priority. The packet must stay valid until the operation completed.
+    template <boost::asio::completion_token_for<SendScheduler::SendSignature> CompletionToken>
+    auto async_enqueue_send(SendPriority priority, std::span<const std::byte> packet, CompletionToken &&token)
+    {
+        auto init = [this, priority, packet](
+                        boost::asio::completion_handler_for<SendScheduler::SendSignature> auto handler) {
+            auto slot = boost::asio::get_associated_cancellation_slot(handler);
+            const auto send_id = send_scheduler_.push(priority, packet, std::move(handler));
+            if (slot.is_connected())
+            {
+                // a packet that is not written yet is dropped when the sender gives up, e.g. at its deadline.
+                slot.assign([this, send_id](boost::asio::cancellation_type_t /*type*/) { cancel_send(send_id); });
+            }
+            send_wake_timer_.cancel();
+        };
+        return boost::asio::async_initiate<CompletionToken, SendScheduler::SendSignature>(init, token);
+    }
+
+    // sends the request and waits for its response. The round trip time feeds the adaptive timeout.
+    template <typename TResponse, typename TRequest>
+    auto request_response(const TRequest &request, SendPriority priority = SendPriority::Interactive)
+        -> AsyncResult<std::shared_ptr<TResponse>>
+    {
+        const auto sent_at = Clock::now();
+        const auto sent = co_await send_message(request, priority);
+        if (not sent.has_value())
+        {
+            co_return std::unexpected(sent.error());
+        }
+        using boost::asio::experimental::awaitable_operators::operator||;
+        // only a request awaits a response, unsolicited messages are bound by the deadline of the caller alone.
+        net::Timer timer{co_await boost::asio::this_coro::executor, rtt_.timeout()};
+        auto response_or_timeout = co_await (receive_message<TResponse>() || timer.async_wait());
+        if (std::holds_alternative<std::tuple<net::ErrorCode>>(response_or_timeout))
+        {
+            co_return make_unexpected_result(
+                ApiErrorCode::ResponseTimeout,
+                std::format("no {} within {}",
+                            TResponse::GetDescriptor()->name(),
+                            std::chrono::duration_cast<std::chrono::milliseconds>(rtt_.timeout())));
+        }
+        auto response = std::get<Result<std::shared_ptr<TResponse>>>(std::move(response_or_timeout));
+        if (response.has_value())
+        {
+            add_rtt_sample(Clock::now() - sent_at);
+        }
+        co_return response;
+    }
+
+    using ReceiveSignature = void(net::ErrorCode, MessageWrapper);
+
+    template <boost::asio::completion_token_for<ReceiveSignature> CompletionToken>
     auto async_receive_message(CompletionToken &&token)
     {
-        auto init = [this](boost::asio::completion_handler_for<void(MessageWrapper)> auto handler) {
-            std::unique_lock l{handler_mtx_};
-            handlers_.emplace_back(std::move(handler));
+        auto init = [this](boost::asio::completion_handler_for<ReceiveSignature> auto handler) {
+            const auto handler_id = next_handler_id_++;
+            auto slot = boost::asio::get_associated_cancellation_slot(handler);
+            if (slot.is_connected())
+            {
+                // remove the handler as soon as the waiting operation is abandoned, e.g. by a timeout.
+                slot.assign([this, handler_id](boost::asio::cancellation_type_t /*type*/) {
+                    cancel_handler(handler_id);
+                });
+            }
+            handlers_.emplace_back(PendingHandler{.id = handler_id, .handler = std::move(handler)});
+            pending_handlers_.store(handlers_.size(), std::memory_order_relaxed);
         };
-        return boost::asio::async_initiate<CompletionToken, void(MessageWrapper)>(init, token);
+        return boost::asio::async_initiate<CompletionToken, ReceiveSignature>(init, token);
     }
 
     template <typename TMsg>
-    auto receive_message(auto &&completion_token) -> AsyncResult<std::shared_ptr<TMsg>>
+    auto receive_message() -> AsyncResult<std::shared_ptr<TMsg>>
+    {
+        co_return co_await receive_converted<std::shared_ptr<TMsg>>(
+            [](MessageWrapper &message) -> std::optional<std::shared_ptr<TMsg>> {
+                if (not message.template holds_message<TMsg>())
+                {
+                    return std::nullopt;
+                }
+                return std::move(message).template as<TMsg>();
+            });
+    }
+
+    // receives messages until the converter accepts one or receiving is aborted.
+    template <typename TResult>
+    auto receive_converted(std::invocable<MessageWrapper &> auto convert) -> AsyncResult<TResult>
     {
-        namespace aex = boost::asio::experimental;
-        using aex::awaitable_operators::operator||;
-        auto executor = co_await boost::asio::this_coro::executor;
-        net::Timer timer{executor};
-        timer.expires_after(std::chrono::milliseconds{250});
         while (true)
         {
-            //! TODO: the added handler might get aborted. How to remove it from the vector holding the completion
-            //! handlers?
-            const auto received_message_or_error =
-                co_await (async_receive_message(std::forward<decltype(completion_token)>(completion_token)) ||
-                          timer.async_wait());
-            if (std::holds_alternative<std::tuple<net::ErrorCode>>(received_message_or_error))
+            auto [error, received_message] =
+                co_await async_receive_message(boost::asio::as_tuple(boost::asio::use_awaitable));
+            if (error)
             {
                 break;
             }
-            auto &&received_message = std::get<cppesphomeapi::MessageWrapper>(received_message_or_error);
-            if (received_message.template holds_message<TMsg>())
+            if (auto converted = convert(received_message); converted.has_value())
             {
-                co_return received_message.template as<TMsg>();
+                trace_consumed(received_message);
+                co_return std::move(converted).value();
             }
         }
         co_return make_unexpected_result(ApiErrorCode::UnexpectedMessage, "could not receive any message");
     }
 
     template <typename TMsg>
-    static constexpr bool handle_message_impl(const auto &visitor, const MessageWrapper &wrapper)
+    static constexpr bool handle_message_impl(const auto &visitor, MessageWrapper &wrapper)
     {
         if (not wrapper.holds_message<TMsg>())
         {
             return false;
         }
-        visitor(wrapper.as<TMsg>());
+        visitor(std::move(wrapper).template as<TMsg>());
         return true;
     }
+    // hands the message to the visitor as a shared_ptr of its type, moving it out of the wrapper.
     template <typename... TMsgs>
-    static constexpr void handle_messages(auto &&visitor, const MessageWrapper &wrapper)
+    static constexpr void handle_messages(auto &&visitor, MessageWrapper &wrapper)
     {
         (handle_message_impl<TMsgs>(visitor, wrapper) || ...);
     }
 
     template <typename... TMsgs>
-    auto receive_any_message(auto &&comletion_token) -> AsyncResult<std::variant<std::shared_ptr<TMsgs>...>>
+    auto receive_any_message() -> AsyncResult<std::variant<std::shared_ptr<TMsgs>...>>
     {
         while (true)
         {
-            const MessageWrapper message =
-                co_await async_receive_message(std::forward<decltype(comletion_token)>(comletion_token));
+            auto [error, message] = co_await async_receive_message(boost::asio::as_tuple(boost::asio::use_awaitable));
+            if (error)
+            {
+                co_return make_unexpected_result(ApiErrorCode::UnexpectedMessage,
+                                                 std::format("Receiving aborted. Error: {}", error.message()));
+            }
 
             const bool accepted_msg = (message.holds_message<TMsgs>() || ...);
             if (not accepted_msg)
             {
                 continue;
             }
+            trace_consumed(message);
             std::variant<std::shared_ptr<TMsgs>...> result;
             handle_messages<TMsgs...>([&result](auto &&msg) { result = std::forward<decltype(msg)>(msg); }, message);
             co_return result;
@@ -125,7 +303,7 @@ class ApiConnection
     }
 
     template <typename TStopMsg, typename... TMsgs>
-    auto receive_messages(auto &&comletion_token) -> AsyncResult<std::vector<std::variant<std::shared_ptr<TMsgs>...>>>
+    auto receive_messages() -> AsyncResult<std::vector<std::variant<std::shared_ptr<TMsgs>...>>>
     {
         std::vector<std::variant<std::shared_ptr<TMsgs>...>> messages;
         messages.reserve(sizeof...(TMsgs)); // at least enough space to receive each message once.
@@ -133,8 +311,7 @@ class ApiConnection
         bool do_receive{true};
         while (do_receive)
         {
-            const auto any_message = co_await receive_any_message<TStopMsg, TMsgs...>(
-                std::forward<decltype(comletion_token)>(comletion_token));
+            const auto any_message = co_await receive_any_message<TStopMsg, TMsgs...>();
             if (not any_message)
             {
                 co_return std::unexpected{any_message.error()};
@@ -148,21 +325,115 @@ class ApiConnection
         co_return messages;
     }
 
-  private:
+    // spawns the loop onto the strand and counts it until it finished.
+    template <typename... TArgs>
+    void commission(boost::asio::awaitable<void> (ApiConnection::*loop)(TArgs...), TArgs... args);
+    AsyncResult<void> open_socket();
+    void add_rtt_sample(RttEstimator::Duration rtt);
+    // forwards every dispatched message into the inbox until the inbox is destroyed.
+    void forward_to_inbox(const std::shared_ptr<MessageInbox> &inbox);
+    void cancel_handler(std::uint64_t handler_id);
+    void cancel_send(std::uint64_t send_id);
+    boost::asio::awaitable<void> send_writer_loop();
     boost::asio::awaitable<void> receive_loop();
+    // processes the complete frames of the buffer. Returns the number of bytes of the incomplete frame that was moved
+    // to the front of the buffer. The buffer is grown to fit that frame. A broken header, including a frame above
+    // PlainTextProtocol::kMaxFrameSize, is an error: the stream can not be resynchronized and has to be closed.
+    Result<std::size_t> process_received(std::vector<std::byte> &buffer,
+                                         std::size_t buffered,
+                                         std::chrono::steady_clock::time_point read_at);
+    void process_frame(const Frame &frame, std::chrono::steady_clock::time_point read_at);
+    // called by the decoder, on the decode strand if there is one.
+    void record_decoded(const Result<void> &decoded,
+                        bool dispatched,
+                        std::chrono::steady_clock::time_point read_at,
+                        std::uint32_t message_type);
+    void dispatch_message(MessageWrapper message);
+    void trace_consumed(const MessageWrapper &message);
     boost::asio::awaitable<void> heartbeat_loop();
+    boost::asio::awaitable<void> command_writer_loop();
+    Result<void> serialize_command(const SubmittedCommand &command, std::vector<std::byte> &batch);
+    bool uses_legacy_int_arguments() const;
+    boost::asio::awaitable<void> voice_playback_loop(std::shared_ptr<VoiceAssistantSession> session);
 
   private:
     std::string hostname_;
     std::uint16_t port_;
     std::string password_;
     boost::asio::strand<boost::asio::any_io_executor> strand_;
+    std::optional<boost::asio::strand<boost::asio::any_io_executor>> decode_strand_;
     net::Socket socket_;
 
+    // written on the strand, guarded to allow reads from any thread.
+    mutable std::mutex device_mtx_;
     std::string device_name_;
     std::optional<ApiVersion> api_version_;
 
-    mutable std::mutex handler_mtx_;
-    std::vector<boost::asio::any_completion_handler<void(MessageWrapper)>> handlers_;
+    struct PendingHandler
+    {
+        std::uint64_t id{};
+        boost::asio::any_completion_handler<ReceiveSignature> handler;
+    };
+    std::uint64_t next_handler_id_{};
+    std::vector<PendingHandler> handlers_;
+    std::vector<PendingHandler> dispatching_handlers_;
+    // mirrors handlers_.size() for readers outside of the strand.
+    std::atomic<std::size_t> pending_handlers_{};
+
+    std::shared_ptr<VoiceAssistantSession> voice_assistant_;
+    RttEstimator rtt_;
+    MetricsRecorder metrics_;
+    // the tracer that records the received messages, null if they are not traced. Read from the strands and from the
+    // threads that ask for the latencies, so it is published through an atomic.
+    std::atomic<MessageTracer *> tracer_{nullptr};
+    // owns every tracer that was enabled. A replaced one may still be read by a message in flight, so it is kept until
+    // the connection goes away.
+    std::mutex tracers_mutex_;
+    std::vector<std::unique_ptr<MessageTracer>> tracers_;
+    // records the received bytes while set.
+    std::unique_ptr<CaptureWriter> capture_;
+    EntityInterest entity_interest_;
+    std::shared_ptr<MessagePool> message_pool_;
+    // pins the frames of received logs and text sensor states for their views.
+    std::shared_ptr<ReceivedFramePool> frame_pool_;
+    std::shared_ptr<PacketBufferPool> packet_pool_;
+
+    CommandQueue command_queue_;
+    // set by the command writer before it waits for new commands.
+    std::atomic<bool> command_writer_idle_{false};
+    net::Timer command_wake_timer_;
+    // reused by the command writer for every submitted command, and by light_command(). Cleared and serialized
+    // without a suspension in between, so they keep the capacity of their strings.
+    proto::LightCommandRequest command_light_request_;
+    proto::ExecuteServiceRequest command_service_request_;
+
+    SendScheduler send_scheduler_;
+    // cancelled whenever a packet is queued.
+    net::Timer send_wake_timer_;
+
+    // the stop callbacks close the socket and cancel the timers of the loops, so the stop is requested on the strand
+    // even if cancel() or the stop source of the caller is called from another thread.
+    struct RequestStop
+    {
+        boost::asio::strand<boost::asio::any_io_executor> strand;
+        std::stop_source stop;
+        void operator()() noexcept
+        {
+            boost::asio::post(strand, [stop = stop]() mutable { stop.request_stop(); });
+        }
+    };
+    // stopped by cancel() and by the stop source passed by the caller, but only stops this connection.
+    std::stop_source stop_;
+    std::stop_callback<RequestStop> caller_stop_;
+    // the loops spawned by commission(), confined to the strand.
+    std::size_t running_loops_{};
+    // cancelled when the last loop finished.
+    net::Timer loops_done_timer_;
+    // the send writer, heartbeat and command writer loops are spawned by the first connect only.
+    bool loops_started_{false};
+    // a receive loop is spawned per connect and runs until its socket is closed.
+    bool receiving_{false};
+    // cancelled when the receive loop finished.
+    net::Timer receive_done_timer_;
 };
 } // namespace cppesphomeapi
@@ -0,0 +1,30 @@
+#include "atomic_histogram.hpp"
+#include <algorithm>
+
+namespace cppesphomeapi
+{
+void AtomicHistogram::record(std::chrono::steady_clock::duration duration)
+{
+    const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+    // only a single writer, so there is no need for a locked read-modify-write.
+    auto &bucket = buckets_[LatencyHistogram::bucket_of(duration_ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_ns_.store(sum_ns_.load(std::memory_order_relaxed) + duration_ns.count(), std::memory_order_relaxed);
+    max_ns_.store(std::max(max_ns_.load(std::memory_order_relaxed), duration_ns.count()), std::memory_order_relaxed);
+}
+
+LatencyHistogram AtomicHistogram::snapshot() const
+{
+    LatencyHistogram histogram{
+        .count = count_.load(std::memory_order_relaxed),
+        .sum = std::chrono::nanoseconds{sum_ns_.load(std::memory_order_relaxed)},
+        .max = std::chrono::nanoseconds{max_ns_.load(std::memory_order_relaxed)},
+    };
+    for (std::size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; bucket++)
+    {
+        histogram.buckets[bucket] = buckets_[bucket].load(std::memory_order_relaxed);
+    }
+    return histogram;
+}
+} // namespace cppesphomeapi
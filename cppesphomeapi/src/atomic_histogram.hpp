@@ -0,0 +1,23 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "cppesphomeapi/connection_metrics.hpp"
+
+namespace cppesphomeapi
+{
+// the recording side of a LatencyHistogram. Single writer, snapshot() may be called from any thread.
+class AtomicHistogram
+{
+  public:
+    void record(std::chrono::steady_clock::duration duration);
+    [[nodiscard]] LatencyHistogram snapshot() const;
+
+  private:
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBucketCount> buckets_{};
+    std::atomic<std::uint64_t> count_{};
+    std::atomic<std::int64_t> sum_ns_{};
+    std::atomic<std::int64_t> max_ns_{};
+};
+} // namespace cppesphomeapi
@@ -0,0 +1,129 @@
+#include "audio_block_pool.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace cppesphomeapi
+{
+AudioBlock::AudioBlock(std::shared_ptr<AudioBlockPool> pool, std::span<std::byte> storage)
+    : pool_{std::move(pool)}
+    , storage_{storage}
+{}
+
+AudioBlock::~AudioBlock()
+{
+    release();
+}
+
+AudioBlock::AudioBlock(AudioBlock &&other) noexcept
+    : pool_{std::move(other.pool_)}
+    , storage_{std::exchange(other.storage_, {})}
+    , size_{std::exchange(other.size_, 0)}
+    , end_{std::exchange(other.end_, false)}
+{}
+
+AudioBlock &AudioBlock::operator=(AudioBlock &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool_ = std::move(other.pool_);
+        storage_ = std::exchange(other.storage_, {});
+        size_ = std::exchange(other.size_, 0);
+        end_ = std::exchange(other.end_, false);
+    }
+    return *this;
+}
+
+std::span<const std::byte> AudioBlock::data() const
+{
+    return storage_.first(size_);
+}
+
+std::size_t AudioBlock::capacity() const
+{
+    return storage_.size();
+}
+
+bool AudioBlock::full() const
+{
+    return size_ == storage_.size();
+}
+
+bool AudioBlock::end() const
+{
+    return end_;
+}
+
+std::size_t AudioBlock::append(std::span<const std::byte> bytes)
+{
+    const auto count = std::min(bytes.size(), storage_.size() - size_);
+    std::ranges::copy(bytes.first(count), std::next(storage_.begin(), static_cast<std::ptrdiff_t>(size_)));
+    size_ += count;
+    return count;
+}
+
+void AudioBlock::mark_end()
+{
+    end_ = true;
+}
+
+void AudioBlock::release()
+{
+    if (pool_ != nullptr)
+    {
+        pool_->recycle(storage_);
+        pool_.reset();
+    }
+    storage_ = {};
+    size_ = 0;
+    end_ = false;
+}
+
+std::shared_ptr<AudioBlockPool> AudioBlockPool::create(std::size_t block_size, std::size_t block_count)
+{
+    return std::shared_ptr<AudioBlockPool>{new AudioBlockPool{block_size, block_count}};
+}
+
+AudioBlockPool::AudioBlockPool(std::size_t block_size, std::size_t block_count)
+    : block_size_{block_size}
+    , storage_(block_size * block_count)
+{
+    free_blocks_.reserve(block_count);
+    for (std::size_t i = 0; i < block_count; i++)
+    {
+        free_blocks_.emplace_back(std::next(storage_.data(), static_cast<std::ptrdiff_t>(i * block_size)));
+    }
+}
+
+std::optional<AudioBlock> AudioBlockPool::acquire()
+{
+    std::byte *block{};
+    {
+        std::unique_lock l{mtx_};
+        if (free_blocks_.empty())
+        {
+            return std::nullopt;
+        }
+        block = free_blocks_.back();
+        free_blocks_.pop_back();
+    }
+    return AudioBlock{shared_from_this(), std::span{block, block_size_}};
+}
+
+void AudioBlockPool::recycle(std::span<std::byte> storage)
+{
+    std::unique_lock l{mtx_};
+    free_blocks_.emplace_back(storage.data());
+}
+
+std::size_t AudioBlockPool::block_size() const
+{
+    return block_size_;
+}
+
+std::size_t AudioBlockPool::available() const
+{
+    std::unique_lock l{mtx_};
+    return free_blocks_.size();
+}
+} // namespace cppesphomeapi
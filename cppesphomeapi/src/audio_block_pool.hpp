@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+#include "cppesphomeapi/voice_assistant.hpp"
+
+namespace cppesphomeapi
+{
+class AudioBlockPool : public std::enable_shared_from_this<AudioBlockPool>
+{
+  public:
+    static std::shared_ptr<AudioBlockPool> create(std::size_t block_size, std::size_t block_count);
+
+    std::optional<AudioBlock> acquire();
+    void recycle(std::span<std::byte> storage);
+    std::size_t block_size() const;
+    std::size_t available() const;
+
+  private:
+    AudioBlockPool(std::size_t block_size, std::size_t block_count);
+
+  private:
+    std::size_t block_size_;
+    std::vector<std::byte> storage_;
+    mutable std::mutex mtx_;
+    std::vector<std::byte *> free_blocks_;
+};
+} // namespace cppesphomeapi
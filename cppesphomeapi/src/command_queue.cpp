@@ -0,0 +1,65 @@
+#include "command_queue.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace cppesphomeapi
+{
+CommandQueue::CommandQueue(std::size_t capacity)
+    : mask_{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1}
+    , slots_{std::make_unique<Slot[]>(mask_ + 1)}
+{
+    for (std::size_t i = 0; i <= mask_; i++)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool CommandQueue::try_push(Entry &entry)
+{
+    auto position = enqueue_position_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto &slot = slots_[position & mask_];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0)
+        {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.entry.emplace(std::move(entry));
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the consumer did not free the slot yet, the queue is full.
+            return false;
+        }
+        else
+        {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::optional<CommandQueue::Entry> CommandQueue::try_pop()
+{
+    auto &slot = slots_[dequeue_position_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1)
+    {
+        return std::nullopt;
+    }
+    std::optional<Entry> entry{std::move(slot.entry)};
+    slot.entry.reset();
+    slot.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+    dequeue_position_++;
+    return entry;
+}
+
+bool CommandQueue::empty() const
+{
+    return slots_[dequeue_position_ & mask_].sequence.load(std::memory_order_acquire) != dequeue_position_ + 1;
+}
+} // namespace cppesphomeapi
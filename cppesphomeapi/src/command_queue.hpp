@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include "cppesphomeapi/command_submission.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * Bounded lock-free queue with many producers and a single consumer (Vyukov's bounded queue).
+ * try_push may be called from any thread, try_pop and empty only from the consumer.
+ */
+class CommandQueue
+{
+  public:
+    struct Entry
+    {
+        SubmittedCommand command;
+        CommandCallback callback;
+    };
+
+    // the capacity is rounded up to the next power of two.
+    explicit CommandQueue(std::size_t capacity);
+
+    // entry is only moved from if it was queued.
+    bool try_push(Entry &entry);
+    std::optional<Entry> try_pop();
+    bool empty() const;
+
+  private:
+    static constexpr std::size_t kCacheLineSize = 64;
+
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        std::optional<Entry> entry;
+    };
+
+    std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(kCacheLineSize) std::atomic<std::size_t> enqueue_position_{};
+    alignas(kCacheLineSize) std::size_t dequeue_position_{};
+};
+} // namespace cppesphomeapi
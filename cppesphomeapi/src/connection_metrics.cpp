@@ -0,0 +1,74 @@
+#include "cppesphomeapi/connection_metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+
+namespace cppesphomeapi
+{
+std::size_t LatencyHistogram::bucket_of(std::chrono::nanoseconds duration)
+{
+    const auto first_bound_ns = std::chrono::nanoseconds{kFirstUpperBound}.count();
+    const auto multiples = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0) / first_bound_ns);
+    return std::min<std::size_t>(std::bit_width(multiples), kBucketCount - 1);
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double fraction) const
+{
+    if (count == 0)
+    {
+        return std::chrono::microseconds{};
+    }
+    const auto rank = std::max<std::uint64_t>(
+        static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count))), 1);
+    std::uint64_t seen{};
+    for (std::size_t bucket = 0; bucket < kBucketCount; bucket++)
+    {
+        seen += buckets[bucket];
+        if (seen >= rank)
+        {
+            return upper_bound(bucket);
+        }
+    }
+    return upper_bound(kBucketCount - 1);
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const
+{
+    if (count == 0)
+    {
+        return std::chrono::nanoseconds{};
+    }
+    return sum / static_cast<std::int64_t>(count);
+}
+
+LatencyHistogram &LatencyHistogram::operator+=(const LatencyHistogram &rhs)
+{
+    std::ranges::transform(buckets, rhs.buckets, buckets.begin(), std::plus{});
+    count += rhs.count;
+    sum += rhs.sum;
+    max = std::max(max, rhs.max);
+    return *this;
+}
+
+ConnectionMetrics &ConnectionMetrics::operator+=(const ConnectionMetrics &rhs)
+{
+    bytes_received += rhs.bytes_received;
+    bytes_sent += rhs.bytes_sent;
+    frames_received += rhs.frames_received;
+    frames_sent += rhs.frames_sent;
+    std::ranges::transform(messages_received, rhs.messages_received, messages_received.begin(), std::plus{});
+    std::ranges::transform(messages_sent, rhs.messages_sent, messages_sent.begin(), std::plus{});
+    decode_errors += rhs.decode_errors;
+    skipped_messages += rhs.skipped_messages;
+    filtered_messages += rhs.filtered_messages;
+    unclaimed_messages += rhs.unclaimed_messages;
+    connects += rhs.connects;
+    reconnects += rhs.reconnects;
+    pending_receive_handlers += rhs.pending_receive_handlers;
+    send_queue_depth += rhs.send_queue_depth;
+    round_trip_time += rhs.round_trip_time;
+    dispatch_latency += rhs.dispatch_latency;
+    return *this;
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,26 @@
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "message_traits.hpp"
+
+namespace cppesphomeapi::detail
+{
+// the tuple of the messages whose ifdef domain is enabled by the CPPESPHOMEAPI_USE_* cmake options.
+template <typename... TMsgs>
+using EnabledMessages = decltype(std::tuple_cat(
+    std::declval<std::conditional_t<MessageTraits<TMsgs>::enabled, std::tuple<TMsgs>, std::tuple<>>>()...));
+
+// invokes func.template operator()<TMsgs...>() with the message types of the tuple.
+template <typename TTuple>
+struct ApplyMessages;
+
+template <typename... TMsgs>
+struct ApplyMessages<std::tuple<TMsgs...>>
+{
+    static decltype(auto) invoke(auto &&func)
+    {
+        return std::forward<decltype(func)>(func).template operator()<TMsgs...>();
+    }
+};
+} // namespace cppesphomeapi::detail
@@ -44,47 +44,68 @@ EntityInfo pb2entity_info_base(const EntityAlikeMessage auto &entity)
     };
 }
 
+#if CPPESPHOMEAPI_USE_ALARM_CONTROL_PANEL
 EntityInfo pb2entity_info(const proto::ListEntitiesAlarmControlPanelResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesBinarySensorResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_BUTTON
 EntityInfo pb2entity_info(const proto::ListEntitiesButtonResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_ESP32_CAMERA
 EntityInfo pb2entity_info(const proto::ListEntitiesCameraResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_CLIMATE
 EntityInfo pb2entity_info(const proto::ListEntitiesClimateResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_COVER
 EntityInfo pb2entity_info(const proto::ListEntitiesCoverResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_DATE
 EntityInfo pb2entity_info(const proto::ListEntitiesDateResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_DATETIME
 EntityInfo pb2entity_info(const proto::ListEntitiesDateTimeResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_EVENT
 EntityInfo pb2entity_info(const proto::ListEntitiesEventResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_FAN
 EntityInfo pb2entity_info(const proto::ListEntitiesFanResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
 
+#if CPPESPHOMEAPI_USE_LIGHT
 LightEntityInfo pb2entity_info(const proto::ListEntitiesLightResponse &light_response)
 {
     LightEntityInfo entity{
@@ -105,54 +126,85 @@ LightEntityInfo pb2entity_info(const proto::ListEntitiesLightResponse &light_res
 
     return entity;
 }
+#endif
+#if CPPESPHOMEAPI_USE_LOCK
 EntityInfo pb2entity_info(const proto::ListEntitiesLockResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_MEDIA_PLAYER
 EntityInfo pb2entity_info(const proto::ListEntitiesMediaPlayerResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_NUMBER
 EntityInfo pb2entity_info(const proto::ListEntitiesNumberResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_SELECT
 EntityInfo pb2entity_info(const proto::ListEntitiesSelectResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesSensorResponse &response)
 {
     return pb2entity_info_base(response);
 }
-EntityInfo pb2entity_info(const proto::ListEntitiesServicesResponse & /*response*/)
+#endif
+UserService pb2entity_info(const proto::ListEntitiesServicesResponse &response)
 {
-    return {};
+    UserService service{
+        .name = response.name(),
+        .key = response.key(),
+    };
+    service.args.reserve(response.args_size());
+    std::ranges::transform(response.args(), std::back_inserter(service.args), [](auto &&arg) {
+        return UserServiceArg{.name = arg.name(), .type = pb2service_arg_type(arg.type())};
+    });
+    return service;
 }
+#if CPPESPHOMEAPI_USE_SWITCH
 EntityInfo pb2entity_info(const proto::ListEntitiesSwitchResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_TEXT
 EntityInfo pb2entity_info(const proto::ListEntitiesTextResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesTextSensorResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_TIME
 EntityInfo pb2entity_info(const proto::ListEntitiesTimeResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_UPDATE
 EntityInfo pb2entity_info(const proto::ListEntitiesUpdateResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
+#if CPPESPHOMEAPI_USE_VALVE
 EntityInfo pb2entity_info(const proto::ListEntitiesValveResponse &response)
 {
     return pb2entity_info_base(response);
 }
+#endif
 
 ColorMode pb2color_mode(proto::ColorMode color_mode)
 {
@@ -185,4 +237,32 @@ ColorMode pb2color_mode(proto::ColorMode color_mode)
     }
     return ColorMode::Unknown;
 }
+
+ServiceArgType pb2service_arg_type(proto::ServiceArgType arg_type)
+{
+    switch (arg_type)
+    {
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_BOOL:
+        return ServiceArgType::Bool;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_INT:
+        return ServiceArgType::Int;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_FLOAT:
+        return ServiceArgType::Float;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_STRING:
+        return ServiceArgType::String;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_BOOL_ARRAY:
+        return ServiceArgType::BoolArray;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_INT_ARRAY:
+        return ServiceArgType::IntArray;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_FLOAT_ARRAY:
+        return ServiceArgType::FloatArray;
+    case proto::ServiceArgType::SERVICE_ARG_TYPE_STRING_ARRAY:
+        return ServiceArgType::StringArray;
+    // protobuf won't use these as return param but handle them to get warnings if new flags are added.
+    case proto::ServiceArgType::ServiceArgType_INT_MIN_SENTINEL_DO_NOT_USE_:
+    case proto::ServiceArgType::ServiceArgType_INT_MAX_SENTINEL_DO_NOT_USE_:
+        break;
+    }
+    return ServiceArgType::Unknown;
+}
 } // namespace cppesphomeapi
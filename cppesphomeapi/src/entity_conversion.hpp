@@ -1,32 +1,78 @@
 #pragma once
+#include <cppesphomeapi/features.hpp>
 #include "api.pb.h"
 #include "cppesphomeapi/entity.hpp"
 
 namespace cppesphomeapi
 {
+#if CPPESPHOMEAPI_USE_ALARM_CONTROL_PANEL
 EntityInfo pb2entity_info(const proto::ListEntitiesAlarmControlPanelResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesBinarySensorResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_BUTTON
 EntityInfo pb2entity_info(const proto::ListEntitiesButtonResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_ESP32_CAMERA
 EntityInfo pb2entity_info(const proto::ListEntitiesCameraResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_CLIMATE
 EntityInfo pb2entity_info(const proto::ListEntitiesClimateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_COVER
 EntityInfo pb2entity_info(const proto::ListEntitiesCoverResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_DATE
 EntityInfo pb2entity_info(const proto::ListEntitiesDateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_DATETIME
 EntityInfo pb2entity_info(const proto::ListEntitiesDateTimeResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_EVENT
 EntityInfo pb2entity_info(const proto::ListEntitiesEventResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_FAN
 EntityInfo pb2entity_info(const proto::ListEntitiesFanResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_LIGHT
 LightEntityInfo pb2entity_info(const proto::ListEntitiesLightResponse &light_response);
+#endif
+#if CPPESPHOMEAPI_USE_LOCK
 EntityInfo pb2entity_info(const proto::ListEntitiesLockResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_MEDIA_PLAYER
 EntityInfo pb2entity_info(const proto::ListEntitiesMediaPlayerResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_NUMBER
 EntityInfo pb2entity_info(const proto::ListEntitiesNumberResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_SELECT
 EntityInfo pb2entity_info(const proto::ListEntitiesSelectResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesSensorResponse &response);
-EntityInfo pb2entity_info(const proto::ListEntitiesServicesResponse &response);
+#endif
+UserService pb2entity_info(const proto::ListEntitiesServicesResponse &response);
+#if CPPESPHOMEAPI_USE_SWITCH
 EntityInfo pb2entity_info(const proto::ListEntitiesSwitchResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_TEXT
 EntityInfo pb2entity_info(const proto::ListEntitiesTextResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
 EntityInfo pb2entity_info(const proto::ListEntitiesTextSensorResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_DATETIME_TIME
 EntityInfo pb2entity_info(const proto::ListEntitiesTimeResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_UPDATE
 EntityInfo pb2entity_info(const proto::ListEntitiesUpdateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_VALVE
 EntityInfo pb2entity_info(const proto::ListEntitiesValveResponse &response);
+#endif
 
 ColorMode pb2color_mode(proto::ColorMode color_mode);
+ServiceArgType pb2service_arg_type(proto::ServiceArgType arg_type);
 } // namespace cppesphomeapi
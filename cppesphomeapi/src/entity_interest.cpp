@@ -0,0 +1,46 @@
+#include "entity_interest.hpp"
+#include <algorithm>
+#include "message_traits.hpp"
+
+namespace cppesphomeapi
+{
+namespace
+{
+// field number 1 with wire type fixed32.
+constexpr std::byte kEntityKeyTag{(1U << 3U) | 5U};
+constexpr std::size_t kEntityKeySize = 1 + sizeof(std::uint32_t);
+} // namespace
+
+void EntityInterest::set(std::vector<std::uint32_t> keys)
+{
+    std::ranges::sort(keys);
+    keys_ = std::move(keys);
+}
+
+void EntityInterest::clear()
+{
+    keys_.reset();
+}
+
+bool EntityInterest::accepts(const Frame &frame) const
+{
+    if (not keys_.has_value())
+    {
+        return true;
+    }
+    const auto key = peek_entity_key(frame);
+    return not key.has_value() or std::ranges::binary_search(keys_.value(), key.value());
+}
+
+std::optional<std::uint32_t> EntityInterest::peek_entity_key(const Frame &frame)
+{
+    if (frame.payload.size() < kEntityKeySize or frame.payload[0] != kEntityKeyTag or
+        std::ranges::find(detail::kEntityKeyMessageIds, frame.message_type) == detail::kEntityKeyMessageIds.end())
+    {
+        return std::nullopt;
+    }
+    return std::to_integer<std::uint32_t>(frame.payload[1]) | (std::to_integer<std::uint32_t>(frame.payload[2]) << 8U) |
+           (std::to_integer<std::uint32_t>(frame.payload[3]) << 16U) |
+           (std::to_integer<std::uint32_t>(frame.payload[4]) << 24U);
+}
+} // namespace cppesphomeapi
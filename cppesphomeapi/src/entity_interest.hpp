@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "plain_text_protocol.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * The entity keys a connection wants the states of. Frames of other entities are dropped by peeking at their key,
+ * before a message is created. Not thread safe, confined to the connection strand.
+ */
+class EntityInterest
+{
+  public:
+    // only the entities with the keys are of interest.
+    void set(std::vector<std::uint32_t> keys);
+    // every entity is of interest again.
+    void clear();
+    // false if the frame belongs to an entity outside of the set. Frames that do not start with the key, e.g. with the
+    // default key 0 omitted by the encoder, are always accepted.
+    [[nodiscard]] bool accepts(const Frame &frame) const;
+
+    // the key of the entity the frame belongs to, if it is the first field.
+    static std::optional<std::uint32_t> peek_entity_key(const Frame &frame);
+
+  private:
+    // sorted. std::nullopt accepts every entity.
+    std::optional<std::vector<std::uint32_t>> keys_;
+};
+} // namespace cppesphomeapi
@@ -3,15 +3,14 @@
  * with adaptions for this project
  */
 #pragma once
+#include <concepts>
+#include <exception>
+#include <functional>
 #include <stop_token>
 #include <type_traits>
+#include <utility>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/co_spawn.hpp>
-#include <boost/asio/execution_context.hpp>
-#include <boost/asio/io_context.hpp>
-#include <boost/asio/is_executor.hpp>
-
-#include <print>
 
 namespace cppesphomeapi::executor
 {
@@ -19,14 +18,6 @@ namespace asio = boost::asio;
 
 template <typename T>
 constexpr inline bool Unfortunate = false;
-template <typename T>
-constexpr inline bool isExecutionContext = std::is_base_of_v<asio::execution_context, T>;
-template <typename T>
-constexpr inline bool isExecutor = asio::is_executor<T>::value or asio::execution::is_executor<T>::value;
-template <typename T>
-constexpr inline bool hasExecutor = requires(T t) {
-    { t.get_executor() };
-};
 
 auto onException(std::stop_source stop_source)
 {
@@ -37,81 +28,6 @@ auto onException(std::stop_source stop_source)
         }
     };
 }
-using ServiceBase = asio::execution_context::service;
-struct StopService : ServiceBase
-{
-    using key_type = StopService;
-
-    static asio::io_context::id id;
-
-    using ServiceBase::ServiceBase;
-    StopService(asio::execution_context &Ctx, std::stop_source Stop)
-        : ServiceBase(Ctx)
-        , stop_(std::move(Stop))
-    {}
-
-    std::stop_source get() const
-    {
-        return stop_;
-    }
-    bool isStopped() const
-    {
-        return stop_.stop_requested();
-    }
-    void requestStop()
-    {
-        stop_.request_stop();
-    }
-
-  private:
-    void shutdown() noexcept override
-    {}
-    std::stop_source stop_;
-};
-
-void addStopService(asio::execution_context &Executor, std::stop_source &Stop)
-{
-    asio::make_service<StopService>(Executor, Stop);
-}
-
-// precondition: 'Context' provides a 'StopService'
-
-std::stop_source getStop(asio::execution_context &Context)
-{
-    if (not asio::has_service<StopService>(Context))
-    {
-        std::println("Context does not have a stop service :/");
-    }
-    return asio::use_service<StopService>(Context).get();
-}
-
-template <typename T>
-asio::execution_context &getContext(T &Object) noexcept
-{
-    if constexpr (isExecutionContext<T>)
-    {
-        return Object;
-    }
-    else if constexpr (isExecutor<T>)
-    {
-        return Object.context();
-    }
-    else if constexpr (hasExecutor<T>)
-    {
-        return Object.get_executor().context();
-    }
-    else
-    {
-        static_assert(Unfortunate<T>, "Please give me an execution context");
-    }
-}
-
-// return the stop_source that is 'wired' to the given 'Object'
-
-/*export*/ [[nodiscard]] auto stopAssetOf(auto &Object)
-{
-    return getStop(getContext(Object));
-}
 
 template <typename T>
 constexpr inline bool isAwaitable = false;
@@ -134,16 +50,21 @@ struct IsCallable
 };
 
 // initiate independent asynchronous execution of a piece of work on a given executor.
-// signal stop if an exception escapes that piece of work.
+// signal stop on the given source if an exception escapes that piece of work, and call 'done' once it finished.
 
 #define WORKITEM std::invoke(std::forward<Func>(work), std::forward<Ts>(args)...)
 
 /*export*/ template <typename Func, typename... Ts>
     requires(IsCallable<Func, Ts...>::asynchronously)
-void commission(auto &&executor, Func &&work, Ts &&...args)
+void commission(std::stop_source stop, auto &&executor, std::invocable auto done, Func &&work, Ts &&...args)
 {
-    auto stop = stopAssetOf(executor);
-    asio::co_spawn(executor, WORKITEM, onException(stop));
+    asio::co_spawn(executor,
+                   WORKITEM,
+                   [on_exception = onException(std::move(stop)), done = std::move(done)](
+                       std::exception_ptr exception) mutable {
+                       on_exception(exception);
+                       done();
+                   });
 }
 
 // abort operation of a given object depending on its capabilities.
@@ -166,12 +87,11 @@ void abort_impl(T & object) {
 // clang-format on
 
 // create an object that is wired up to abort the operation of all given objects
-// whenever a stop is indicated.
+// whenever a stop is indicated on the given token.
 
-/*export*/ [[nodiscard]] auto abort(auto &object, auto &...more_objects)
+/*export*/ [[nodiscard]] auto abort(std::stop_token stop, auto &object, auto &...more_objects)
 {
-    return std::stop_callback{stopAssetOf(object).get_token(),
-                              [&] { (abort_impl(object), ..., abort_impl(more_objects)); }};
+    return std::stop_callback{std::move(stop), [&] { (abort_impl(object), ..., abort_impl(more_objects)); }};
 }
 
 } // namespace cppesphomeapi::executor
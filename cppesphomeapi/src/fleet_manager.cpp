@@ -0,0 +1,168 @@
+#include "cppesphomeapi/fleet_manager.hpp"
+#include <algorithm>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/deferred.hpp>
+#include <boost/asio/experimental/parallel_group.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include "net.hpp"
+
+namespace asio = boost::asio;
+
+namespace cppesphomeapi
+{
+FleetManager::FleetManager(const asio::any_io_executor &executor, std::stop_source &stop_source, FleetOptions options)
+    : executor_{executor}
+    , strand_{asio::make_strand(executor)}
+    , stop_source_{stop_source}
+    , options_{options}
+{
+    options_.max_concurrent = std::max<std::size_t>(options_.max_concurrent, 1);
+}
+
+FleetManager::~FleetManager() = default;
+
+std::size_t FleetManager::size() const
+{
+    const std::scoped_lock lock{clients_mutex_};
+    return clients_.size();
+}
+
+ApiClient &FleetManager::client(std::size_t index)
+{
+    const std::scoped_lock lock{clients_mutex_};
+    return *clients_.at(index);
+}
+
+ConnectionMetrics FleetManager::metrics() const
+{
+    const std::scoped_lock lock{clients_mutex_};
+    ConnectionMetrics metrics;
+    for (auto &&client : clients_)
+    {
+        metrics += client->metrics();
+    }
+    return metrics;
+}
+
+awaitable<FleetReport> FleetManager::async_bootstrap(std::vector<FleetDevice> devices)
+{
+    // the loops of the previous clients refer to them until they finished.
+    co_await async_close();
+    co_await asio::post(strand_, asio::use_awaitable);
+
+    std::vector<std::unique_ptr<ApiClient>> clients;
+    clients.reserve(devices.size());
+    FleetReport report;
+    report.devices.resize(devices.size());
+    for (std::size_t i = 0; i < devices.size(); i++)
+    {
+        auto &&device = devices[i];
+        clients.emplace_back(std::make_unique<ApiClient>(
+            executor_, stop_source_, std::move(device.hostname), device.port, std::move(device.password)));
+        report.devices[i].index = i;
+    }
+    {
+        const std::scoped_lock lock{clients_mutex_};
+        clients_.swap(clients);
+    }
+    // the previous clients are closed, they are destroyed outside of the lock.
+    clients.clear();
+    next_device_ = 0;
+
+    const auto started = Clock::now();
+    using WorkerOperation = decltype(asio::co_spawn(strand_, std::declval<awaitable<void>>(), asio::deferred));
+    std::vector<WorkerOperation> workers;
+    const auto worker_count = std::min(options_.max_concurrent, devices.size());
+    workers.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; i++)
+    {
+        workers.emplace_back(asio::co_spawn(strand_, admission_worker(started, report), asio::deferred));
+    }
+    co_await asio::experimental::make_parallel_group(std::move(workers))
+        .async_wait(asio::experimental::wait_for_all(), asio::use_awaitable);
+
+    report.time_to_all_ready = Clock::now() - started;
+    report.ready_count = static_cast<std::size_t>(
+        std::ranges::count_if(report.devices, [](auto &&readiness) { return readiness.ready.has_value(); }));
+    co_return report;
+}
+
+awaitable<void> FleetManager::async_close()
+{
+    co_await asio::post(strand_, asio::use_awaitable);
+    for (auto &&client : clients_)
+    {
+        co_await client->async_close();
+    }
+}
+
+awaitable<void> FleetManager::admission_worker(std::chrono::steady_clock::time_point started, FleetReport &report)
+{
+    net::Timer pacing_timer{strand_};
+    while (next_device_ < report.devices.size())
+    {
+        const auto index = next_device_++;
+        // the admission slots are fixed up front, so a slow device does not delay the admission of the others.
+        pacing_timer.expires_at(started + options_.admission_interval * static_cast<std::int64_t>(index));
+        if (not co_await net::expired(pacing_timer))
+        {
+            co_return;
+        }
+        co_await bootstrap_device(started, report.devices[index]);
+    }
+}
+
+awaitable<void> FleetManager::bootstrap_device(std::chrono::steady_clock::time_point started,
+                                               DeviceReadiness &readiness)
+{
+    auto &api_client = *clients_[readiness.index];
+    const auto admitted_at = Clock::now();
+    const Deadline deadline = admitted_at + options_.device_timeout;
+    readiness.admitted = admitted_at - started;
+
+    if (options_.pipelined)
+    {
+        auto snapshot = co_await api_client.async_connect_pipelined(deadline);
+        if (not snapshot.has_value())
+        {
+            readiness.error = snapshot.error();
+            co_return;
+        }
+        readiness.snapshot = std::move(snapshot.value());
+        readiness.connected = readiness.ready = Clock::now() - started;
+        co_return;
+    }
+
+    const auto connected = co_await api_client.async_connect(deadline);
+    if (not connected.has_value())
+    {
+        readiness.error = connected.error();
+        co_return;
+    }
+    readiness.connected = Clock::now() - started;
+
+    auto device_info = co_await api_client.async_device_info(deadline);
+    if (not device_info.has_value())
+    {
+        readiness.error = device_info.error();
+        co_return;
+    }
+    readiness.snapshot.device_info = std::move(device_info.value());
+
+    auto entities = co_await api_client.async_list_entities_services(deadline);
+    if (not entities.has_value())
+    {
+        readiness.error = entities.error();
+        co_return;
+    }
+    readiness.snapshot.entities = std::move(entities.value());
+
+    const auto subscribed = co_await api_client.subscribe_states(deadline);
+    if (not subscribed.has_value())
+    {
+        readiness.error = subscribed.error();
+        co_return;
+    }
+    readiness.ready = Clock::now() - started;
+}
+} // namespace cppesphomeapi
@@ -1,12 +1,14 @@
 #pragma once
 #include <cstdint>
-#include "api_options.pb.h"
+#include <type_traits>
+#include "message_traits.hpp"
 
 namespace cppesphomeapi::detail
 {
+// the id is generated from the options of api.proto, see cmake/generate_message_traits.cmake.
 template <typename TMsg>
-std::uint32_t get_message_id()
+constexpr std::uint32_t get_message_id()
 {
-    return std::remove_cvref_t<TMsg>::GetDescriptor()->options().GetExtension(proto::id);
+    return MessageTraits<std::remove_cvref_t<TMsg>>::id;
 }
 } // namespace cppesphomeapi::detail
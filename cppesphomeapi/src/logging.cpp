@@ -0,0 +1,32 @@
+#include <array>
+#include <print>
+#include <utility>
+#include "logging.hpp"
+
+namespace cppesphomeapi
+{
+ConsoleLogSink::ConsoleLogSink(LogLevel level)
+    : level_{level}
+{}
+
+LogLevel ConsoleLogSink::level() const
+{
+    return level_;
+}
+
+void ConsoleLogSink::write(LogLevel level, std::string_view message)
+{
+    static constexpr std::array<std::string_view, 6> kLevelNames{"trace", "debug", "info", "warning", "error", "off"};
+    std::println("[{}] {}", kLevelNames[std::to_underlying(level)], message);
+}
+
+void set_log_sink(LogSink *sink)
+{
+    detail::log_level.store(LogLevel::Off, std::memory_order_relaxed);
+    detail::log_sink.store(sink, std::memory_order_release);
+    if (sink != nullptr)
+    {
+        detail::log_level.store(sink->level(), std::memory_order_relaxed);
+    }
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <format>
+#include <iterator>
+#include <string>
+#include <utility>
+#include "cppesphomeapi/log_sink.hpp"
+
+// set by the build from CPPESPHOMEAPI_LOG_LEVEL. Statements below it are removed at compile time.
+#ifndef CPPESPHOMEAPI_LOG_MIN_LEVEL
+#define CPPESPHOMEAPI_LOG_MIN_LEVEL 0
+#endif
+
+namespace cppesphomeapi::detail
+{
+inline constexpr LogLevel kMinLogLevel = static_cast<LogLevel>(CPPESPHOMEAPI_LOG_MIN_LEVEL);
+
+// mirrors the level of the installed sink, so a disabled record costs a single relaxed load.
+inline std::atomic<LogLevel> log_level{LogLevel::Off};
+inline std::atomic<LogSink *> log_sink{nullptr};
+
+inline bool log_enabled(LogLevel level) noexcept
+{
+    return level >= log_level.load(std::memory_order_relaxed);
+}
+
+// formats into a buffer of the calling thread, so a record only allocates while the buffer grows.
+template <typename... TArgs>
+void write_log(LogLevel level, std::format_string<TArgs...> format, TArgs &&...args)
+{
+    auto *sink = log_sink.load(std::memory_order_acquire);
+    if (sink == nullptr)
+    {
+        return;
+    }
+    thread_local std::string buffer;
+    buffer.clear();
+    std::format_to(std::back_inserter(buffer), format, std::forward<TArgs>(args)...);
+    sink->write(level, buffer);
+}
+} // namespace cppesphomeapi::detail
+
+// the arguments are only evaluated if the record is written.
+#define CPPESPHOMEAPI_LOG(level, ...)                                                                                  \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr ((level) >= ::cppesphomeapi::detail::kMinLogLevel)                                                \
+        {                                                                                                              \
+            if (::cppesphomeapi::detail::log_enabled(level))                                                           \
+            {                                                                                                          \
+                ::cppesphomeapi::detail::write_log(level, __VA_ARGS__);                                                \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define LOG_TRACE(...) CPPESPHOMEAPI_LOG(::cppesphomeapi::LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) CPPESPHOMEAPI_LOG(::cppesphomeapi::LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) CPPESPHOMEAPI_LOG(::cppesphomeapi::LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) CPPESPHOMEAPI_LOG(::cppesphomeapi::LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) CPPESPHOMEAPI_LOG(::cppesphomeapi::LogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,64 @@
+#include "message_pool.hpp"
+
+namespace cppesphomeapi
+{
+std::shared_ptr<MessagePool> MessagePool::create(std::size_t cached_per_type)
+{
+    return std::shared_ptr<MessagePool>(new MessagePool(cached_per_type));
+}
+
+MessagePool::MessagePool(std::size_t cached_per_type)
+    : cached_per_type_{cached_per_type}
+    , free_messages_(kMaxMessageId + 1)
+{
+    for (auto &&free_list : free_messages_)
+    {
+        free_list.reserve(cached_per_type_);
+    }
+}
+
+std::size_t MessagePool::cached(std::uint32_t message_id) const
+{
+    std::unique_lock l{mtx_};
+    return message_id < free_messages_.size() ? free_messages_[message_id].size() : 0;
+}
+
+google::protobuf::Message *MessagePool::take(std::uint32_t message_id)
+{
+    std::unique_lock l{mtx_};
+    if (message_id >= free_messages_.size() or free_messages_[message_id].empty())
+    {
+        return nullptr;
+    }
+    auto &free_list = free_messages_[message_id];
+    auto *message = free_list.back().release();
+    free_list.pop_back();
+    return message;
+}
+
+void MessagePool::recycle(std::uint32_t message_id, google::protobuf::Message *message)
+{
+    // Clear() keeps the allocated memory of the fields for the next parse.
+    message->Clear();
+    std::unique_lock l{mtx_};
+    if (message_id < free_messages_.size() and free_messages_[message_id].size() < cached_per_type_)
+    {
+        free_messages_[message_id].emplace_back(message);
+        return;
+    }
+    l.unlock();
+    delete message;
+}
+
+void MessagePool::Recycler::operator()(google::protobuf::Message *message) const
+{
+    if (const auto message_pool = pool.lock(); message_pool != nullptr)
+    {
+        message_pool->recycle(message_id, message);
+    }
+    else
+    {
+        delete message;
+    }
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/asio/recycling_allocator.hpp>
+#include <google/protobuf/message.h>
+#include "get_message_id.hpp"
+
+namespace cppesphomeapi
+{
+struct HeapMessageFactory
+{
+    template <typename TMsg>
+    std::shared_ptr<TMsg> make() const
+    {
+        return std::make_shared<TMsg>();
+    }
+};
+
+/**
+ * Recycles received messages per message type. A message returns to the pool when its last reference is dropped,
+ * keeping the capacity of its strings and repeated fields. The control blocks are taken from asio's per thread
+ * recycling cache, so a warm connection receives messages without touching the heap.
+ */
+class MessagePool : public std::enable_shared_from_this<MessagePool>
+{
+  public:
+    static constexpr std::size_t kMaxMessageId = 127;
+    static constexpr std::size_t kDefaultCachedPerType = 8;
+
+    static std::shared_ptr<MessagePool> create(std::size_t cached_per_type = kDefaultCachedPerType);
+
+    template <typename TMsg>
+    std::shared_ptr<TMsg> make()
+    {
+        const auto message_id = detail::get_message_id<TMsg>();
+        auto *message = static_cast<TMsg *>(take(message_id));
+        if (message == nullptr)
+        {
+            message = new TMsg{};
+        }
+        return std::shared_ptr<TMsg>(
+            message, Recycler{weak_from_this(), message_id}, boost::asio::recycling_allocator<TMsg>{});
+    }
+
+    std::size_t cached(std::uint32_t message_id) const;
+
+  private:
+    explicit MessagePool(std::size_t cached_per_type);
+
+    google::protobuf::Message *take(std::uint32_t message_id);
+    void recycle(std::uint32_t message_id, google::protobuf::Message *message);
+
+    struct Recycler
+    {
+        std::weak_ptr<MessagePool> pool;
+        std::uint32_t message_id{};
+
+        void operator()(google::protobuf::Message *message) const;
+    };
+
+  private:
+    std::size_t cached_per_type_;
+    mutable std::mutex mtx_;
+    std::vector<std::vector<std::unique_ptr<google::protobuf::Message>>> free_messages_;
+};
+} // namespace cppesphomeapi
@@ -0,0 +1,170 @@
+#include "message_tracer.hpp"
+#include <algorithm>
+#include <format>
+#include <iterator>
+#include <map>
+#include "api.pb.h"
+#include "api_options.pb.h"
+
+namespace cppesphomeapi
+{
+namespace
+{
+std::map<std::uint32_t, std::string> message_type_names()
+{
+    std::map<std::uint32_t, std::string> names;
+    const auto *file = proto::HelloRequest::descriptor()->file();
+    for (int i = 0; i < file->message_type_count(); i++)
+    {
+        const auto *descriptor = file->message_type(i);
+        if (descriptor->options().HasExtension(proto::id))
+        {
+            names.emplace(descriptor->options().GetExtension(proto::id), descriptor->name());
+        }
+    }
+    return names;
+}
+
+double micros_between(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::micro>(to - from).count();
+}
+} // namespace
+
+MessageTracer::MessageTracer(TraceOptions options)
+    : options_{options}
+    , started_{Clock::now()}
+{}
+
+void MessageTracer::dispatched(MessageWrapper &message)
+{
+    const auto message_type = message.message_id();
+    if (message_type >= kMessageTypeCount)
+    {
+        return;
+    }
+    auto &timestamps = message.timestamps();
+    auto &histograms = histograms_[message_type];
+    histograms.decode.record(timestamps.decoded_at - timestamps.read_at);
+    histograms.dispatch.record(timestamps.dispatched_at - timestamps.decoded_at);
+
+    dispatched_count_++;
+    if (options_.sample_interval == 0 or options_.max_sampled_messages == 0 or
+        dispatched_count_ % options_.sample_interval != 0)
+    {
+        return;
+    }
+    timestamps.trace_id = next_trace_id_++;
+    const std::scoped_lock lock{sampled_mutex_};
+    if (sampled_.size() >= options_.max_sampled_messages)
+    {
+        sampled_.pop_front();
+    }
+    sampled_.emplace_back(SampledMessage{
+        .trace_id = timestamps.trace_id,
+        .message_type = message_type,
+        .timestamps = timestamps,
+        .consumed_at = {},
+    });
+}
+
+void MessageTracer::consumed(const MessageWrapper &message)
+{
+    const auto message_type = message.message_id();
+    if (message_type >= kMessageTypeCount)
+    {
+        return;
+    }
+    const auto consumed_at = Clock::now();
+    const auto &timestamps = message.timestamps();
+    auto &histograms = histograms_[message_type];
+    histograms.consume.record(consumed_at - timestamps.dispatched_at);
+    histograms.total.record(consumed_at - timestamps.read_at);
+
+    if (timestamps.trace_id == 0)
+    {
+        return;
+    }
+    const std::scoped_lock lock{sampled_mutex_};
+    // the message was sampled recently, so it is near the end.
+    const auto it = std::find_if(sampled_.rbegin(), sampled_.rend(), [&timestamps](auto &&sampled) {
+        return sampled.trace_id == timestamps.trace_id;
+    });
+    if (it != sampled_.rend() and it->consumed_at == Clock::time_point{})
+    {
+        it->consumed_at = consumed_at;
+    }
+}
+
+std::vector<MessageLatencies> MessageTracer::latencies() const
+{
+    std::vector<MessageLatencies> latencies;
+    for (std::uint32_t message_type = 0; message_type < kMessageTypeCount; message_type++)
+    {
+        const auto &histograms = histograms_[message_type];
+        auto decode = histograms.decode.snapshot();
+        if (decode.count == 0)
+        {
+            continue;
+        }
+        latencies.emplace_back(MessageLatencies{
+            .message_type = message_type,
+            .decode = std::move(decode),
+            .dispatch = histograms.dispatch.snapshot(),
+            .consume = histograms.consume.snapshot(),
+            .total = histograms.total.snapshot(),
+        });
+    }
+    return latencies;
+}
+
+std::string MessageTracer::chrome_trace() const
+{
+    std::vector<SampledMessage> sampled;
+    {
+        const std::scoped_lock lock{sampled_mutex_};
+        sampled.assign(sampled_.cbegin(), sampled_.cend());
+    }
+    const auto names = message_type_names();
+    const auto name_of = [&names](std::uint32_t message_type) -> std::string {
+        const auto it = names.find(message_type);
+        return it != names.cend() ? it->second : std::format("message {}", message_type);
+    };
+
+    std::string trace{R"({"displayTimeUnit":"ns","traceEvents":[)"};
+    auto out = std::back_inserter(trace);
+    bool first{true};
+    const auto separator = [&first]() { return std::exchange(first, false) ? "" : ","; };
+    std::array<bool, kMessageTypeCount> named_rows{};
+    for (auto &&message : sampled)
+    {
+        if (not std::exchange(named_rows[message.message_type], true))
+        {
+            std::format_to(out,
+                           R"({}{{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                           separator(),
+                           message.message_type,
+                           name_of(message.message_type));
+        }
+        const auto add_stage = [&](std::string_view stage, Clock::time_point from, Clock::time_point to) {
+            std::format_to(out,
+                           R"({}{{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{"id":{}}}}})",
+                           separator(),
+                           stage,
+                           message.message_type,
+                           micros_between(started_, from),
+                           micros_between(from, to),
+                           message.trace_id);
+        };
+        const auto &timestamps = message.timestamps;
+        add_stage("decode", timestamps.read_at, timestamps.decoded_at);
+        add_stage("dispatch", timestamps.decoded_at, timestamps.dispatched_at);
+        if (message.consumed_at != Clock::time_point{})
+        {
+            add_stage("consume", timestamps.dispatched_at, message.consumed_at);
+        }
+    }
+    trace.append("]}");
+    return trace;
+}
+} // namespace cppesphomeapi
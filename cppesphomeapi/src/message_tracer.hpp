@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "atomic_histogram.hpp"
+#include "cppesphomeapi/clock.hpp"
+#include "cppesphomeapi/message_tracing.hpp"
+#include "message_wrapper.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * Latency histograms per message type and a sample of single messages for the Chrome trace export.
+ * dispatched() and consumed() are called on the connection strand, latencies() and chrome_trace() from any thread.
+ */
+class MessageTracer
+{
+  public:
+    explicit MessageTracer(TraceOptions options);
+
+    // records the decode and dispatch stage and decides whether the message is sampled.
+    void dispatched(MessageWrapper &message);
+    void consumed(const MessageWrapper &message);
+
+    // the message types that were received at least once.
+    [[nodiscard]] std::vector<MessageLatencies> latencies() const;
+    // the sampled messages in the Chrome trace event format, one row per message type.
+    [[nodiscard]] std::string chrome_trace() const;
+
+  private:
+    struct TypeHistograms
+    {
+        AtomicHistogram decode;
+        AtomicHistogram dispatch;
+        AtomicHistogram consume;
+        AtomicHistogram total;
+    };
+
+    struct SampledMessage
+    {
+        std::uint64_t trace_id{};
+        std::uint32_t message_type{};
+        MessageTimestamps timestamps;
+        // the first consumption, unset if the message was not consumed (yet).
+        Clock::time_point consumed_at;
+    };
+
+  private:
+    TraceOptions options_;
+    Clock::time_point started_;
+    std::array<TypeHistograms, kMessageTypeCount> histograms_;
+    std::uint64_t dispatched_count_{};
+    std::uint64_t next_trace_id_{1};
+
+    // only touched for sampled messages.
+    mutable std::mutex sampled_mutex_;
+    std::deque<SampledMessage> sampled_;
+};
+} // namespace cppesphomeapi
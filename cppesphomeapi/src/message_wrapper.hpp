@@ -1,79 +1,169 @@
 #pragma once
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <google/protobuf/message.h>
 #include "api_options.pb.h"
+#include "cppesphomeapi/state.hpp"
+#include "cppesphomeapi/string_views.hpp"
 #include "get_message_id.hpp"
 
 namespace cppesphomeapi
 {
+// the stages a received message passed. Only set while message tracing is enabled.
+struct MessageTimestamps
+{
+    std::chrono::steady_clock::time_point read_at;
+    std::chrono::steady_clock::time_point decoded_at;
+    std::chrono::steady_clock::time_point dispatched_at;
+    // non zero if the message was sampled for the trace export.
+    std::uint64_t trace_id{};
+};
+
+// received messages decoded into views of their frame, see string_views.hpp.
+using ReceivedView = std::variant<LogEntryView, TextSensorStateView>;
 
+/**
+ * A received message tagged with its message id. The id is taken from the static type the wrapper was created with,
+ * so a matching id proves the type and the message is cast statically.
+ * The hot state messages are decoded straight into their public state struct by the state decoder. The wrapper then
+ * holds the state instead of a protobuf message, see state(). Logs and text sensor states are decoded into views of
+ * their frame, see view_if().
+ * The wrapper is move only. Handing the message to several receivers shares it explicitly with share().
+ */
 class MessageWrapper
 {
   public:
-    MessageWrapper() = delete;
+    // an empty wrapper, used to complete aborted receive operations.
+    MessageWrapper() = default;
     ~MessageWrapper() = default;
 
     template <typename TMsg>
         requires std::is_base_of_v<google::protobuf::Message, TMsg>
     MessageWrapper(std::shared_ptr<TMsg> message)
-        : message_{std::move(message)}
-        , message_id_{detail::get_message_id<TMsg>()}
+        : message_id_{detail::get_message_id<TMsg>()}
+        , message_{std::move(message)}
     {}
 
-    MessageWrapper(MessageWrapper &&wrapper) noexcept
-        : message_{std::exchange(wrapper.message_, message_)}
-        , message_id_{std::exchange(wrapper.message_id_, message_id_)}
+    MessageWrapper(std::uint32_t message_id, EntityStateVariant state)
+        : message_id_{message_id}
+        , state_{std::move(state)}
     {}
 
-    MessageWrapper(const MessageWrapper &wrapper)
-        : message_{wrapper.message_}
-        , message_id_{wrapper.message_id_}
+    MessageWrapper(std::uint32_t message_id, ReceivedView view)
+        : message_id_{message_id}
+        , view_{std::move(view)}
+    {}
+
+    MessageWrapper(MessageWrapper &&wrapper) noexcept
+        : message_id_{std::exchange(wrapper.message_id_, 0)}
+        , message_{std::move(wrapper.message_)}
+        , state_{std::exchange(wrapper.state_, std::nullopt)}
+        , view_{std::exchange(wrapper.view_, std::nullopt)}
+        , timestamps_{wrapper.timestamps_}
     {}
 
     MessageWrapper &operator=(MessageWrapper &&rhs) noexcept
     {
-        message_ = std::exchange(rhs.message_, message_);
-        message_id_ = std::exchange(rhs.message_id_, message_id_);
+        message_id_ = std::exchange(rhs.message_id_, 0);
+        message_ = std::move(rhs.message_);
+        state_ = std::exchange(rhs.state_, std::nullopt);
+        view_ = std::exchange(rhs.view_, std::nullopt);
+        timestamps_ = rhs.timestamps_;
         return *this;
     }
 
-    MessageWrapper &operator=(const MessageWrapper &rhs)
+    MessageWrapper(const MessageWrapper &) = delete;
+    MessageWrapper &operator=(const MessageWrapper &) = delete;
+
+    // a second wrapper of the same message. Fan-out to several receive handlers stays on a shared_ptr on purpose:
+    // each handler may keep its message beyond the dispatch, and the last one to drop it returns it to the MessagePool
+    // through the deleter. The control block comes from asio's per thread recycling cache, so sharing costs an atomic
+    // increment instead of a copy of the message per handler. Only the rare dispatch to more than one handler shares.
+    [[nodiscard]] MessageWrapper share() const
     {
-        if (this == &rhs)
-        {
-            return *this;
-        }
-        message_ = rhs.message_;
-        message_id_ = rhs.message_id_;
-        return *this;
+        MessageWrapper shared;
+        shared.message_id_ = message_id_;
+        shared.message_ = message_;
+        shared.state_ = state_;
+        shared.view_ = view_;
+        shared.timestamps_ = timestamps_;
+        return shared;
     }
 
     template <typename TMsg>
         requires std::is_base_of_v<google::protobuf::Message, TMsg>
-    std::shared_ptr<TMsg> as() const
+    bool holds_message() const
     {
-        const auto requested_message = detail::get_message_id<TMsg>();
-        if (requested_message == message_id_)
-        {
-            return std::dynamic_pointer_cast<TMsg>(message_);
-        }
-        return nullptr;
+        return detail::get_message_id<TMsg>() == message_id_ and message_ != nullptr;
     }
 
+    // the message without taking a reference, nullptr if it is of another type.
     template <typename TMsg>
         requires std::is_base_of_v<google::protobuf::Message, TMsg>
-    bool holds_message() const
+    const TMsg *get_if() const
+    {
+        return holds_message<TMsg>() ? static_cast<const TMsg *>(message_.get()) : nullptr;
+    }
+
+    // shares the ownership of the message, nullptr if it is of another type.
+    template <typename TMsg>
+        requires std::is_base_of_v<google::protobuf::Message, TMsg>
+    std::shared_ptr<TMsg> as() const &
+    {
+        return holds_message<TMsg>() ? std::static_pointer_cast<TMsg>(message_) : nullptr;
+    }
+
+    // moves the ownership out of the wrapper if the message is of the type.
+    template <typename TMsg>
+        requires std::is_base_of_v<google::protobuf::Message, TMsg>
+    std::shared_ptr<TMsg> as() &&
+    {
+        return holds_message<TMsg>() ? std::static_pointer_cast<TMsg>(std::move(message_)) : nullptr;
+    }
+
+    // the decoded state, nullptr if the wrapper holds a protobuf message.
+    const EntityStateVariant *state() const
+    {
+        return state_.has_value() ? &state_.value() : nullptr;
+    }
+
+    // moves the decoded state out of the wrapper.
+    std::optional<EntityStateVariant> take_state() &&
+    {
+        return std::exchange(state_, std::nullopt);
+    }
+
+    // the view of the type, nullptr if the wrapper holds anything else. Copying the view shares the frame.
+    template <typename TView>
+    const TView *view_if() const
+    {
+        return view_.has_value() ? std::get_if<TView>(&view_.value()) : nullptr;
+    }
+
+    std::uint32_t message_id() const
+    {
+        return message_id_;
+    }
+
+    MessageTimestamps &timestamps()
     {
-        return detail::get_message_id<TMsg>() == message_id_;
+        return timestamps_;
     }
 
-    const google::protobuf::Message &ref() const
+    const MessageTimestamps &timestamps() const
     {
-        return *message_;
+        return timestamps_;
     }
 
   private:
     std::uint32_t message_id_{};
     std::shared_ptr<google::protobuf::Message> message_;
+    std::optional<EntityStateVariant> state_;
+    std::optional<ReceivedView> view_;
+    MessageTimestamps timestamps_;
 };
 } // namespace cppesphomeapi
@@ -0,0 +1,109 @@
+#include "metrics_recorder.hpp"
+#include <algorithm>
+#include "plain_text_protocol.hpp"
+
+namespace cppesphomeapi
+{
+void MetricsRecorder::add(Counter &counter, std::uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void MetricsRecorder::record_received_bytes(std::size_t bytes)
+{
+    add(bytes_received_, bytes);
+}
+
+void MetricsRecorder::record_received_frame(std::uint32_t message_type)
+{
+    add(frames_received_);
+    if (message_type < kMessageTypeCount)
+    {
+        add(messages_received_[message_type]);
+    }
+}
+
+void MetricsRecorder::record_broken_frame()
+{
+    add(broken_frames_);
+}
+
+void MetricsRecorder::record_parse_error()
+{
+    add(parse_errors_);
+}
+
+void MetricsRecorder::record_skipped_message()
+{
+    add(skipped_messages_);
+}
+
+void MetricsRecorder::record_filtered_message()
+{
+    add(filtered_messages_);
+}
+
+void MetricsRecorder::record_dispatch_latency(Duration latency)
+{
+    dispatch_latency_.record(latency);
+}
+
+void MetricsRecorder::record_unclaimed_message()
+{
+    add(unclaimed_messages_);
+}
+
+void MetricsRecorder::record_sent_packet(std::span<const std::byte> packet)
+{
+    add(bytes_sent_, packet.size());
+    while (not packet.empty())
+    {
+        const auto header = PlainTextProtocol::read_frame_header(packet);
+        if (not header.has_value() or not header->has_value() or packet.size() < header->value().frame_size())
+        {
+            break;
+        }
+        add(frames_sent_);
+        if (const auto message_type = header->value().message_type; message_type < kMessageTypeCount)
+        {
+            add(messages_sent_[message_type]);
+        }
+        packet = packet.subspan(header->value().frame_size());
+    }
+}
+
+void MetricsRecorder::record_round_trip(Duration rtt)
+{
+    round_trip_time_.record(rtt);
+}
+
+void MetricsRecorder::record_connect()
+{
+    add(connects_);
+}
+
+ConnectionMetrics MetricsRecorder::snapshot() const
+{
+    ConnectionMetrics metrics{
+        .bytes_received = bytes_received_.load(std::memory_order_relaxed),
+        .bytes_sent = bytes_sent_.load(std::memory_order_relaxed),
+        .frames_received = frames_received_.load(std::memory_order_relaxed),
+        .frames_sent = frames_sent_.load(std::memory_order_relaxed),
+        .decode_errors =
+            broken_frames_.load(std::memory_order_relaxed) + parse_errors_.load(std::memory_order_relaxed),
+        .skipped_messages = skipped_messages_.load(std::memory_order_relaxed),
+        .filtered_messages = filtered_messages_.load(std::memory_order_relaxed),
+        .unclaimed_messages = unclaimed_messages_.load(std::memory_order_relaxed),
+        .connects = connects_.load(std::memory_order_relaxed),
+        .round_trip_time = round_trip_time_.snapshot(),
+        .dispatch_latency = dispatch_latency_.snapshot(),
+    };
+    metrics.reconnects = metrics.connects > 0 ? metrics.connects - 1 : 0;
+    for (std::size_t type = 0; type < kMessageTypeCount; type++)
+    {
+        metrics.messages_received[type] = messages_received_[type].load(std::memory_order_relaxed);
+        metrics.messages_sent[type] = messages_sent_[type].load(std::memory_order_relaxed);
+    }
+    return metrics;
+}
+} // namespace cppesphomeapi
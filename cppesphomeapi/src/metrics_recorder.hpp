@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "atomic_histogram.hpp"
+#include "cppesphomeapi/connection_metrics.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * The counters behind ConnectionMetrics. Every counter has a single writer, either the connection strand or the
+ * decode strand, so recording is a relaxed load and store without a locked instruction. snapshot() may be called from
+ * any thread.
+ */
+class MetricsRecorder
+{
+  public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    // receive loop
+    void record_received_bytes(std::size_t bytes);
+    void record_received_frame(std::uint32_t message_type);
+    void record_broken_frame();
+    // decoder
+    void record_parse_error();
+    void record_skipped_message();
+    void record_filtered_message();
+    void record_dispatch_latency(Duration latency);
+    void record_unclaimed_message();
+    // send writer, the packet may contain several frames.
+    void record_sent_packet(std::span<const std::byte> packet);
+    void record_round_trip(Duration rtt);
+    void record_connect();
+
+    // the queue depths are not known to the recorder and left empty.
+    [[nodiscard]] ConnectionMetrics snapshot() const;
+
+  private:
+    using Counter = std::atomic<std::uint64_t>;
+
+    static void add(Counter &counter, std::uint64_t value = 1);
+
+  private:
+    Counter bytes_received_{};
+    Counter bytes_sent_{};
+    Counter frames_received_{};
+    Counter frames_sent_{};
+    std::array<Counter, kMessageTypeCount> messages_received_{};
+    std::array<Counter, kMessageTypeCount> messages_sent_{};
+    Counter broken_frames_{};
+    Counter parse_errors_{};
+    Counter skipped_messages_{};
+    Counter filtered_messages_{};
+    Counter unclaimed_messages_{};
+    Counter connects_{};
+    AtomicHistogram round_trip_time_;
+    AtomicHistogram dispatch_latency_;
+};
+} // namespace cppesphomeapi
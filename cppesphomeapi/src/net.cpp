@@ -49,6 +49,13 @@ auto resolveHostEndpoints(std::string_view HostName, Port port, Timer &timer)
     using namespace std::string_view_literals;
     static constexpr auto kLocalHostName = "localhost"sv;
 
+    // an address needs no resolver, which would complete from its own thread.
+    ErrorCode address_error;
+    if (const auto address = asio::ip::make_address(HostName, address_error); not address_error)
+    {
+        co_return std::vector<Endpoint>{Endpoint{address, port}};
+    }
+
     using Resolver = use_await::as_default_on_t<asio::ip::tcp::resolver>;
     auto flags = Resolver::numeric_service;
     if (HostName.empty() || HostName == kLocalHostName)
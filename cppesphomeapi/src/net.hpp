@@ -7,8 +7,10 @@
 #include <expected>
 #include <tuple>
 #include <boost/asio/as_tuple.hpp>
+#include <boost/asio/basic_waitable_timer.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/use_awaitable.hpp>
+#include "cppesphomeapi/clock.hpp"
 
 namespace cppesphomeapi::net
 {
@@ -21,7 +23,8 @@ using AsioResult = std::tuple<ErrorCode, Ts...>;
 using use_await = asio::as_tuple_t<asio::use_awaitable_t<>>;
 using Socket = use_await::as_default_on_t<asio::ip::tcp::socket>;
 using Acceptor = use_await::as_default_on_t<asio::ip::tcp::acceptor>;
-using Timer = use_await::as_default_on_t<asio::steady_timer>;
+
+using Timer = use_await::as_default_on_t<asio::basic_waitable_timer<Clock>>;
 using Endpoint = asio::ip::tcp::endpoint;
 using Endpoints = std::span<const Endpoint>;
 enum Port : uint16_t
@@ -0,0 +1,79 @@
+#include "packet_buffer_pool.hpp"
+#include <utility>
+
+namespace cppesphomeapi
+{
+PacketBuffer::PacketBuffer(std::weak_ptr<PacketBufferPool> pool, std::vector<std::byte> bytes)
+    : pool_{std::move(pool)}
+    , bytes_{std::move(bytes)}
+{}
+
+PacketBuffer::~PacketBuffer()
+{
+    release();
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer &&other) noexcept
+    : pool_{std::move(other.pool_)}
+    , bytes_{std::move(other.bytes_)}
+{}
+
+PacketBuffer &PacketBuffer::operator=(PacketBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool_ = std::move(other.pool_);
+        bytes_ = std::move(other.bytes_);
+    }
+    return *this;
+}
+
+std::vector<std::byte> &PacketBuffer::bytes()
+{
+    return bytes_;
+}
+
+void PacketBuffer::release()
+{
+    if (const auto pool = pool_.lock(); pool != nullptr)
+    {
+        pool->recycle(std::move(bytes_));
+    }
+    pool_.reset();
+    bytes_ = {};
+}
+
+std::shared_ptr<PacketBufferPool> PacketBufferPool::create()
+{
+    auto pool = std::shared_ptr<PacketBufferPool>{new PacketBufferPool{}};
+    pool->free_buffers_.reserve(kMaxPooledBuffers);
+    return pool;
+}
+
+PacketBuffer PacketBufferPool::acquire()
+{
+    if (free_buffers_.empty())
+    {
+        return PacketBuffer{weak_from_this(), {}};
+    }
+    auto bytes = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return PacketBuffer{weak_from_this(), std::move(bytes)};
+}
+
+void PacketBufferPool::recycle(std::vector<std::byte> bytes)
+{
+    if (free_buffers_.size() >= kMaxPooledBuffers or bytes.capacity() > kMaxPooledCapacity)
+    {
+        return;
+    }
+    bytes.clear();
+    free_buffers_.emplace_back(std::move(bytes));
+}
+
+std::size_t PacketBufferPool::available() const
+{
+    return free_buffers_.size();
+}
+} // namespace cppesphomeapi
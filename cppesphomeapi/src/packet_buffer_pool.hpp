@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cppesphomeapi
+{
+class PacketBufferPool;
+
+// a buffer of the pool, returned to it on destruction.
+class PacketBuffer
+{
+  public:
+    PacketBuffer(std::weak_ptr<PacketBufferPool> pool, std::vector<std::byte> bytes);
+    ~PacketBuffer();
+    PacketBuffer(PacketBuffer &&other) noexcept;
+    PacketBuffer &operator=(PacketBuffer &&other) noexcept;
+    PacketBuffer(const PacketBuffer &) = delete;
+    PacketBuffer &operator=(const PacketBuffer &) = delete;
+
+    // empty when acquired, with the capacity of its previous use.
+    std::vector<std::byte> &bytes();
+
+  private:
+    void release();
+
+  private:
+    std::weak_ptr<PacketBufferPool> pool_;
+    std::vector<std::byte> bytes_;
+};
+
+/**
+ * Recycles the buffers outgoing packets are serialized into. A buffer keeps its capacity, so a warm connection
+ * serializes and sends messages without touching the heap.
+ * Confined to the connection strand.
+ */
+class PacketBufferPool : public std::enable_shared_from_this<PacketBufferPool>
+{
+  public:
+    static constexpr std::size_t kMaxPooledBuffers = 16;
+    // larger buffers, e.g. of a big service batch, are freed instead of being kept.
+    static constexpr std::size_t kMaxPooledCapacity = 64 * 1024;
+
+    static std::shared_ptr<PacketBufferPool> create();
+
+    PacketBuffer acquire();
+    void recycle(std::vector<std::byte> bytes);
+    std::size_t available() const;
+
+  private:
+    PacketBufferPool() = default;
+
+  private:
+    std::vector<std::vector<std::byte>> free_buffers_;
+};
+} // namespace cppesphomeapi
@@ -1,15 +1,102 @@
 #include "plain_text_protocol.hpp"
+#include <algorithm>
+#include <format>
+#include <limits>
 #include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream.h>
-#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "api_options.pb.h"
 #include "make_unexpected_result.hpp"
 
 namespace cppesphomeapi
 {
+namespace
+{
+constexpr std::byte kPlainTextPreamble = std::byte{0x00};
+constexpr std::size_t kMaxVarint32Len = 5;
+
+struct Varint32
+{
+    std::uint32_t value{};
+    std::size_t size{};
+};
+
+// returns std::nullopt if data ends before the varint does.
+Result<std::optional<Varint32>> read_varint32(std::span<const std::byte> data)
+{
+    std::uint32_t value{};
+    for (std::size_t i = 0; i < std::min(data.size(), kMaxVarint32Len); i++)
+    {
+        const auto byte = std::to_integer<std::uint32_t>(data[i]);
+        value |= (byte & 0x7FU) << (7U * i);
+        if ((byte & 0x80U) == 0)
+        {
+            return Varint32{.value = value, .size = i + 1};
+        }
+    }
+    if (data.size() >= kMaxVarint32Len)
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError, "header contains an invalid varint");
+    }
+    return std::nullopt;
+}
+} // namespace
+
+Result<std::optional<FrameHeader>> PlainTextProtocol::read_frame_header(std::span<const std::byte> data)
+{
+    if (data.empty())
+    {
+        return std::nullopt;
+    }
+    if (data.front() != kPlainTextPreamble)
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError, "response does contain an invalid preamble");
+    }
+
+    const auto message_size = read_varint32(data.subspan(1));
+    if (not message_size.has_value())
+    {
+        return std::unexpected(message_size.error());
+    }
+    if (not message_size->has_value())
+    {
+        return std::nullopt;
+    }
+
+    const auto message_type = read_varint32(data.subspan(1 + message_size->value().size));
+    if (not message_type.has_value())
+    {
+        return std::unexpected(message_type.error());
+    }
+    if (not message_type->has_value())
+    {
+        return std::nullopt;
+    }
+
+    const FrameHeader header{
+        .message_type = message_type->value().value,
+        .header_size = 1 + message_size->value().size + message_type->value().size,
+        .payload_size = message_size->value().value,
+    };
+    if (header.frame_size() > kMaxFrameSize)
+    {
+        return make_unexpected_result(
+            ApiErrorCode::ParseError,
+            std::format("frame of {} bytes exceeds the maximum of {} bytes", header.frame_size(), kMaxFrameSize));
+    }
+    return header;
+}
+
 Result<std::vector<std::byte>> PlainTextProtocol::serialize(const ::google::protobuf::Message &message)
 {
-    constexpr std::byte kPlainTextPreamble = std::byte{0x00};
+    std::vector<std::byte> buffer;
+    if (auto serialized = serialize_to(message, buffer); not serialized.has_value())
+    {
+        return std::unexpected(std::move(serialized.error()));
+    }
+    return buffer;
+}
+
+Result<void> PlainTextProtocol::serialize_to(const ::google::protobuf::Message &message, std::vector<std::byte> &buffer)
+{
     auto &&msg_options = message.GetDescriptor()->options();
     if (not msg_options.HasExtension(proto::id))
     {
@@ -17,31 +104,43 @@ Result<std::vector<std::byte>> PlainTextProtocol::serialize(const ::google::prot
             ApiErrorCode::SerializeError,
             std::format("message \"{}\" does not contain the id field", message.GetDescriptor()->name()));
     }
+    return serialize_to(message, msg_options.GetExtension(proto::id), buffer);
+}
 
-    constexpr auto kMaxHeaderLen = 5;
-    std::vector<std::byte> buffer;
-    buffer.resize(message.ByteSizeLong() + kMaxHeaderLen);
-
-    buffer[0] = kPlainTextPreamble;
-
-    google::protobuf::io::ArrayOutputStream zstream{std::next(buffer.data(), 1), static_cast<int>(buffer.size() - 1)};
-    google::protobuf::io::CodedOutputStream output_stream{std::addressof(zstream)};
-
-    output_stream.WriteVarint32(message.ByteSizeLong());
-    output_stream.WriteVarint32(msg_options.GetExtension(proto::id));
-
-    if (output_stream.ByteCount() != (kMaxHeaderLen - 1))
+Result<void> PlainTextProtocol::serialize_to(const ::google::protobuf::Message &message,
+                                             std::uint32_t message_type,
+                                             std::vector<std::byte> &buffer)
+{
+    using google::protobuf::io::CodedOutputStream;
+    // caches the sizes of the message and its sub messages for SerializeWithCachedSizesToArray.
+    const auto body_size = message.ByteSizeLong();
+    if (body_size > std::numeric_limits<std::uint32_t>::max())
     {
-        buffer.resize(1 + message.ByteSizeLong() + output_stream.ByteCount());
+        return make_unexpected_result(
+            ApiErrorCode::SerializeError,
+            std::format("message \"{}\" is too large to be framed", message.GetDescriptor()->name()));
     }
+    const auto message_size = static_cast<std::uint32_t>(body_size);
+    const auto header_size =
+        1 + CodedOutputStream::VarintSize32(message_size) + CodedOutputStream::VarintSize32(message_type);
+
+    const auto frame_offset = buffer.size();
+    buffer.resize(frame_offset + header_size + body_size);
+    auto *target =
+        reinterpret_cast<std::uint8_t *>(std::next(buffer.data(), static_cast<std::ptrdiff_t>(frame_offset)));
+    *target++ = std::to_integer<std::uint8_t>(kPlainTextPreamble);
+    target = CodedOutputStream::WriteVarint32ToArray(message_size, target);
+    target = CodedOutputStream::WriteVarint32ToArray(message_type, target);
 
-    const bool serialized = message.SerializeToCodedStream(std::addressof(output_stream));
-    if (not serialized)
+    const auto *body_end = message.SerializeWithCachedSizesToArray(target);
+    if (static_cast<std::size_t>(body_end - target) != body_size)
     {
+        // the message was modified while it was serialized.
+        buffer.resize(frame_offset);
         return make_unexpected_result(
             ApiErrorCode::SerializeError,
             std::format("could not serialize message \"{}\"", message.GetDescriptor()->name()));
     }
-    return buffer;
+    return Result<void>{};
 }
 } // namespace cppesphomeapi
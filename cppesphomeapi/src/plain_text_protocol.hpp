@@ -1,32 +1,72 @@
 #pragma once
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <google/protobuf/message.h>
 #include "api_options.pb.h"
 #include "cppesphomeapi/result.hpp"
+#include "get_message_id.hpp"
+#include "logging.hpp"
 #include "make_unexpected_result.hpp"
+#include "message_pool.hpp"
 #include "message_wrapper.hpp"
 
-#include <print>
 namespace cppesphomeapi
 {
 
+struct FrameHeader
+{
+    std::uint32_t message_type{};
+    std::size_t header_size{};
+    std::size_t payload_size{};
+
+    [[nodiscard]] std::size_t frame_size() const
+    {
+        return header_size + payload_size;
+    }
+};
+
+struct Frame
+{
+    std::uint32_t message_type{};
+    std::span<const std::byte> payload;
+};
+
 struct PlainTextProtocol
 {
+    // larger frames are rejected as broken. A device sends far smaller ones, e.g. camera images are split into chunks.
+    static constexpr std::size_t kMaxFrameSize = std::size_t{1} << 20U;
+
     static Result<std::vector<std::byte>> serialize(const ::google::protobuf::Message &message);
+    // appends the frame of the message to the buffer. The size of the message is computed once and the header and body
+    // are written in place, so a buffer with enough capacity is not reallocated. On failure the buffer is unchanged.
+    // The id of a message type with generated traits is known at compile time.
+    template <typename TMsg>
+        requires requires { detail::MessageTraits<TMsg>::id; }
+    static Result<void> serialize_to(const TMsg &message, std::vector<std::byte> &buffer)
+    {
+        return serialize_to(message, detail::get_message_id<TMsg>(), buffer);
+    }
+    // the same for a message of any type, its id is looked up in the options of its descriptor.
+    static Result<void> serialize_to(const ::google::protobuf::Message &message, std::vector<std::byte> &buffer);
+    static Result<void> serialize_to(const ::google::protobuf::Message &message,
+                                     std::uint32_t message_type,
+                                     std::vector<std::byte> &buffer);
+
+    // returns std::nullopt if data does not contain the complete header yet. A frame larger than kMaxFrameSize is
+    // an error.
+    static Result<std::optional<FrameHeader>> read_frame_header(std::span<const std::byte> data);
 
     template <typename TMsg>
-    auto parse_and_invoke(google::protobuf::io::CodedInputStream *stream,
-                          const std::uint32_t message_type,
-                          auto &&message_handler) -> bool
+    static auto parse_and_invoke(const Frame &frame, auto &&message_factory, auto &&message_handler) -> bool
     {
-        if (TMsg::GetDescriptor()->options().GetExtension(proto::id) != message_type)
+        if (detail::get_message_id<TMsg>() != frame.message_type)
         {
             return false;
         }
 
-        auto message = std::make_shared<TMsg>();
-        const bool parsed = message->ParseFromCodedStream(stream);
+        auto message = message_factory.template make<TMsg>();
+        const bool parsed = message->ParseFromArray(frame.payload.data(), static_cast<int>(frame.payload.size()));
         if (not parsed)
         {
             return false;
@@ -35,6 +75,33 @@ struct PlainTextProtocol
         return true;
     }
 
+    // decodes a single complete frame. Frames of not accepted messages are skipped.
+    template <typename... TMsgs>
+    static auto decode(const Frame &frame, auto &&message_handler) -> Result<void>
+    {
+        return decode<TMsgs...>(frame, HeapMessageFactory{}, message_handler);
+    }
+
+    // same as decode, but the messages are created by the message_factory, e.g. a MessagePool.
+    template <typename... TMsgs>
+    static auto decode(const Frame &frame, auto &&message_factory, auto &&message_handler) -> Result<void>
+    {
+        const bool accepted_msg = ((detail::get_message_id<TMsgs>() == frame.message_type) || ...);
+        if (not accepted_msg)
+        {
+            LOG_TRACE("Got not accepted message {}. Skipping {} bytes", frame.message_type, frame.payload.size());
+            return Result<void>{};
+        }
+
+        const bool parsed = (parse_and_invoke<TMsgs>(frame, message_factory, message_handler) || ...);
+        if (not parsed)
+        {
+            return make_unexpected_result(ApiErrorCode::ParseError,
+                                          std::format("Could not parse any message from bytes."));
+        }
+        return Result<void>{};
+    }
+
     template <typename... TMsgs>
     auto decode_multiple(std::span<const std::byte> received_data, auto &&message_handler) -> Result<void>
     {
@@ -44,57 +111,32 @@ struct PlainTextProtocol
                                           "response does not contain enough bytes for the header");
         }
 
-        google::protobuf::io::CodedInputStream stream{reinterpret_cast<const std::uint8_t *>(received_data.data()),
-                                                      static_cast<int>(received_data.size())};
-        while (stream.BytesUntilLimit() > 0)
+        while (not received_data.empty())
         {
-            std::uint32_t preamble{};
-            if (not stream.ReadVarint32(&preamble) or preamble != 0x00)
-            {
-                return make_unexpected_result(ApiErrorCode::ParseError, "response does contain an invalid preamble");
-            }
-
-            std::uint32_t message_size{};
-            if (not stream.ReadVarint32(&message_size))
-            {
-                return make_unexpected_result(ApiErrorCode::ParseError, "got no message size");
-            }
-
-            std::uint32_t message_type{};
-            if (not stream.ReadVarint32(&message_type))
+            const auto header = read_frame_header(received_data);
+            if (not header.has_value())
             {
-                return make_unexpected_result(ApiErrorCode::ParseError, "got no message type");
+                return std::unexpected(header.error());
             }
-
-            const std::array<const google::protobuf::Descriptor *, sizeof...(TMsgs)> possible_ids{
-                TMsgs::GetDescriptor()...};
-            const auto accepted_msg =
-                std::any_of(possible_ids.cbegin(), possible_ids.cend(), [message_type](auto &&desc_id) {
-                    return desc_id->options().GetExtension(proto::id) == message_type;
-                });
-            if (not accepted_msg)
-            {
-                stream.Skip(static_cast<int>(message_size));
-                std::println("Got not accepted message {}. Skipping {} bytes", message_type, message_size);
-                continue;
-            }
-
-            if (stream.BytesUntilLimit() < message_size)
+            if (not header->has_value() or received_data.size() < header->value().frame_size())
             {
                 return make_unexpected_result(
                     ApiErrorCode::ParseError,
-                    std::format(
-                        "Received message size does not match the remaining bytes. Expected {} bytes got {} bytes.",
-                        message_size,
-                        stream.BytesUntilLimit()));
+                    std::format("Received message size does not match the remaining bytes. Got {} bytes.",
+                                received_data.size()));
             }
-
-            const bool parsed = (parse_and_invoke<TMsgs>(std::addressof(stream), message_type, message_handler) || ...);
-            if (not parsed)
+            const auto &frame_header = header->value();
+            const auto decoded = decode<TMsgs...>(
+                Frame{
+                    .message_type = frame_header.message_type,
+                    .payload = received_data.subspan(frame_header.header_size, frame_header.payload_size),
+                },
+                message_handler);
+            if (not decoded.has_value())
             {
-                return make_unexpected_result(ApiErrorCode::ParseError,
-                                              std::format("Could not parse any message from bytes."));
+                return decoded;
             }
+            received_data = received_data.subspan(frame_header.frame_size());
         }
         return Result<void>{};
     }
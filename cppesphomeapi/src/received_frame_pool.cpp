@@ -0,0 +1,64 @@
+#include "received_frame_pool.hpp"
+#include <boost/asio/recycling_allocator.hpp>
+
+namespace cppesphomeapi
+{
+std::shared_ptr<ReceivedFramePool> ReceivedFramePool::create()
+{
+    auto pool = std::shared_ptr<ReceivedFramePool>(new ReceivedFramePool());
+    pool->free_blocks_.reserve(kMaxPooledBlocks);
+    return pool;
+}
+
+PinnedFrame ReceivedFramePool::pin(std::span<const std::byte> payload)
+{
+    std::unique_ptr<std::vector<std::byte>> block;
+    {
+        std::unique_lock l{mtx_};
+        if (not free_blocks_.empty())
+        {
+            block = std::move(free_blocks_.back());
+            free_blocks_.pop_back();
+        }
+    }
+    if (block == nullptr)
+    {
+        block = std::make_unique<std::vector<std::byte>>();
+    }
+    block->assign(payload.begin(), payload.end());
+    return PinnedFrame(
+        block.release(), Recycler{weak_from_this()}, boost::asio::recycling_allocator<std::vector<std::byte>>{});
+}
+
+std::size_t ReceivedFramePool::available() const
+{
+    std::unique_lock l{mtx_};
+    return free_blocks_.size();
+}
+
+void ReceivedFramePool::recycle(std::vector<std::byte> *block)
+{
+    std::unique_ptr<std::vector<std::byte>> owned_block{block};
+    if (owned_block->capacity() > kMaxPooledCapacity)
+    {
+        return;
+    }
+    std::unique_lock l{mtx_};
+    if (free_blocks_.size() < kMaxPooledBlocks)
+    {
+        free_blocks_.emplace_back(std::move(owned_block));
+    }
+}
+
+void ReceivedFramePool::Recycler::operator()(std::vector<std::byte> *block) const
+{
+    if (const auto frame_pool = pool.lock(); frame_pool != nullptr)
+    {
+        frame_pool->recycle(block);
+    }
+    else
+    {
+        delete block;
+    }
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace cppesphomeapi
+{
+// a received payload in a block of the ReceivedFramePool.
+using PinnedFrame = std::shared_ptr<const std::vector<std::byte>>;
+
+/**
+ * Keeps received frames alive for the string views into them. The payload is copied once out of the receive buffer
+ * into a pooled block. The block returns to the pool when the last view of it is dropped, keeping its capacity. The
+ * control blocks are taken from asio's per thread recycling cache, so a warm connection pins frames without touching
+ * the heap. Thread safe, the views may be dropped on any thread.
+ */
+class ReceivedFramePool : public std::enable_shared_from_this<ReceivedFramePool>
+{
+  public:
+    static constexpr std::size_t kMaxPooledBlocks = 64;
+    // blocks of larger frames are freed instead of being kept.
+    static constexpr std::size_t kMaxPooledCapacity = 4 * 1024;
+
+    static std::shared_ptr<ReceivedFramePool> create();
+
+    // a reference counted copy of the payload.
+    PinnedFrame pin(std::span<const std::byte> payload);
+    std::size_t available() const;
+
+  private:
+    ReceivedFramePool() = default;
+
+    void recycle(std::vector<std::byte> *block);
+
+    struct Recycler
+    {
+        std::weak_ptr<ReceivedFramePool> pool;
+
+        void operator()(std::vector<std::byte> *block) const;
+    };
+
+  private:
+    mutable std::mutex mtx_;
+    std::vector<std::unique_ptr<std::vector<std::byte>>> free_blocks_;
+};
+} // namespace cppesphomeapi
@@ -0,0 +1,32 @@
+#include "rtt_estimator.hpp"
+#include <algorithm>
+
+namespace cppesphomeapi
+{
+void RttEstimator::add_sample(Duration rtt)
+{
+    rtt = std::max(rtt, Duration::zero());
+    if (not srtt_.has_value())
+    {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+    }
+    else
+    {
+        const auto deviation = *srtt_ > rtt ? *srtt_ - rtt : rtt - *srtt_;
+        rttvar_ = (3 * rttvar_ + deviation) / 4;
+        srtt_ = (7 * *srtt_ + rtt) / 8;
+    }
+    timeout_ = std::clamp(*srtt_ + 4 * rttvar_, kMinTimeout, kMaxTimeout);
+}
+
+RttEstimator::Duration RttEstimator::timeout() const
+{
+    return timeout_;
+}
+
+std::optional<RttEstimator::Duration> RttEstimator::smoothed_rtt() const
+{
+    return srtt_;
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <optional>
+
+namespace cppesphomeapi
+{
+/**
+ * Smoothed round trip time and its variance of request/response pairs (RFC 6298).
+ * The timeout is the smoothed round trip time plus four times its variance, clamped to [kMinTimeout, kMaxTimeout].
+ */
+class RttEstimator
+{
+  public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    static constexpr Duration kInitialTimeout = std::chrono::milliseconds{500};
+    static constexpr Duration kMinTimeout = std::chrono::milliseconds{50};
+    static constexpr Duration kMaxTimeout = std::chrono::seconds{10};
+
+    void add_sample(Duration rtt);
+    // the timeout for the next request. kInitialTimeout until the first sample was added.
+    [[nodiscard]] Duration timeout() const;
+    [[nodiscard]] std::optional<Duration> smoothed_rtt() const;
+
+  private:
+    std::optional<Duration> srtt_;
+    Duration rttvar_{};
+    Duration timeout_{kInitialTimeout};
+};
+} // namespace cppesphomeapi
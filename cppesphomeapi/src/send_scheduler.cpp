@@ -0,0 +1,120 @@
+#include "send_scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace cppesphomeapi
+{
+namespace
+{
+constexpr std::size_t kCompactThreshold = 64;
+} // namespace
+
+std::uint64_t SendScheduler::push(SendPriority priority,
+                                  std::span<const std::byte> packet,
+                                  boost::asio::any_completion_handler<SendSignature> handler)
+{
+    const auto id = next_id_++;
+    const auto lane = std::to_underlying(priority);
+    lanes_[lane].sends.emplace_back(PendingSend{
+        .id = id,
+        .priority = priority,
+        .packet = packet,
+        .enqueued_at = Clock::now(),
+        .handler = std::move(handler),
+    });
+    update_depth(lane);
+    return id;
+}
+
+std::optional<SendScheduler::PendingSend> SendScheduler::pop()
+{
+    const auto lane_it = std::ranges::find_if(lanes_, [](auto &&lane) { return not lane.empty(); });
+    if (lane_it == lanes_.end())
+    {
+        return std::nullopt;
+    }
+    const auto lane = static_cast<std::size_t>(std::distance(lanes_.begin(), lane_it));
+    auto &sends = lane_it->sends;
+    std::optional<PendingSend> pending{std::move(sends[lane_it->head++])};
+    if (lane_it->empty())
+    {
+        sends.clear();
+        lane_it->head = 0;
+    }
+    else if (lane_it->head >= kCompactThreshold and lane_it->head >= lane_it->size())
+    {
+        // a lane that never runs empty drops its popped sends, moving the queued ones to the front.
+        sends.erase(sends.begin(), sends.begin() + static_cast<std::ptrdiff_t>(lane_it->head));
+        lane_it->head = 0;
+    }
+    update_depth(lane);
+
+    // only written on the strand, the atomics allow reading the metrics from any thread.
+    auto &metrics = metrics_[lane];
+    const auto wait_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - pending->enqueued_at).count();
+    metrics.packets.store(metrics.packets.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    metrics.bytes.store(metrics.bytes.load(std::memory_order_relaxed) + pending->packet.size(),
+                        std::memory_order_relaxed);
+    metrics.total_wait_ns.store(metrics.total_wait_ns.load(std::memory_order_relaxed) + wait_ns,
+                                std::memory_order_relaxed);
+    metrics.max_wait_ns.store(std::max(metrics.max_wait_ns.load(std::memory_order_relaxed), wait_ns),
+                              std::memory_order_relaxed);
+    return pending;
+}
+
+std::optional<SendScheduler::PendingSend> SendScheduler::remove(std::uint64_t id)
+{
+    for (std::size_t lane = 0; lane < lanes_.size(); lane++)
+    {
+        auto &sends = lanes_[lane].sends;
+        const auto queued = sends.begin() + static_cast<std::ptrdiff_t>(lanes_[lane].head);
+        const auto it = std::ranges::find(queued, sends.end(), id, &PendingSend::id);
+        if (it != sends.end())
+        {
+            std::optional<PendingSend> pending{std::move(*it)};
+            sends.erase(it);
+            if (lanes_[lane].empty())
+            {
+                sends.clear();
+                lanes_[lane].head = 0;
+            }
+            update_depth(lane);
+            return pending;
+        }
+    }
+    return std::nullopt;
+}
+
+bool SendScheduler::empty() const
+{
+    return std::ranges::all_of(lanes_, [](auto &&lane) { return lane.empty(); });
+}
+
+SendMetrics SendScheduler::metrics() const
+{
+    SendMetrics snapshot;
+    for (std::size_t lane = 0; lane < kSendPriorityCount; lane++)
+    {
+        const auto &metrics = metrics_[lane];
+        snapshot[lane] = SendLaneMetrics{
+            .queue_depth = metrics.queue_depth.load(std::memory_order_relaxed),
+            .max_queue_depth = metrics.max_queue_depth.load(std::memory_order_relaxed),
+            .packets = metrics.packets.load(std::memory_order_relaxed),
+            .bytes = metrics.bytes.load(std::memory_order_relaxed),
+            .total_wait = std::chrono::nanoseconds{metrics.total_wait_ns.load(std::memory_order_relaxed)},
+            .max_wait = std::chrono::nanoseconds{metrics.max_wait_ns.load(std::memory_order_relaxed)},
+        };
+    }
+    return snapshot;
+}
+
+void SendScheduler::update_depth(std::size_t lane)
+{
+    auto &metrics = metrics_[lane];
+    const auto depth = lanes_[lane].size();
+    metrics.queue_depth.store(depth, std::memory_order_relaxed);
+    metrics.max_queue_depth.store(std::max(metrics.max_queue_depth.load(std::memory_order_relaxed), depth),
+                                  std::memory_order_relaxed);
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include <boost/asio/any_completion_handler.hpp>
+#include "cppesphomeapi/clock.hpp"
+#include "cppesphomeapi/result.hpp"
+#include "cppesphomeapi/send_metrics.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * Queues outgoing packets in one lane per SendPriority and hands out the next packet of the highest non empty lane.
+ * A packet is written as a whole, so a higher class jumps the queue between packets.
+ * Confined to the connection strand, only metrics() may be called from any thread.
+ */
+class SendScheduler
+{
+  public:
+    using SendSignature = void(Result<void>);
+
+    struct PendingSend
+    {
+        std::uint64_t id{};
+        SendPriority priority{};
+        // owned by the awaiting sender until the handler was invoked.
+        std::span<const std::byte> packet;
+        Clock::time_point enqueued_at;
+        boost::asio::any_completion_handler<SendSignature> handler;
+    };
+
+    std::uint64_t push(SendPriority priority,
+                       std::span<const std::byte> packet,
+                       boost::asio::any_completion_handler<SendSignature> handler);
+    // removes the next packet and records its wait time.
+    std::optional<PendingSend> pop();
+    // removes a packet that was not written yet.
+    std::optional<PendingSend> remove(std::uint64_t id);
+    [[nodiscard]] bool empty() const;
+
+    [[nodiscard]] SendMetrics metrics() const;
+
+  private:
+    struct LaneMetrics
+    {
+        std::atomic<std::size_t> queue_depth{};
+        std::atomic<std::size_t> max_queue_depth{};
+        std::atomic<std::uint64_t> packets{};
+        std::atomic<std::uint64_t> bytes{};
+        std::atomic<std::int64_t> total_wait_ns{};
+        std::atomic<std::int64_t> max_wait_ns{};
+    };
+
+    // a queue that keeps its capacity, unlike a deque that frees and allocates its blocks while packets pass through.
+    // Popping advances the head, the sends are cleared once all of them were popped.
+    struct Lane
+    {
+        std::vector<PendingSend> sends;
+        std::size_t head{};
+
+        [[nodiscard]] bool empty() const
+        {
+            return head == sends.size();
+        }
+        [[nodiscard]] std::size_t size() const
+        {
+            return sends.size() - head;
+        }
+    };
+
+    void update_depth(std::size_t lane);
+
+  private:
+    std::uint64_t next_id_{};
+    std::array<Lane, kSendPriorityCount> lanes_;
+    std::array<LaneMetrics, kSendPriorityCount> metrics_;
+};
+} // namespace cppesphomeapi
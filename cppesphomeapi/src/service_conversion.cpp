@@ -0,0 +1,54 @@
+#include "service_conversion.hpp"
+#include "overloaded.hpp"
+
+namespace cppesphomeapi
+{
+void service_call2pb(const ServiceSchema &schema,
+                     std::span<const ServiceArgValue> args,
+                     bool legacy_int,
+                     proto::ExecuteServiceRequest &request)
+{
+    request.set_key(schema.key());
+    request.mutable_args()->Reserve(static_cast<int>(args.size()));
+    for (auto &&arg : args)
+    {
+        auto *pb_arg = request.add_args();
+        std::visit(detail::overloaded{
+                       [pb_arg](bool value) { pb_arg->set_bool_(value); },
+                       [pb_arg, legacy_int](std::int32_t value) {
+                           if (legacy_int)
+                           {
+                               pb_arg->set_legacy_int(value);
+                           }
+                           else
+                           {
+                               pb_arg->set_int_(value);
+                           }
+                       },
+                       [pb_arg](float value) { pb_arg->set_float_(value); },
+                       [pb_arg](const std::string &value) { pb_arg->set_string_(value); },
+                       [pb_arg](const std::vector<bool> &values) {
+                           pb_arg->mutable_bool_array()->Reserve(static_cast<int>(values.size()));
+                           for (const bool value : values)
+                           {
+                               pb_arg->add_bool_array(value);
+                           }
+                       },
+                       [pb_arg](const std::vector<std::int32_t> &values) {
+                           pb_arg->mutable_int_array()->Add(values.cbegin(), values.cend());
+                       },
+                       [pb_arg](const std::vector<float> &values) {
+                           pb_arg->mutable_float_array()->Add(values.cbegin(), values.cend());
+                       },
+                       [pb_arg](const std::vector<std::string> &values) {
+                           pb_arg->mutable_string_array()->Reserve(static_cast<int>(values.size()));
+                           for (auto &&value : values)
+                           {
+                               pb_arg->add_string_array(value);
+                           }
+                       },
+                   },
+                   arg);
+    }
+}
+} // namespace cppesphomeapi
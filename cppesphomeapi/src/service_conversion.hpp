@@ -0,0 +1,13 @@
+#pragma once
+#include <span>
+#include "api.pb.h"
+#include "cppesphomeapi/user_service.hpp"
+
+namespace cppesphomeapi
+{
+// precondition: schema.validate(args) succeeded
+void service_call2pb(const ServiceSchema &schema,
+                     std::span<const ServiceArgValue> args,
+                     bool legacy_int,
+                     proto::ExecuteServiceRequest &request);
+} // namespace cppesphomeapi
@@ -2,6 +2,7 @@
 #include "entity_conversion.hpp"
 namespace cppesphomeapi
 {
+#if CPPESPHOMEAPI_USE_LIGHT
 LightState pb2state(const proto::LightStateResponse &response)
 {
     return LightState{
@@ -20,4 +21,48 @@ LightState pb2state(const proto::LightStateResponse &response)
         /*.effect =*/response.effect(),
     };
 }
+#endif
+
+#if CPPESPHOMEAPI_USE_SENSOR
+SensorState pb2state(const proto::SensorStateResponse &response)
+{
+    return SensorState{
+        {response.key()},
+        /*.state =*/response.state(),
+        /*.missing_state =*/response.missing_state(),
+    };
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
+BinarySensorState pb2state(const proto::BinarySensorStateResponse &response)
+{
+    return BinarySensorState{
+        {response.key()},
+        /*.state =*/response.state(),
+        /*.missing_state =*/response.missing_state(),
+    };
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_SWITCH
+SwitchState pb2state(const proto::SwitchStateResponse &response)
+{
+    return SwitchState{
+        {response.key()},
+        /*.state =*/response.state(),
+    };
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+TextSensorState pb2state(const proto::TextSensorStateResponse &response)
+{
+    return TextSensorState{
+        {response.key()},
+        /*.state =*/response.state(),
+        /*.missing_state =*/response.missing_state(),
+    };
+}
+#endif
 } // namespace cppesphomeapi
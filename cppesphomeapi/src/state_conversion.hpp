@@ -3,5 +3,19 @@
 #include "cppesphomeapi/state.hpp"
 namespace cppesphomeapi
 {
+#if CPPESPHOMEAPI_USE_LIGHT
 LightState pb2state(const proto::LightStateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_SENSOR
+SensorState pb2state(const proto::SensorStateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
+BinarySensorState pb2state(const proto::BinarySensorStateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_SWITCH
+SwitchState pb2state(const proto::SwitchStateResponse &response);
+#endif
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+TextSensorState pb2state(const proto::TextSensorStateResponse &response);
+#endif
 }
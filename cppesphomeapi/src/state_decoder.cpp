@@ -0,0 +1,632 @@
+#include "state_decoder.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <string>
+#include <string_view>
+#include "api.pb.h"
+#include "entity_conversion.hpp"
+#include "get_message_id.hpp"
+
+namespace cppesphomeapi
+{
+namespace
+{
+enum class WireType : std::uint8_t
+{
+    Varint = 0,
+    Fixed64 = 1,
+    LengthDelimited = 2,
+    StartGroup = 3,
+    EndGroup = 4,
+    Fixed32 = 5,
+};
+
+struct Field
+{
+    std::uint32_t number{};
+    WireType wire_type{};
+};
+
+// the same rules as the validation of protobuf: no overlong encodings, no surrogates and nothing above U+10FFFF.
+bool is_valid_utf8(std::span<const std::byte> bytes)
+{
+    std::size_t i{};
+    while (i < bytes.size())
+    {
+        const auto lead = std::to_integer<std::uint32_t>(bytes[i]);
+        if (lead < 0x80U)
+        {
+            i++;
+            continue;
+        }
+        std::size_t length{};
+        std::uint32_t code_point{};
+        std::uint32_t min_code_point{};
+        if ((lead & 0xE0U) == 0xC0U)
+        {
+            length = 2;
+            code_point = lead & 0x1FU;
+            min_code_point = 0x80U;
+        }
+        else if ((lead & 0xF0U) == 0xE0U)
+        {
+            length = 3;
+            code_point = lead & 0x0FU;
+            min_code_point = 0x800U;
+        }
+        else if ((lead & 0xF8U) == 0xF0U)
+        {
+            length = 4;
+            code_point = lead & 0x07U;
+            min_code_point = 0x10000U;
+        }
+        else
+        {
+            return false;
+        }
+        if (bytes.size() - i < length)
+        {
+            return false;
+        }
+        for (std::size_t continuation = 1; continuation < length; continuation++)
+        {
+            const auto byte = std::to_integer<std::uint32_t>(bytes[i + continuation]);
+            if ((byte & 0xC0U) != 0x80U)
+            {
+                return false;
+            }
+            code_point = (code_point << 6U) | (byte & 0x3FU);
+        }
+        if (code_point < min_code_point or code_point > 0x10FFFFU or (code_point >= 0xD800U and code_point <= 0xDFFFU))
+        {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+// reads the fields of a message payload. Every read returns false if the payload has to be left to the generic parser.
+class WireReader
+{
+  public:
+    explicit WireReader(std::span<const std::byte> data)
+        : data_{data}
+    {}
+
+    [[nodiscard]] bool at_end() const
+    {
+        return data_.empty();
+    }
+
+    bool next_field(Field &field)
+    {
+        std::uint64_t tag{};
+        if (not read_varint(tag) or tag > std::numeric_limits<std::uint32_t>::max() or (tag >> 3U) == 0)
+        {
+            return false;
+        }
+        field.number = static_cast<std::uint32_t>(tag >> 3U);
+        field.wire_type = static_cast<WireType>(tag & 0x7U);
+        return true;
+    }
+
+    bool read_fixed32(std::uint32_t &value)
+    {
+        if (data_.size() < sizeof(std::uint32_t))
+        {
+            return false;
+        }
+        value = std::to_integer<std::uint32_t>(data_[0]) | (std::to_integer<std::uint32_t>(data_[1]) << 8U) |
+                (std::to_integer<std::uint32_t>(data_[2]) << 16U) | (std::to_integer<std::uint32_t>(data_[3]) << 24U);
+        data_ = data_.subspan(sizeof(std::uint32_t));
+        return true;
+    }
+
+    bool read_float(float &value)
+    {
+        std::uint32_t bits{};
+        if (not read_fixed32(bits))
+        {
+            return false;
+        }
+        value = std::bit_cast<float>(bits);
+        return true;
+    }
+
+    bool read_bool(bool &value)
+    {
+        std::uint64_t varint{};
+        if (not read_varint(varint))
+        {
+            return false;
+        }
+        value = varint != 0;
+        return true;
+    }
+
+    // open enums keep unknown values, they are mapped by the conversion.
+    bool read_enum(std::int32_t &value)
+    {
+        std::uint64_t varint{};
+        if (not read_varint(varint))
+        {
+            return false;
+        }
+        value = static_cast<std::int32_t>(static_cast<std::uint32_t>(varint));
+        return true;
+    }
+
+    // proto3 strings must be valid UTF-8. The view points into the read data.
+    bool read_string(std::string_view &value)
+    {
+        std::span<const std::byte> bytes;
+        if (not read_length_delimited(bytes) or not is_valid_utf8(bytes))
+        {
+            return false;
+        }
+        value = std::string_view{reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+        return true;
+    }
+
+    bool read_string(std::string &value)
+    {
+        std::string_view view;
+        if (not read_string(view))
+        {
+            return false;
+        }
+        value.assign(view);
+        return true;
+    }
+
+    // bytes fields are not validated, the view points into the read data.
+    bool read_bytes(std::span<const std::byte> &value)
+    {
+        return read_length_delimited(value);
+    }
+
+    // unknown fields and known fields with another wire type are skipped like protobuf does.
+    bool skip(WireType wire_type)
+    {
+        std::uint64_t varint{};
+        std::span<const std::byte> bytes;
+        switch (wire_type)
+        {
+        case WireType::Varint:
+            return read_varint(varint);
+        case WireType::Fixed64:
+            return advance(sizeof(std::uint64_t));
+        case WireType::LengthDelimited:
+            return read_length_delimited(bytes);
+        case WireType::Fixed32:
+            return advance(sizeof(std::uint32_t));
+        case WireType::StartGroup:
+        case WireType::EndGroup:
+            break;
+        }
+        return false;
+    }
+
+  private:
+    static constexpr std::size_t kMaxVarintLen = 10;
+
+    bool read_varint(std::uint64_t &value)
+    {
+        value = 0;
+        for (std::size_t i = 0; i < std::min(data_.size(), kMaxVarintLen); i++)
+        {
+            const auto byte = std::to_integer<std::uint64_t>(data_[i]);
+            value |= (byte & 0x7FU) << (7U * i);
+            if ((byte & 0x80U) == 0)
+            {
+                // the last byte of a 10 byte varint only holds the highest bit.
+                if (i + 1 == kMaxVarintLen and byte > 1)
+                {
+                    return false;
+                }
+                data_ = data_.subspan(i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool read_length_delimited(std::span<const std::byte> &bytes)
+    {
+        std::uint64_t length{};
+        if (not read_varint(length) or length > data_.size())
+        {
+            return false;
+        }
+        bytes = data_.first(length);
+        data_ = data_.subspan(length);
+        return true;
+    }
+
+    bool advance(std::size_t bytes)
+    {
+        if (data_.size() < bytes)
+        {
+            return false;
+        }
+        data_ = data_.subspan(bytes);
+        return true;
+    }
+
+  private:
+    std::span<const std::byte> data_;
+};
+
+constexpr bool is(const Field &field, std::uint32_t number, WireType wire_type)
+{
+    return field.number == number and field.wire_type == wire_type;
+}
+} // namespace
+
+#if CPPESPHOMEAPI_USE_LIGHT
+std::optional<LightState> decode_light_state(std::span<const std::byte> payload)
+{
+    LightState state;
+    std::int32_t color_mode{};
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Fixed32))
+        {
+            read = reader.read_fixed32(state.key);
+        }
+        else if (is(field, 2, WireType::Varint))
+        {
+            read = reader.read_bool(state.state);
+        }
+        else if (is(field, 3, WireType::Fixed32))
+        {
+            read = reader.read_float(state.brightness);
+        }
+        else if (is(field, 4, WireType::Fixed32))
+        {
+            read = reader.read_float(state.red);
+        }
+        else if (is(field, 5, WireType::Fixed32))
+        {
+            read = reader.read_float(state.green);
+        }
+        else if (is(field, 6, WireType::Fixed32))
+        {
+            read = reader.read_float(state.blue);
+        }
+        else if (is(field, 7, WireType::Fixed32))
+        {
+            read = reader.read_float(state.white);
+        }
+        else if (is(field, 8, WireType::Fixed32))
+        {
+            read = reader.read_float(state.color_temperature);
+        }
+        else if (is(field, 9, WireType::LengthDelimited))
+        {
+            read = reader.read_string(state.effect);
+        }
+        else if (is(field, 10, WireType::Fixed32))
+        {
+            read = reader.read_float(state.color_brightness);
+        }
+        else if (is(field, 11, WireType::Varint))
+        {
+            read = reader.read_enum(color_mode);
+        }
+        else if (is(field, 12, WireType::Fixed32))
+        {
+            read = reader.read_float(state.cold_white);
+        }
+        else if (is(field, 13, WireType::Fixed32))
+        {
+            read = reader.read_float(state.warm_white);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    state.color_mode = pb2color_mode(static_cast<proto::ColorMode>(color_mode));
+    return state;
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_SENSOR
+std::optional<SensorState> decode_sensor_state(std::span<const std::byte> payload)
+{
+    SensorState state;
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Fixed32))
+        {
+            read = reader.read_fixed32(state.key);
+        }
+        else if (is(field, 2, WireType::Fixed32))
+        {
+            read = reader.read_float(state.state);
+        }
+        else if (is(field, 3, WireType::Varint))
+        {
+            read = reader.read_bool(state.missing_state);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    return state;
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
+std::optional<BinarySensorState> decode_binary_sensor_state(std::span<const std::byte> payload)
+{
+    BinarySensorState state;
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Fixed32))
+        {
+            read = reader.read_fixed32(state.key);
+        }
+        else if (is(field, 2, WireType::Varint))
+        {
+            read = reader.read_bool(state.state);
+        }
+        else if (is(field, 3, WireType::Varint))
+        {
+            read = reader.read_bool(state.missing_state);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    return state;
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_SWITCH
+std::optional<SwitchState> decode_switch_state(std::span<const std::byte> payload)
+{
+    SwitchState state;
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Fixed32))
+        {
+            read = reader.read_fixed32(state.key);
+        }
+        else if (is(field, 2, WireType::Varint))
+        {
+            read = reader.read_bool(state.state);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    return state;
+}
+#endif
+
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+std::optional<TextSensorStateView> decode_text_sensor_state(std::span<const std::byte> payload)
+{
+    TextSensorStateView state;
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Fixed32))
+        {
+            read = reader.read_fixed32(state.key);
+        }
+        else if (is(field, 2, WireType::LengthDelimited))
+        {
+            read = reader.read_string(state.state);
+        }
+        else if (is(field, 3, WireType::Varint))
+        {
+            read = reader.read_bool(state.missing_state);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    return state;
+}
+#endif
+
+std::optional<LogEntryView> decode_log_entry(std::span<const std::byte> payload)
+{
+    LogEntryView entry;
+    std::int32_t log_level{};
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::Varint))
+        {
+            read = reader.read_enum(log_level);
+        }
+        else if (is(field, 3, WireType::LengthDelimited))
+        {
+            read = reader.read_string(entry.message);
+        }
+        else if (is(field, 4, WireType::Varint))
+        {
+            read = reader.read_bool(entry.send_failed);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    entry.log_level = EspHomeLogLevel{log_level};
+    return entry;
+}
+
+std::optional<VoiceAssistantAudioView> decode_voice_assistant_audio(std::span<const std::byte> payload)
+{
+    VoiceAssistantAudioView audio;
+    WireReader reader{payload};
+    Field field;
+    while (not reader.at_end())
+    {
+        if (not reader.next_field(field))
+        {
+            return std::nullopt;
+        }
+        bool read{};
+        if (is(field, 1, WireType::LengthDelimited))
+        {
+            read = reader.read_bytes(audio.data);
+        }
+        else if (is(field, 2, WireType::Varint))
+        {
+            read = reader.read_bool(audio.end);
+        }
+        else
+        {
+            read = reader.skip(field.wire_type);
+        }
+        if (not read)
+        {
+            return std::nullopt;
+        }
+    }
+    return audio;
+}
+
+std::optional<ReceivedView> decode_view(const Frame &frame, ReceivedFramePool &frame_pool)
+{
+    switch (frame.message_type)
+    {
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+    case detail::get_message_id<proto::TextSensorStateResponse>():
+#endif
+    case detail::get_message_id<proto::SubscribeLogsResponse>():
+        return decode_view(frame.message_type, frame_pool.pin(frame.payload));
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+std::optional<ReceivedView> decode_view(std::uint32_t message_type, const PinnedFrame &payload)
+{
+    const auto pinned = [&payload](auto &&decode) -> std::optional<ReceivedView> {
+        auto view = decode(std::span<const std::byte>{*payload});
+        if (not view.has_value())
+        {
+            return std::nullopt;
+        }
+        view->frame = payload;
+        return std::move(view).value();
+    };
+    switch (message_type)
+    {
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+    case detail::get_message_id<proto::TextSensorStateResponse>():
+        return pinned(decode_text_sensor_state);
+#endif
+    case detail::get_message_id<proto::SubscribeLogsResponse>():
+        return pinned(decode_log_entry);
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+std::optional<EntityStateVariant> decode_state(std::uint32_t message_type,
+                                               [[maybe_unused]] std::span<const std::byte> payload)
+{
+    switch (message_type)
+    {
+#if CPPESPHOMEAPI_USE_LIGHT
+    case detail::get_message_id<proto::LightStateResponse>():
+        return decode_light_state(payload);
+#endif
+#if CPPESPHOMEAPI_USE_SENSOR
+    case detail::get_message_id<proto::SensorStateResponse>():
+        return decode_sensor_state(payload);
+#endif
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
+    case detail::get_message_id<proto::BinarySensorStateResponse>():
+        return decode_binary_sensor_state(payload);
+#endif
+#if CPPESPHOMEAPI_USE_SWITCH
+    case detail::get_message_id<proto::SwitchStateResponse>():
+        return decode_switch_state(payload);
+#endif
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include "cppesphomeapi/state.hpp"
+#include "cppesphomeapi/string_views.hpp"
+#include "message_wrapper.hpp"
+#include "plain_text_protocol.hpp"
+#include "received_frame_pool.hpp"
+
+namespace cppesphomeapi
+{
+// Decoders of the wire format of the state messages straight into the public state structs, without a protobuf message
+// in between. They return std::nullopt if the payload needs the generic protobuf parser: malformed payloads, groups,
+// invalid varints or strings that are not valid UTF-8. The generic parser decides about those.
+#if CPPESPHOMEAPI_USE_LIGHT
+std::optional<LightState> decode_light_state(std::span<const std::byte> payload);
+#endif
+#if CPPESPHOMEAPI_USE_SENSOR
+std::optional<SensorState> decode_sensor_state(std::span<const std::byte> payload);
+#endif
+#if CPPESPHOMEAPI_USE_BINARY_SENSOR
+std::optional<BinarySensorState> decode_binary_sensor_state(std::span<const std::byte> payload);
+#endif
+#if CPPESPHOMEAPI_USE_SWITCH
+std::optional<SwitchState> decode_switch_state(std::span<const std::byte> payload);
+#endif
+
+// the views point into the payload, the frame keeping it alive is left empty.
+#if CPPESPHOMEAPI_USE_TEXT_SENSOR
+std::optional<TextSensorStateView> decode_text_sensor_state(std::span<const std::byte> payload);
+#endif
+std::optional<LogEntryView> decode_log_entry(std::span<const std::byte> payload);
+
+// the microphone audio of a VoiceAssistantAudio, the data points into the payload.
+struct VoiceAssistantAudioView
+{
+    std::span<const std::byte> data;
+    bool end{};
+};
+std::optional<VoiceAssistantAudioView> decode_voice_assistant_audio(std::span<const std::byte> payload);
+
+// pins the frame in a block of the pool and decodes a view into it. std::nullopt if the message has no view or needs
+// the generic parser.
+std::optional<ReceivedView> decode_view(const Frame &frame, ReceivedFramePool &frame_pool);
+// the same for a payload that is already pinned, the view shares its block.
+std::optional<ReceivedView> decode_view(std::uint32_t message_type, const PinnedFrame &payload);
+
+// std::nullopt if the message is not a state message or needs the generic parser.
+std::optional<EntityStateVariant> decode_state(std::uint32_t message_type, std::span<const std::byte> payload);
+} // namespace cppesphomeapi
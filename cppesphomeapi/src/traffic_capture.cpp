@@ -0,0 +1,135 @@
+#include "traffic_capture.hpp"
+#include <array>
+#include <format>
+#include <string_view>
+#include "make_unexpected_result.hpp"
+#include "plain_text_protocol.hpp"
+
+namespace cppesphomeapi
+{
+namespace
+{
+constexpr std::string_view kMagic{"ESPHCAPT"};
+constexpr std::uint32_t kFormatVersion{1};
+// a record holds a single read into the receive buffer, which never grows beyond the largest accepted frame.
+constexpr std::size_t kMaxRecordSize = PlainTextProtocol::kMaxFrameSize;
+
+template <typename T>
+void write_le(std::ofstream &stream, T value)
+{
+    std::array<char, sizeof(T)> bytes{};
+    for (std::size_t i = 0; i < sizeof(T); i++)
+    {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    stream.write(bytes.data(), bytes.size());
+}
+
+template <typename T>
+bool read_le(std::ifstream &stream, T &value)
+{
+    std::array<unsigned char, sizeof(T)> bytes{};
+    if (not stream.read(reinterpret_cast<char *>(bytes.data()), bytes.size()))
+    {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++)
+    {
+        value |= static_cast<T>(bytes[i]) << (8 * i);
+    }
+    return true;
+}
+} // namespace
+
+CaptureWriter::CaptureWriter(std::ofstream stream)
+    : stream_{std::move(stream)}
+    , started_{std::chrono::steady_clock::now()}
+{}
+
+Result<CaptureWriter> CaptureWriter::open(const std::filesystem::path &file)
+{
+    std::ofstream stream{file, std::ios::binary | std::ios::trunc};
+    if (not stream)
+    {
+        return make_unexpected_result(ApiErrorCode::IoError,
+                                      std::format("Could not open capture file {}", file.string()));
+    }
+    stream.write(kMagic.data(), kMagic.size());
+    write_le(stream, kFormatVersion);
+    return CaptureWriter{std::move(stream)};
+}
+
+Result<void> CaptureWriter::write(std::span<const std::byte> received)
+{
+    const auto offset =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started_);
+    write_le(stream_, static_cast<std::uint64_t>(offset.count()));
+    write_le(stream_, static_cast<std::uint32_t>(received.size()));
+    stream_.write(reinterpret_cast<const char *>(received.data()), static_cast<std::streamsize>(received.size()));
+    if (not stream_)
+    {
+        return make_unexpected_result(ApiErrorCode::IoError, "Could not write to the capture file");
+    }
+    return Result<void>{};
+}
+
+CaptureReader::CaptureReader(std::ifstream stream)
+    : stream_{std::move(stream)}
+{}
+
+Result<CaptureReader> CaptureReader::open(const std::filesystem::path &file)
+{
+    std::ifstream stream{file, std::ios::binary};
+    if (not stream)
+    {
+        return make_unexpected_result(ApiErrorCode::IoError,
+                                      std::format("Could not open capture file {}", file.string()));
+    }
+    std::array<char, kMagic.size()> magic{};
+    std::uint32_t version{};
+    if (not stream.read(magic.data(), magic.size()) or std::string_view{magic.data(), magic.size()} != kMagic or
+        not read_le(stream, version))
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError,
+                                      std::format("{} is not a capture file", file.string()));
+    }
+    if (version != kFormatVersion)
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError,
+                                      std::format("Capture file version {} is not supported", version));
+    }
+    return CaptureReader{std::move(stream)};
+}
+
+Result<std::optional<std::reference_wrapper<const CaptureRecord>>> CaptureReader::next()
+{
+    std::uint64_t offset_ns{};
+    if (not read_le(stream_, offset_ns))
+    {
+        if (stream_.eof() and stream_.gcount() == 0)
+        {
+            return std::nullopt;
+        }
+        return make_unexpected_result(ApiErrorCode::ParseError, "Capture file ends within a record header");
+    }
+    std::uint32_t size{};
+    if (not read_le(stream_, size))
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError, "Capture file ends within a record header");
+    }
+    if (size > kMaxRecordSize)
+    {
+        return make_unexpected_result(
+            ApiErrorCode::ParseError,
+            std::format("Capture record of {} bytes exceeds the maximum of {} bytes", size, kMaxRecordSize));
+    }
+    record_.offset = std::chrono::nanoseconds{offset_ns};
+    record_.bytes.resize(size);
+    if (not stream_.read(reinterpret_cast<char *>(record_.bytes.data()), size))
+    {
+        return make_unexpected_result(ApiErrorCode::ParseError, "Capture file ends within a record");
+    }
+    return std::cref(record_);
+}
+} // namespace cppesphomeapi
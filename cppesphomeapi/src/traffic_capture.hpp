@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+#include "cppesphomeapi/result.hpp"
+#include "cppesphomeapi/traffic_capture.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * A capture file stores the bytes of every read of a connection, exactly as they were received:
+ *   header: "ESPHCAPT" followed by the format version as little endian uint32
+ *   record: nanoseconds since the capture started as little endian uint64, the byte count as little endian uint32 and
+ *           the received bytes.
+ */
+struct CaptureRecord
+{
+    // time since the capture started.
+    std::chrono::nanoseconds offset{};
+    std::vector<std::byte> bytes;
+};
+
+// appends the received bytes to a capture file. The file stream buffers the records, the file is complete once the
+// writer was destroyed.
+class CaptureWriter
+{
+  public:
+    static Result<CaptureWriter> open(const std::filesystem::path &file);
+
+    Result<void> write(std::span<const std::byte> received);
+
+  private:
+    CaptureWriter(std::ofstream stream);
+
+  private:
+    std::ofstream stream_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+class CaptureReader
+{
+  public:
+    static Result<CaptureReader> open(const std::filesystem::path &file);
+
+    // std::nullopt after the last record. The bytes of the record are reused by the next call.
+    Result<std::optional<std::reference_wrapper<const CaptureRecord>>> next();
+
+  private:
+    CaptureReader(std::ifstream stream);
+
+  private:
+    std::ifstream stream_;
+    CaptureRecord record_;
+};
+} // namespace cppesphomeapi
@@ -0,0 +1,84 @@
+#include "cppesphomeapi/user_service.hpp"
+#include <algorithm>
+#include <format>
+#include <ranges>
+#include <utility>
+#include "make_unexpected_result.hpp"
+
+namespace cppesphomeapi
+{
+template <ServiceArgType TType>
+using ServiceArgValueOf = std::variant_alternative_t<std::to_underlying(TType), ServiceArgValue>;
+static_assert(std::variant_size_v<ServiceArgValue> == std::to_underlying(ServiceArgType::StringArray) + 1U);
+static_assert(std::is_same_v<ServiceArgValueOf<ServiceArgType::Int>, std::int32_t>);
+static_assert(std::is_same_v<ServiceArgValueOf<ServiceArgType::StringArray>, std::vector<std::string>>);
+
+ServiceSchema::ServiceSchema(const UserService &service)
+    : name_{service.name}
+    , key_{service.key}
+{
+    arg_names_.reserve(service.args.size());
+    arg_types_.reserve(service.args.size());
+    for (auto &&arg : service.args)
+    {
+        arg_names_.emplace_back(arg.name);
+        arg_types_.emplace_back(arg.type);
+    }
+}
+
+std::shared_ptr<const ServiceSchema> ServiceSchema::compile(const UserService &service)
+{
+    return std::make_shared<const ServiceSchema>(service);
+}
+
+std::uint32_t ServiceSchema::key() const
+{
+    return key_;
+}
+
+const std::string &ServiceSchema::name() const
+{
+    return name_;
+}
+
+std::span<const ServiceArgType> ServiceSchema::arg_types() const
+{
+    return arg_types_;
+}
+
+std::optional<std::size_t> ServiceSchema::arg_index(std::string_view arg_name) const
+{
+    const auto it = std::ranges::find(arg_names_, arg_name);
+    if (it == arg_names_.cend())
+    {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(std::distance(arg_names_.cbegin(), it));
+}
+
+Result<void> ServiceSchema::validate(std::span<const ServiceArgValue> args) const
+{
+    if (args.size() != arg_types_.size())
+    {
+        return make_unexpected_result(
+            ApiErrorCode::InvalidArgument,
+            std::format("service \"{}\" expects {} arguments, got {}", name_, arg_types_.size(), args.size()));
+    }
+    for (std::size_t i = 0; i < args.size(); i++)
+    {
+        if (arg_types_[i] == ServiceArgType::Unknown)
+        {
+            return make_unexpected_result(
+                ApiErrorCode::InvalidArgument,
+                std::format("argument \"{}\" of service \"{}\" has an unknown type", arg_names_[i], name_));
+        }
+        if (args[i].index() != static_cast<std::size_t>(std::to_underlying(arg_types_[i])))
+        {
+            return make_unexpected_result(
+                ApiErrorCode::InvalidArgument,
+                std::format("argument \"{}\" of service \"{}\" has the wrong type", arg_names_[i], name_));
+        }
+    }
+    return Result<void>{};
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,145 @@
+#include "voice_assistant_session.hpp"
+#include <algorithm>
+#include <format>
+#include "make_unexpected_result.hpp"
+
+namespace cppesphomeapi
+{
+VoiceAssistantSession::VoiceAssistantSession(const boost::asio::any_io_executor &executor,
+                                             VoiceAssistantConfig config)
+    : config_{config}
+    , pool_{AudioBlockPool::create(config.block_size, config.pool_size)}
+    , capture_{executor, config.playback_blocks()}
+    , playback_{executor, config.playback_blocks()}
+    , playback_capacity_{config.playback_blocks()}
+{
+    staged_playback_.reserve(playback_capacity_);
+}
+
+const VoiceAssistantConfig &VoiceAssistantSession::config() const
+{
+    return config_;
+}
+
+VoiceAssistantSession::AudioChannel &VoiceAssistantSession::capture()
+{
+    return capture_;
+}
+
+VoiceAssistantSession::AudioChannel &VoiceAssistantSession::playback()
+{
+    return playback_;
+}
+
+void VoiceAssistantSession::on_device_audio(std::span<const std::byte> data, bool end)
+{
+    while (not data.empty())
+    {
+        if (capture_block_.capacity() == 0)
+        {
+            auto block = pool_->acquire();
+            if (not block.has_value())
+            {
+                // the consumer is too slow. dropping audio keeps the latency bounded.
+                dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            capture_block_ = std::move(block.value());
+        }
+        data = data.subspan(capture_block_.append(data));
+        if (capture_block_.full())
+        {
+            flush_capture();
+        }
+    }
+    if (end)
+    {
+        if (capture_block_.capacity() == 0)
+        {
+            auto block = pool_->acquire();
+            if (not block.has_value())
+            {
+                dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            capture_block_ = std::move(block.value());
+        }
+        capture_block_.mark_end();
+        flush_capture();
+    }
+}
+
+Result<void> VoiceAssistantSession::queue_playback(std::span<const std::byte> pcm, bool end)
+{
+    const auto block_size = pool_->block_size();
+    const auto needed = std::max<std::size_t>((pcm.size() + block_size - 1) / block_size, end ? 1 : 0);
+    if (needed > playback_capacity_)
+    {
+        return make_unexpected_result(
+            ApiErrorCode::InvalidArgument,
+            std::format("voice assistant audio of {} bytes is larger than the maximum chunk of {} bytes",
+                        pcm.size(),
+                        config_.max_playback_chunk()));
+    }
+    const std::scoped_lock lock{playback_mtx_};
+    // the playback loop only frees space, so the blocks fit into the channel if they fit now.
+    if (queued_playback_.load(std::memory_order_acquire) + needed > playback_capacity_)
+    {
+        return make_unexpected_result(ApiErrorCode::SendError, "voice assistant jitter buffer is full");
+    }
+    for (std::size_t i = 0; i < needed; i++)
+    {
+        auto block = pool_->acquire();
+        if (not block.has_value())
+        {
+            // returns the blocks acquired so far to the pool.
+            staged_playback_.clear();
+            return make_unexpected_result(ApiErrorCode::SendError, "voice assistant audio pool exhausted");
+        }
+        pcm = pcm.subspan(block->append(pcm));
+        staged_playback_.emplace_back(std::move(block.value()));
+    }
+    if (end)
+    {
+        staged_playback_.back().mark_end();
+    }
+    for (auto &block : staged_playback_)
+    {
+        queued_playback_.fetch_add(1, std::memory_order_acq_rel);
+        if (not playback_.try_send(net::ErrorCode{}, std::move(block)))
+        {
+            // only a closed session refuses the blocks.
+            queued_playback_.fetch_sub(1, std::memory_order_acq_rel);
+            staged_playback_.clear();
+            return make_unexpected_result(ApiErrorCode::SendError, "voice assistant session is closed");
+        }
+    }
+    staged_playback_.clear();
+    return Result<void>{};
+}
+
+void VoiceAssistantSession::on_playback_received()
+{
+    queued_playback_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+std::uint64_t VoiceAssistantSession::dropped_blocks() const
+{
+    return dropped_blocks_.load(std::memory_order_relaxed);
+}
+
+void VoiceAssistantSession::close()
+{
+    capture_.close();
+    playback_.close();
+}
+
+void VoiceAssistantSession::flush_capture()
+{
+    if (not capture_.try_send(net::ErrorCode{}, std::move(capture_block_)))
+    {
+        dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    capture_block_ = AudioBlock{};
+}
+} // namespace cppesphomeapi
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include "audio_block_pool.hpp"
+#include "cppesphomeapi/result.hpp"
+#include "cppesphomeapi/voice_assistant.hpp"
+#include "net.hpp"
+
+namespace cppesphomeapi
+{
+/**
+ * Audio buffers of a voice assistant run.
+ * Microphone audio of the device is collected into pooled blocks of the configured size, response audio is split
+ * into blocks and buffered until the paced playback loop of the connection sends them.
+ */
+class VoiceAssistantSession
+{
+  public:
+    using AudioChannel = boost::asio::experimental::concurrent_channel<void(net::ErrorCode, AudioBlock)>;
+
+    explicit VoiceAssistantSession(const boost::asio::any_io_executor &executor, VoiceAssistantConfig config);
+
+    const VoiceAssistantConfig &config() const;
+    AudioChannel &capture();
+    AudioChannel &playback();
+
+    // copies the microphone audio into the pooled blocks, straight out of the received frame if possible.
+    void on_device_audio(std::span<const std::byte> data, bool end);
+    // queues all blocks of the pcm or none of them. A pcm larger than VoiceAssistantConfig::max_playback_chunk() is
+    // refused with InvalidArgument, a full jitter buffer with SendError.
+    Result<void> queue_playback(std::span<const std::byte> pcm, bool end);
+    // the playback loop took a block out of the playback channel.
+    void on_playback_received();
+    std::uint64_t dropped_blocks() const;
+    void close();
+
+  private:
+    void flush_capture();
+
+  private:
+    VoiceAssistantConfig config_;
+    std::shared_ptr<AudioBlockPool> pool_;
+    AudioChannel capture_;
+    AudioChannel playback_;
+    AudioBlock capture_block_;
+    std::atomic<std::uint64_t> dropped_blocks_{};
+    std::size_t playback_capacity_;
+    std::atomic<std::size_t> queued_playback_{};
+    // serializes the callers of queue_playback, so the free space checked up front cannot be taken by another one.
+    std::mutex playback_mtx_;
+    std::vector<AudioBlock> staged_playback_;
+};
+} // namespace cppesphomeapi
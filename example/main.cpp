@@ -1,11 +1,14 @@
 #include <print>
 #include <thread>
+#include <variant>
+#include <vector>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <cppesphomeapi/api_client.hpp>
+#include <cppesphomeapi/log_sink.hpp>
 
 namespace asio = boost::asio;
 
@@ -18,10 +21,31 @@ namespace
 {
 struct StatePrinter
 {
+    // the variant holds std::monostate only if every state domain is disabled by the CPPESPHOMEAPI_USE_* options.
+    void operator()(std::monostate /*state*/)
+    {}
     void operator()(const cppesphomeapi::LightState &state)
     {
         std::println("LightState[key={}, state={}, effect={}]", state.key, state.state, state.effect);
     }
+    void operator()(const cppesphomeapi::SensorState &state)
+    {
+        std::println("SensorState[key={}, state={}, missing_state={}]", state.key, state.state, state.missing_state);
+    }
+    void operator()(const cppesphomeapi::BinarySensorState &state)
+    {
+        std::println(
+            "BinarySensorState[key={}, state={}, missing_state={}]", state.key, state.state, state.missing_state);
+    }
+    void operator()(const cppesphomeapi::SwitchState &state)
+    {
+        std::println("SwitchState[key={}, state={}]", state.key, state.state);
+    }
+    void operator()(const cppesphomeapi::TextSensorState &state)
+    {
+        std::println(
+            "TextSensorState[key={}, state={}, missing_state={}]", state.key, state.state, state.missing_state);
+    }
 };
 
 awaitable<void> client()
@@ -103,7 +127,11 @@ int main()
 {
     try
     {
-        asio::io_context io_context(1);
+        cppesphomeapi::ConsoleLogSink log_sink{cppesphomeapi::LogLevel::Debug};
+        cppesphomeapi::set_log_sink(&log_sink);
+
+        constexpr int kIoThreads = 4;
+        asio::io_context io_context(kIoThreads);
 
         asio::signal_set signals(io_context, SIGINT, SIGTERM);
         signals.async_wait([&](auto, auto) { io_context.stop(); });
@@ -115,11 +143,11 @@ int main()
             std::println("stopping");
             io_context.stop();
         }};
-        // std::vector<std::jthread> io_threads;
-        // for (int i = 0; i < 3; i++)
-        // {
-        //     io_threads.emplace_back([&io_context]() { io_context.run(); });
-        // }
+        std::vector<std::jthread> io_threads;
+        for (int i = 1; i < kIoThreads; i++)
+        {
+            io_threads.emplace_back([&io_context]() { io_context.run(); });
+        }
         io_context.run();
     }
     catch (std::exception &e)
@@ -0,0 +1,117 @@
+#include <utility>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "counting_allocator.hpp"
+#include "message_pool.hpp"
+#include "packet_buffer_pool.hpp"
+#include "payloads.hpp"
+#include "plain_text_protocol.hpp"
+#include "received_frame_pool.hpp"
+#include "state_decoder.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+TEST_CASE("state frames decode into a warm message pool without allocations", "[allocations]")
+{
+    const auto pool = MessagePool::create();
+    const auto light_state = frame_of(make_light_state());
+    const auto sensor_state = frame_of(make_sensor_state());
+    const auto light_frame = single_frame(light_state);
+    const auto sensor_frame = single_frame(sensor_state);
+    std::size_t decoded{};
+    const auto count = [&decoded](MessageWrapper /*message*/) { decoded++; };
+    const auto decode_states = [&] {
+        REQUIRE(PlainTextProtocol::decode<proto::LightStateResponse, proto::SensorStateResponse>(
+                    light_frame, *pool, count)
+                    .has_value());
+        REQUIRE(PlainTextProtocol::decode<proto::LightStateResponse, proto::SensorStateResponse>(
+                    sensor_frame, *pool, count)
+                    .has_value());
+    };
+
+    std::size_t allocations{};
+    // asio only recycles control blocks on threads that run an io_context, like the receive loop does.
+    boost::asio::io_context io_context;
+    boost::asio::post(io_context, [&] {
+        decode_states();
+        const AllocationCounter counter;
+        for (int i = 0; i < 1000; i++)
+        {
+            decode_states();
+        }
+        allocations = counter.allocations();
+    });
+    io_context.run();
+
+    CHECK(decoded == 2002);
+    CHECK(allocations == 0);
+}
+
+
+// the serialization alone, the e2e case "commands are sent on a warm connection without allocations" counts the
+// whole send path.
+TEST_CASE("commands are serialized into warm pooled buffers without allocations", "[allocations]")
+{
+    const auto pool = PacketBufferPool::create();
+    proto::LightCommandRequest request;
+    request.set_key(1);
+    request.set_has_brightness(true);
+    request.set_brightness(0.5F);
+    request.set_has_effect(true);
+    request.set_effect("rainbow");
+    std::size_t serialized{};
+    const auto serialize_command = [&] {
+        auto packet = pool->acquire();
+        if (PlainTextProtocol::serialize_to(request, packet.bytes()).has_value())
+        {
+            serialized++;
+        }
+    };
+
+    serialize_command();
+    const AllocationCounter counter;
+    for (int i = 0; i < 1000; i++)
+    {
+        serialize_command();
+    }
+    const auto allocations = counter.allocations();
+
+    CHECK(serialized == 1001);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("log frames decode into views of a warm frame pool without allocations", "[allocations]")
+{
+    const auto log_payload = payload_of(make_log());
+    const Frame frame{.message_type = detail::get_message_id<proto::SubscribeLogsResponse>(), .payload = log_payload};
+    const auto frame_pool = ReceivedFramePool::create();
+    std::size_t decoded{};
+    const auto decode_log = [&] {
+        auto view = decode_view(frame, *frame_pool);
+        REQUIRE(view.has_value());
+        const MessageWrapper message{frame.message_type, std::move(view).value()};
+        if (message.view_if<LogEntryView>() != nullptr)
+        {
+            decoded++;
+        }
+    };
+
+    std::size_t allocations{};
+    // asio only recycles control blocks on threads that run an io_context, like the receive loop does.
+    boost::asio::io_context io_context;
+    boost::asio::post(io_context, [&] {
+        decode_log();
+        const AllocationCounter counter;
+        for (int i = 0; i < 1000; i++)
+        {
+            decode_log();
+        }
+        allocations = counter.allocations();
+    });
+    io_context.run();
+
+    CHECK(decoded == 1001);
+    CHECK(allocations == 0);
+}
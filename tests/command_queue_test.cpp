@@ -0,0 +1,105 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include "command_queue.hpp"
+
+using namespace cppesphomeapi;
+
+namespace
+{
+constexpr std::uint32_t kPerProducer = 100000;
+
+// the producer and its index are encoded in the key of the command.
+CommandQueue::Entry entry_of(std::uint32_t producer, std::uint32_t index)
+{
+    return CommandQueue::Entry{.command = LightCommand{.key = (producer * kPerProducer) + index}, .callback = {}};
+}
+} // namespace
+
+TEST_CASE("CommandQueue delivers the commands of many producers once and in order per producer", "[commands]")
+{
+    constexpr std::uint32_t kProducers = 4;
+    // small enough that the producers regularly find the queue full.
+    CommandQueue queue{64};
+    std::vector<std::jthread> producers;
+    for (std::uint32_t producer = 0; producer < kProducers; producer++)
+    {
+        producers.emplace_back([&queue, producer]() {
+            for (std::uint32_t index = 0; index < kPerProducer; index++)
+            {
+                auto entry = entry_of(producer, index);
+                while (not queue.try_push(entry))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::size_t> received(kProducers);
+    std::size_t out_of_order{};
+    std::size_t total{};
+    while (total < kProducers * kPerProducer)
+    {
+        auto entry = queue.try_pop();
+        if (not entry.has_value())
+        {
+            continue;
+        }
+        const auto key = std::get<LightCommand>(entry->command).key;
+        const auto producer = key / kPerProducer;
+        // every command of a producer follows its previous one, so none was lost, duplicated or reordered.
+        if (key % kPerProducer != received[producer])
+        {
+            out_of_order++;
+        }
+        received[producer]++;
+        total++;
+    }
+    producers.clear();
+
+    CHECK(out_of_order == 0);
+    CHECK(received == std::vector<std::size_t>(kProducers, kPerProducer));
+    CHECK(queue.empty());
+    CHECK_FALSE(queue.try_pop().has_value());
+}
+
+TEST_CASE("CommandQueue rejects a command while it is full without taking it", "[commands]")
+{
+    // rounded up to 4.
+    CommandQueue queue{3};
+    std::size_t invoked{};
+    const auto make_entry = [&invoked](std::uint32_t key) {
+        return CommandQueue::Entry{.command = LightCommand{.key = key},
+                                   .callback = [&invoked](Result<void> /*result*/) { invoked++; }};
+    };
+    for (std::uint32_t key = 0; key < 4; key++)
+    {
+        auto entry = make_entry(key);
+        REQUIRE(queue.try_push(entry));
+    }
+
+    auto rejected = make_entry(4);
+    CHECK_FALSE(queue.try_push(rejected));
+    // the entry was not moved from, the caller still owns the callback and it was not invoked.
+    CHECK(static_cast<bool>(rejected.callback));
+    CHECK(std::get<LightCommand>(rejected.command).key == 4);
+    CHECK(invoked == 0);
+
+    // a popped command frees its slot.
+    const auto first = queue.try_pop();
+    REQUIRE(first.has_value());
+    CHECK(std::get<LightCommand>(first->command).key == 0);
+    CHECK(queue.try_push(rejected));
+    for (std::uint32_t key = 1; key <= 4; key++)
+    {
+        const auto entry = queue.try_pop();
+        REQUIRE(entry.has_value());
+        CHECK(std::get<LightCommand>(entry->command).key == key);
+    }
+    CHECK(queue.empty());
+    CHECK(invoked == 0);
+}
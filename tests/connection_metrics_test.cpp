@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+#include <catch2/catch_test_macros.hpp>
+#include <cppesphomeapi/connection_metrics.hpp>
+
+using namespace cppesphomeapi;
+using namespace std::chrono_literals;
+
+namespace
+{
+LatencyHistogram histogram_of(std::initializer_list<std::chrono::nanoseconds> durations)
+{
+    LatencyHistogram histogram;
+    for (auto &&duration : durations)
+    {
+        histogram.buckets[LatencyHistogram::bucket_of(duration)]++;
+        histogram.count++;
+        histogram.sum += duration;
+        histogram.max = std::max(histogram.max, duration);
+    }
+    return histogram;
+}
+} // namespace
+
+TEST_CASE("LatencyHistogram::bucket_of puts a duration below the upper bound of its bucket", "[metrics]")
+{
+    CHECK(LatencyHistogram::bucket_of(-1ns) == 0);
+    CHECK(LatencyHistogram::bucket_of(0ns) == 0);
+    CHECK(LatencyHistogram::bucket_of(63us) == 0);
+    CHECK(LatencyHistogram::bucket_of(64us) == 1);
+    CHECK(LatencyHistogram::bucket_of(127us) == 1);
+    CHECK(LatencyHistogram::bucket_of(128us) == 2);
+
+    for (std::size_t bucket = 1; bucket < LatencyHistogram::kBucketCount; bucket++)
+    {
+        const std::chrono::nanoseconds upper_bound = LatencyHistogram::upper_bound(bucket);
+        const std::chrono::nanoseconds lower_bound = LatencyHistogram::upper_bound(bucket - 1);
+        CHECK(LatencyHistogram::bucket_of(lower_bound) == bucket);
+        CHECK(LatencyHistogram::bucket_of(upper_bound - 1ns) == bucket);
+    }
+
+    // everything beyond the last bound is counted in the last bucket.
+    constexpr auto kLastBucket = LatencyHistogram::kBucketCount - 1;
+    CHECK(LatencyHistogram::bucket_of(LatencyHistogram::upper_bound(kLastBucket)) == kLastBucket);
+    CHECK(LatencyHistogram::bucket_of(std::chrono::hours{1}) == kLastBucket);
+}
+
+TEST_CASE("LatencyHistogram::percentile returns the upper bound of the bucket of the rank", "[metrics]")
+{
+    CHECK(LatencyHistogram{}.percentile(0.5) == 0us);
+
+    // 90 samples in the first bucket, 9 in the third and one in the last.
+    LatencyHistogram histogram;
+    histogram.buckets[0] = 90;
+    histogram.buckets[2] = 9;
+    histogram.buckets[LatencyHistogram::kBucketCount - 1] = 1;
+    histogram.count = 100;
+
+    CHECK(histogram.percentile(0.0) == 64us);
+    CHECK(histogram.percentile(0.5) == 64us);
+    CHECK(histogram.percentile(0.9) == 64us);
+    CHECK(histogram.percentile(0.91) == 256us);
+    CHECK(histogram.percentile(0.99) == 256us);
+    CHECK(histogram.percentile(1.0) == LatencyHistogram::upper_bound(LatencyHistogram::kBucketCount - 1));
+    // fractions outside of [0, 1] are clamped.
+    CHECK(histogram.percentile(-1.0) == 64us);
+    CHECK(histogram.percentile(2.0) == LatencyHistogram::upper_bound(LatencyHistogram::kBucketCount - 1));
+}
+
+TEST_CASE("LatencyHistogram percentiles and mean of recorded durations", "[metrics]")
+{
+    const auto histogram = histogram_of({10us, 20us, 100us, 1ms});
+
+    CHECK(histogram.percentile(0.5) == 64us);
+    CHECK(histogram.percentile(0.75) == 128us);
+    CHECK(histogram.percentile(1.0) == 1024us);
+    CHECK(histogram.mean() == 282500ns);
+
+    auto merged = histogram;
+    merged += histogram_of({5ms});
+    CHECK(merged.count == 5);
+    CHECK(merged.max == 5ms);
+    CHECK(merged.percentile(1.0) == 8192us);
+}
@@ -0,0 +1,68 @@
+#include "counting_allocator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<std::size_t> allocations{0};
+thread_local std::size_t thread_allocations{0};
+
+void *counted_allocate(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    thread_allocations++;
+    if (void *memory = std::malloc(size == 0 ? 1 : size); memory != nullptr)
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+} // namespace
+
+// the array and nothrow forms of the standard library forward to these.
+void *operator new(std::size_t size)
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t /*size*/) noexcept
+{
+    std::free(memory);
+}
+
+namespace cppesphomeapi::testing
+{
+std::size_t allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+AllocationCounter::AllocationCounter()
+    : start_{allocation_count()}
+{}
+
+std::size_t AllocationCounter::allocations() const
+{
+    return allocation_count() - start_;
+}
+
+std::size_t thread_allocation_count()
+{
+    return thread_allocations;
+}
+
+ThreadAllocationCounter::ThreadAllocationCounter()
+    : start_{thread_allocation_count()}
+{}
+
+std::size_t ThreadAllocationCounter::allocations() const
+{
+    return thread_allocation_count() - start_;
+}
+} // namespace cppesphomeapi::testing
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+namespace cppesphomeapi::testing
+{
+// number of calls to the global operator new since the start of the process.
+std::size_t allocation_count();
+
+class AllocationCounter
+{
+  public:
+    AllocationCounter();
+    [[nodiscard]] std::size_t allocations() const;
+
+  private:
+    std::size_t start_;
+};
+
+// number of calls to the global operator new on the calling thread.
+std::size_t thread_allocation_count();
+
+// counts the allocations of the thread that created it only, e.g. of a client thread while its peer runs on another.
+class ThreadAllocationCounter
+{
+  public:
+    ThreadAllocationCounter();
+    // precondition: called on the thread that created the counter.
+    [[nodiscard]] std::size_t allocations() const;
+
+  private:
+    std::size_t start_;
+};
+} // namespace cppesphomeapi::testing
@@ -0,0 +1,1069 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <google/protobuf/struct.pb.h>
+#include <google/protobuf/util/json_util.h>
+#include <cppesphomeapi/api_client.hpp>
+#include <cppesphomeapi/fleet_manager.hpp>
+#include "counting_allocator.hpp"
+#include "fake_device.hpp"
+#include "loopback.hpp"
+
+namespace asio = boost::asio;
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+using namespace std::chrono_literals;
+using namespace boost::asio::experimental::awaitable_operators;
+
+namespace
+{
+using Duration = std::chrono::steady_clock::duration;
+
+// a FakeDevice on an io_context and thread of its own, so its work is not counted by a ThreadAllocationCounter of the
+// client thread.
+class DeviceThread
+{
+  public:
+    explicit DeviceThread(FakeDeviceConfig config)
+        : work_{asio::make_work_guard(io_context_)}
+        , device_{io_context_.get_executor(), std::move(config)}
+        , thread_{[this]() { io_context_.run(); }}
+    {}
+
+    // the thread ends once the sessions of the device closed.
+    ~DeviceThread()
+    {
+        device_.stop();
+        work_.reset();
+    }
+
+    [[nodiscard]] std::uint16_t port() const
+    {
+        return device_.port();
+    }
+
+    DeviceThread(const DeviceThread &) = delete;
+    DeviceThread &operator=(const DeviceThread &) = delete;
+
+  private:
+    asio::io_context io_context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_;
+    FakeDevice device_;
+    std::jthread thread_;
+};
+
+// the fake device streams a light state for every even and a sensor state for every odd index.
+bool streamed_as(const EntityStateVariant &state, std::size_t index, std::size_t lights, std::size_t sensors)
+{
+    if (index % 2 == 0)
+    {
+        const auto *light = std::get_if<LightState>(&state);
+        return light != nullptr and light->key == index % lights and light->state and light->brightness == 0.8F and
+               light->effect == "Rainbow";
+    }
+    const auto *sensor = std::get_if<SensorState>(&state);
+    return sensor != nullptr and sensor->key == lights + (index % sensors) and
+           sensor->state == static_cast<float>(index);
+}
+
+// the delivered states are streamed ones in stream order, without duplicates. States may be missing.
+bool in_stream_order(const std::vector<EntityStateVariant> &states,
+                     std::size_t streamed,
+                     std::size_t lights,
+                     std::size_t sensors)
+{
+    std::size_t next_index{};
+    for (auto &&state : states)
+    {
+        while (next_index < streamed and not streamed_as(state, next_index, lights, sensors))
+        {
+            next_index++;
+        }
+        if (next_index == streamed)
+        {
+            return false;
+        }
+        next_index++;
+    }
+    return true;
+}
+
+// polls the condition until it holds, for at most the timeout.
+asio::awaitable<bool> eventually(std::invocable auto condition, Duration timeout = 5s)
+{
+    net::Timer timer{co_await asio::this_coro::executor};
+    const auto give_up_at = Clock::now() + timeout;
+    while (not condition())
+    {
+        if (Clock::now() >= give_up_at)
+        {
+            co_return false;
+        }
+        timer.expires_after(1ms);
+        co_await timer.async_wait();
+    }
+    co_return true;
+}
+} // namespace
+
+TEST_CASE("sequential and pipelined connect against a device with network latency", "[e2e][latency]")
+{
+    constexpr std::size_t kRounds = 3;
+    for (const auto latency : {0ms, 5ms, 20ms})
+    {
+        Loopback loopback;
+        FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 8, .sensors = 16, .latency = latency}};
+        std::size_t failures{};
+
+        loopback.run([&]() -> asio::awaitable<void> {
+            for (std::size_t i = 0; i < kRounds; i++)
+            {
+                auto &sequential_client = loopback.add_client(device);
+                const bool sequential_ready =
+                    (co_await sequential_client.async_connect()).has_value() and
+                    (co_await sequential_client.async_device_info()).has_value() and
+                    (co_await sequential_client.async_list_entities_services()).has_value() and
+                    (co_await sequential_client.subscribe_states()).has_value();
+                failures += sequential_ready ? 0 : 1;
+                co_await sequential_client.async_disconnect();
+
+                auto &pipelined_client = loopback.add_client(device);
+                const auto snapshot = co_await pipelined_client.async_connect_pipelined();
+                failures += snapshot.has_value() and snapshot->entities.size() == 24 ? 0 : 1;
+                co_await pipelined_client.async_disconnect();
+            }
+        }());
+
+        INFO(std::format("latency {}", latency));
+        CHECK(failures == 0);
+    }
+}
+
+TEST_CASE("every light command is echoed as a light state", "[e2e][latency]")
+{
+    constexpr std::size_t kCommands = 200;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 1, .sensors = 0}};
+    auto &client = loopback.add_client(device);
+    std::size_t failures{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            failures++;
+            co_return;
+        }
+        for (std::size_t i = 0; i < kCommands; i++)
+        {
+            const auto effect = std::format("effect_{}", i);
+            const auto deadline = Clock::now() + 1s;
+            // the receive is started first, states that arrive without a pending receive are not delivered.
+            const auto [echoed, sent] = co_await (receive_light_state(client, effect, deadline) &&
+                                                  client.async_light_command({.key = 0, .effect = effect}, deadline));
+            if (not echoed or not sent.has_value())
+            {
+                failures++;
+            }
+        }
+        co_await client.async_disconnect();
+    }());
+
+    CHECK(failures == 0);
+    CHECK(device.light_commands() == kCommands);
+}
+
+TEST_CASE("a streamed state is delivered or accounted for as unclaimed", "[e2e][throughput]")
+{
+    constexpr std::size_t kStates = 20000;
+    constexpr std::size_t kLights = 4;
+    constexpr std::size_t kSensors = 2;
+
+    // 0 writes every frame at once, 7 splits every frame and its header across several reads.
+    for (const std::size_t fragment_size : {std::size_t{0}, std::size_t{7}})
+    {
+        Loopback loopback;
+        FakeDevice device{loopback.executor(),
+                          FakeDeviceConfig{.lights = kLights,
+                                           .sensors = kSensors,
+                                           .fragment_size = fragment_size,
+                                           .streamed_states = kStates}};
+        auto &client = loopback.add_client(device);
+        std::vector<EntityStateVariant> states;
+        states.reserve(kStates);
+
+        loopback.run([&]() -> asio::awaitable<void> {
+            auto snapshot = co_await client.async_connect_pipelined();
+            if (not snapshot.has_value())
+            {
+                co_return;
+            }
+            std::ranges::move(snapshot->initial_states, std::back_inserter(states));
+            // a state that was dispatched while no receive operation waited is counted as unclaimed by the metrics.
+            while (states.size() < kStates)
+            {
+                auto state = co_await client.async_receive_state(Clock::now() + 500ms);
+                if (not state.has_value())
+                {
+                    break;
+                }
+                states.emplace_back(std::move(state).value());
+            }
+            co_await client.async_disconnect();
+        }());
+
+        const auto metrics = client.metrics();
+        INFO(std::format("fragment size {}", fragment_size));
+        CHECK(metrics.decode_errors == 0);
+        // every streamed state was either delivered or is accounted for as unclaimed.
+        CHECK(states.size() + metrics.unclaimed_messages == kStates);
+        CHECK(in_stream_order(states, kStates, kLights, kSensors));
+    }
+}
+
+TEST_CASE("frames decoded on a thread pool are delivered in order", "[e2e][decode]")
+{
+    constexpr std::size_t kStates = 5000;
+    constexpr std::size_t kLogs = 500;
+    constexpr std::size_t kLights = 4;
+    constexpr std::size_t kSensors = 2;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(),
+                      FakeDeviceConfig{.lights = kLights,
+                                       .sensors = kSensors,
+                                       .streamed_states = kStates,
+                                       .state_interval = std::chrono::microseconds{20},
+                                       .streamed_logs = kLogs,
+                                       .log_interval = std::chrono::microseconds{20}}};
+    // declared after the loopback, so no decode outlives the client.
+    asio::thread_pool decode_pool{4};
+    auto &client = loopback.add_client(device);
+    client.set_decode_executor(decode_pool.get_executor());
+    std::vector<EntityStateVariant> states;
+    states.reserve(kStates);
+    std::size_t logs{};
+    std::size_t unexpected_logs{};
+    const auto expected_log = make_log().message();
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        auto snapshot = co_await client.async_connect_pipelined();
+        if (not snapshot.has_value())
+        {
+            co_return;
+        }
+        std::ranges::move(snapshot->initial_states, std::back_inserter(states));
+        while (states.size() < kStates)
+        {
+            auto state = co_await client.async_receive_state(Clock::now() + 500ms);
+            if (not state.has_value())
+            {
+                break;
+            }
+            states.emplace_back(std::move(state).value());
+        }
+        // logs are decoded into views of their pinned frame.
+        co_await client.subscribe_logs(EspHomeLogLevel::Debug, false);
+        while (logs < kLogs)
+        {
+            const auto log = co_await client.async_receive_log_view(Clock::now() + 500ms);
+            if (not log.has_value())
+            {
+                break;
+            }
+            logs++;
+            unexpected_logs += log->message == expected_log ? 0 : 1;
+        }
+        co_await client.async_disconnect();
+    }());
+    decode_pool.join();
+
+    const auto metrics = client.metrics();
+    CHECK(metrics.decode_errors == 0);
+    // the paced stream finds a waiting receive for nearly every state, the others are accounted for as unclaimed.
+    CHECK(states.size() + metrics.unclaimed_messages >= kStates);
+    CHECK(states.size() > kStates / 2);
+    CHECK(in_stream_order(states, kStates, kLights, kSensors));
+    CHECK(logs > kLogs / 2);
+    CHECK(unexpected_logs == 0);
+}
+
+TEST_CASE("camera images and log subscriptions are sent in the bulk class", "[e2e][send]")
+{
+    constexpr std::size_t kImageSize = 16 * 1024;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(),
+                      FakeDeviceConfig{.lights = 1, .sensors = 0, .camera_image_size = kImageSize}};
+    auto &client = loopback.add_client(device);
+    std::optional<CameraImage> image;
+    SendMetrics before{};
+    SendMetrics after{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            co_return;
+        }
+        before = client.send_metrics();
+        const auto receive_image = [&]() -> asio::awaitable<void> {
+            auto received = co_await client.async_receive_camera_image(Clock::now() + 5s);
+            if (received.has_value())
+            {
+                image = std::move(received).value();
+            }
+        };
+        const auto request_image = [&]() -> asio::awaitable<void> {
+            co_await client.async_request_camera_image();
+            co_await client.subscribe_logs(EspHomeLogLevel::Info, false);
+        };
+        // the receive waits before the request is written, so every chunk finds it.
+        co_await (receive_image() && request_image());
+        after = client.send_metrics();
+        co_await client.async_disconnect();
+    }());
+
+    REQUIRE(image.has_value());
+    CHECK(image->data.size() == kImageSize);
+    CHECK(std::ranges::all_of(image->data, [](std::byte byte) { return byte == std::byte{0xAB}; }));
+    const auto sent_in = [&](SendPriority priority) {
+        const auto lane = std::to_underlying(priority);
+        return after[lane].packets - before[lane].packets;
+    };
+    CHECK(sent_in(SendPriority::Bulk) == 2);
+    CHECK(sent_in(SendPriority::Interactive) == 0);
+    CHECK(sent_in(SendPriority::Control) == 0);
+}
+
+TEST_CASE("voice assistant audio keeps its order and pace while states stream", "[e2e][voice]")
+{
+    constexpr std::size_t kMicrophoneChunks = 40;
+    constexpr std::size_t kMicrophoneChunkSize = 500;
+    constexpr std::size_t kResponseBlocks = 20;
+    constexpr auto kMaxLatency = 100ms;
+    constexpr VoiceAssistantConfig kConfig{.block_size = 320, .block_duration = 10ms, .pool_size = 64};
+    Loopback loopback;
+    FakeDevice device{loopback.executor(),
+                      FakeDeviceConfig{.lights = 4,
+                                       .sensors = 4,
+                                       .streamed_states = 1000000,
+                                       .state_interval = std::chrono::microseconds{100},
+                                       .voice_audio_chunks = kMicrophoneChunks,
+                                       .voice_audio_chunk_size = kMicrophoneChunkSize,
+                                       .voice_audio_interval = 2ms}};
+    auto &client = loopback.add_client(device);
+    // every byte differs from its neighbours, so a reordered or repeated block changes the received audio.
+    std::vector<std::byte> response(kResponseBlocks * kConfig.block_size);
+    for (std::size_t i = 0; i < response.size(); i++)
+    {
+        response[i] = static_cast<std::byte>(i % 253);
+    }
+    bool started{false};
+    std::vector<std::byte> microphone;
+    bool microphone_ended{false};
+    bool oversized_refused{false};
+    bool queued{false};
+    Clock::time_point queued_at;
+    std::size_t states{};
+    bool voice_done{false};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value() or
+            not(co_await client.subscribe_states()).has_value())
+        {
+            co_return;
+        }
+        const auto receive_states = [&]() -> asio::awaitable<void> {
+            while (not voice_done)
+            {
+                states += (co_await client.async_receive_state(Clock::now() + 100ms)).has_value() ? 1 : 0;
+            }
+        };
+        const auto run_voice_assistant = [&]() -> asio::awaitable<void> {
+            const auto deadline = Clock::now() + 5s;
+            // the device starts the run as soon as it is subscribed, so the receive has to wait before.
+            const auto [request, subscribed] = co_await (client.async_receive_voice_assistant_request(deadline) &&
+                                                         client.subscribe_voice_assistant(kConfig, deadline));
+            started = request.has_value() and request->start and subscribed.has_value();
+            if (started and (co_await client.async_send_voice_assistant_response(false, deadline)).has_value())
+            {
+                while (not microphone_ended)
+                {
+                    const auto block = co_await client.async_receive_voice_audio(deadline);
+                    if (not block.has_value())
+                    {
+                        break;
+                    }
+                    std::ranges::copy(block->data(), std::back_inserter(microphone));
+                    microphone_ended = block->end();
+                }
+
+                const std::vector<std::byte> oversized(kConfig.max_playback_chunk() + 1);
+                const auto refused = co_await client.async_send_voice_audio(oversized, false, deadline);
+                oversized_refused = not refused.has_value() and refused.error().code == ApiErrorCode::InvalidArgument;
+                queued_at = Clock::now();
+                queued = (co_await client.async_send_voice_audio(response, true, deadline)).has_value();
+                co_await eventually([&device]() {
+                    const auto received = device.received_voice_audio();
+                    return not received.empty() and received.back().end;
+                });
+                co_await client.unsubscribe_voice_assistant();
+            }
+            voice_done = true;
+        };
+        co_await (receive_states() && run_voice_assistant());
+        co_await client.async_disconnect();
+    }());
+
+    REQUIRE(started);
+    // the microphone audio arrives complete and in order, repacked into blocks.
+    REQUIRE(microphone.size() == kMicrophoneChunks * kMicrophoneChunkSize);
+    for (std::size_t i = 0; i < microphone.size(); i++)
+    {
+        REQUIRE(microphone[i] == voice_audio_byte(i));
+    }
+    CHECK(microphone_ended);
+    CHECK(oversized_refused);
+    REQUIRE(queued);
+
+    const auto received = device.received_voice_audio();
+    REQUIRE(received.size() == kResponseBlocks);
+    std::vector<std::byte> played;
+    for (std::size_t i = 0; i < received.size(); i++)
+    {
+        std::ranges::copy(received[i].data, std::back_inserter(played));
+        CHECK(received[i].end == (i + 1 == received.size()));
+        // block i is due one block duration after the previous one, it must not fall behind that schedule.
+        const auto due_at = queued_at + (static_cast<std::int64_t>(i) * kConfig.block_duration);
+        CHECK(received[i].received_at - due_at < kMaxLatency);
+    }
+    CHECK(played == response);
+    // paced with the playback rate instead of being written at once.
+    const auto paced_for = static_cast<std::int64_t>(kResponseBlocks - 2) * kConfig.block_duration;
+    CHECK(received.back().received_at - received.front().received_at >= paced_for);
+    CHECK(states > 0);
+}
+
+TEST_CASE("states are received on a warm connection without allocations", "[e2e][allocations]")
+{
+    constexpr std::size_t kWarmUpStates = 2000;
+    constexpr std::size_t kCountedStates = 2000;
+    // paced, so nearly every state finds a waiting receive. The stream outlasts the test, it ends with the connection.
+    const DeviceThread device{FakeDeviceConfig{
+        .lights = 4, .sensors = 4, .streamed_states = 1000000, .state_interval = std::chrono::microseconds{10}}};
+    Loopback loopback;
+    auto &client = loopback.add_client(device.port());
+    std::size_t received{};
+    std::size_t allocations{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            co_return;
+        }
+        // fills the message pool, the handler vectors and the recycled coroutine frames and handlers of the thread.
+        for (std::size_t i = 0; i < kWarmUpStates and (co_await client.async_receive_state()).has_value(); i++)
+        {
+        }
+        // the client runs on this thread alone, the device on its own.
+        const ThreadAllocationCounter counter;
+        while (received < kCountedStates and (co_await client.async_receive_state()).has_value())
+        {
+            received++;
+        }
+        allocations = counter.allocations();
+        co_await client.async_disconnect();
+    }());
+
+    CHECK(received == kCountedStates);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("commands are sent on a warm connection without allocations", "[e2e][allocations]")
+{
+    constexpr std::size_t kWarmUpCommands = 200;
+    constexpr std::size_t kCountedCommands = 1000;
+    const DeviceThread device{FakeDeviceConfig{.lights = 1, .sensors = 0}};
+    Loopback loopback;
+    auto &client = loopback.add_client(device.port());
+    std::size_t sent{};
+    std::size_t submitted{};
+    // the callbacks run on the connection strand, which is on this thread as well.
+    std::size_t completed{};
+    bool all_completed{false};
+    std::size_t allocations{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            co_return;
+        }
+        // the effect fits into the small string buffer, a longer one would be allocated by the caller.
+        const auto send_commands = [&](std::size_t count) -> asio::awaitable<void> {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if ((co_await client.async_light_command({.key = 0, .effect = "rainbow"})).has_value())
+                {
+                    sent++;
+                }
+                const auto count_completed = [&completed](Result<void> result) {
+                    completed += result.has_value() ? 1 : 0;
+                };
+                if (client.submit_command(LightCommand{.key = 0, .effect = "rainbow"}, count_completed))
+                {
+                    submitted++;
+                }
+            }
+        };
+        // fills the packet pool, the send lanes and the recycled coroutine frames and handlers of the thread.
+        co_await send_commands(kWarmUpCommands);
+        // the client runs on this thread alone, the device on its own.
+        const ThreadAllocationCounter counter;
+        co_await send_commands(kCountedCommands);
+        allocations = counter.allocations();
+        all_completed = co_await eventually([&] { return completed == submitted; });
+        co_await client.async_disconnect();
+    }());
+
+    CHECK(sent == kWarmUpCommands + kCountedCommands);
+    CHECK(submitted == kWarmUpCommands + kCountedCommands);
+    CHECK(all_completed);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("per message type latencies of a traced state stream", "[e2e][tracing]")
+{
+    constexpr std::size_t kStates = 5000;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(),
+                      FakeDeviceConfig{.lights = 4, .sensors = 0, .streamed_states = kStates}};
+    auto &client = loopback.add_client(device);
+    client.enable_message_tracing(TraceOptions{.sample_interval = 50});
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        const auto snapshot = co_await client.async_connect_pipelined();
+        if (not snapshot.has_value())
+        {
+            co_return;
+        }
+        auto delivered = snapshot->initial_states.size();
+        while (delivered < kStates and
+               (co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+        {
+            delivered++;
+        }
+        co_await client.async_disconnect();
+    }());
+
+    const auto latencies = client.message_latencies();
+
+    // the export must be valid JSON in the Chrome trace event format: one named row per message type and complete
+    // events for the stages of the sampled messages.
+    google::protobuf::Struct trace;
+    REQUIRE(google::protobuf::util::JsonStringToMessage(client.chrome_trace(), &trace).ok());
+    REQUIRE(trace.fields().count("traceEvents") == 1);
+    const auto field = [](const google::protobuf::Value &event,
+                          const std::string &name) -> const google::protobuf::Value & {
+        const auto &fields = event.struct_value().fields();
+        REQUIRE(fields.count(name) == 1);
+        return fields.at(name);
+    };
+    std::set<double> named_rows;
+    std::map<std::string, std::size_t> stages;
+    for (auto &&event : trace.fields().at("traceEvents").list_value().values())
+    {
+        const auto phase = field(event, "ph").string_value();
+        if (phase == "M")
+        {
+            CHECK(field(event, "name").string_value() == "thread_name");
+            named_rows.insert(field(event, "tid").number_value());
+            continue;
+        }
+        REQUIRE(phase == "X");
+        CHECK(named_rows.contains(field(event, "tid").number_value()));
+        CHECK(field(event, "ts").number_value() >= 0);
+        CHECK(field(event, "dur").number_value() >= 0);
+        CHECK(field(field(event, "args"), "id").number_value() > 0);
+        stages[field(event, "name").string_value()]++;
+    }
+    // every 50th received message is sampled, the states alone are 5000.
+    CHECK(stages["decode"] >= kStates / 50);
+    CHECK(stages["dispatch"] == stages["decode"]);
+    CHECK(stages["consume"] <= stages["decode"]);
+    CHECK(stages.size() <= 3);
+    CHECK_FALSE(latencies.empty());
+}
+
+TEST_CASE("states of entities outside of the interest set are dropped", "[e2e][interest]")
+{
+    constexpr std::size_t kStates = 2000;
+    constexpr std::uint32_t kInterestingKey = 2;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(),
+                      FakeDeviceConfig{.lights = 4, .sensors = 0, .streamed_states = kStates}};
+    auto &client = loopback.add_client(device);
+    client.set_entity_interest({kInterestingKey});
+    std::size_t interesting{};
+    std::size_t others{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        const auto snapshot = co_await client.async_connect_pipelined();
+        if (not snapshot.has_value())
+        {
+            co_return;
+        }
+        const auto count = [&](const EntityStateVariant &state) {
+            const auto key = std::visit([](auto &&entity_state) { return entity_state.key; }, state);
+            if (key == kInterestingKey)
+            {
+                interesting++;
+            }
+            // the encoder omits the default key 0, so those frames can not be filtered and are delivered.
+            else if (key != 0)
+            {
+                others++;
+            }
+        };
+        std::ranges::for_each(snapshot->initial_states, count);
+        while (true)
+        {
+            const auto state = co_await client.async_receive_state(Clock::now() + 500ms);
+            if (not state.has_value())
+            {
+                break;
+            }
+            count(state.value());
+        }
+        co_await client.async_disconnect();
+    }());
+
+    const auto metrics = client.metrics();
+    CHECK(interesting > 0);
+    CHECK(others == 0);
+    CHECK(metrics.filtered_messages == kStates / 2);
+}
+
+TEST_CASE("replay of a captured state stream", "[e2e][replay]")
+{
+    constexpr std::size_t kStates = 20000;
+    const auto capture_file = std::filesystem::temp_directory_path() / "cppesphomeapi_state_stream.capture";
+    std::uint64_t captured_frames{};
+    {
+        Loopback loopback;
+        FakeDevice device{
+            loopback.executor(),
+            FakeDeviceConfig{.lights = 4, .sensors = 0, .fragment_size = 7, .streamed_states = kStates}};
+        auto &client = loopback.add_client(device);
+        REQUIRE(client.start_capture(capture_file).has_value());
+        loopback.run([&]() -> asio::awaitable<void> {
+            if (not(co_await client.async_connect_pipelined()).has_value())
+            {
+                co_return;
+            }
+            // the stream is complete once the device is silent.
+            while ((co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+            {
+            }
+            client.stop_capture();
+            captured_frames = client.metrics().frames_received;
+            co_await client.async_disconnect();
+        }());
+    }
+    REQUIRE(captured_frames > 0);
+
+    Loopback loopback;
+    auto &client = loopback.add_client(0);
+    bool replayed{false};
+    std::size_t delivered{};
+    loopback.run([&]() -> asio::awaitable<void> {
+        const auto replay = [&]() -> asio::awaitable<void> {
+            replayed = (co_await client.async_replay(capture_file, ReplayPace::AsFastAsPossible)).has_value();
+        };
+        const auto receive = [&]() -> asio::awaitable<void> {
+            while ((co_await client.async_receive_state(Clock::now() + 200ms)).has_value())
+            {
+                delivered++;
+            }
+        };
+        co_await (replay() && receive());
+    }());
+    std::filesystem::remove(capture_file);
+
+    const auto metrics = client.metrics();
+    CHECK(replayed);
+    CHECK(delivered > 0);
+    CHECK(metrics.frames_received == captured_frames);
+    CHECK(metrics.decode_errors == 0);
+}
+
+TEST_CASE("many clients on a shared multi threaded io_context", "[e2e][scaling]")
+{
+    constexpr std::size_t kClients = 32;
+    constexpr std::size_t kStatesPerClient = 2000;
+    for (const std::size_t io_threads : {1U, 2U, 4U, 8U})
+    {
+        Loopback loopback{io_threads};
+        FakeDevice device{loopback.executor(),
+                          FakeDeviceConfig{.lights = 4, .sensors = 0, .streamed_states = kStatesPerClient}};
+        std::vector<ApiClient *> clients;
+        for (std::size_t i = 0; i < kClients; i++)
+        {
+            clients.emplace_back(&loopback.add_client(device));
+        }
+        std::vector<std::size_t> delivered(kClients);
+        std::vector<std::size_t> connected(kClients);
+
+        loopback.run([&]() -> asio::awaitable<void> {
+            co_await run_concurrently(kClients, [&](std::size_t index) -> asio::awaitable<void> {
+                auto &client = *clients[index];
+                const auto snapshot = co_await client.async_connect_pipelined(Clock::now() + 5s);
+                if (not snapshot.has_value())
+                {
+                    co_return;
+                }
+                connected[index] = 1;
+                delivered[index] = snapshot->initial_states.size();
+                while (delivered[index] < kStatesPerClient and
+                       (co_await client.async_receive_state(Clock::now() + 500ms)).has_value())
+                {
+                    delivered[index]++;
+                }
+                co_await client.async_disconnect();
+            });
+        }());
+
+        INFO(std::format("{} io threads", io_threads));
+        CHECK(std::accumulate(connected.cbegin(), connected.cend(), std::size_t{}) == kClients);
+    }
+}
+
+TEST_CASE("commands and receives from many threads on one client", "[e2e][stress]")
+{
+    constexpr std::size_t kThreads = 8;
+    constexpr std::size_t kCommandsPerThread = 200;
+    constexpr std::size_t kCommands = kThreads * kCommandsPerThread;
+    constexpr std::size_t kReceivers = 4;
+    // every thread sends a light command and submits one per round, the device echoes both as light states.
+    constexpr std::size_t kEchoes = 2 * kCommands;
+    Loopback loopback{kThreads};
+    FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 1, .sensors = 0}};
+    auto &client = loopback.add_client(device);
+    std::atomic<std::size_t> commands_sent{};
+    std::atomic<std::size_t> submissions_completed{};
+    std::atomic<std::size_t> receivers_running{kReceivers};
+    std::mutex received_mutex;
+    std::set<std::string> received_effects;
+    bool connected{false};
+    bool accounted{false};
+    std::uint64_t unclaimed{};
+
+    // the coroutines run on all io threads at once, so the results are only checked after the io_context stopped.
+    loopback.run([&]() -> asio::awaitable<void> {
+        connected = (co_await client.async_connect_pipelined()).has_value();
+        if (not connected)
+        {
+            co_return;
+        }
+        const auto receive = [&](std::size_t /*index*/) -> asio::awaitable<void> {
+            while (true)
+            {
+                const auto state = co_await client.async_receive_state();
+                const auto *light_state = state.has_value() ? std::get_if<LightState>(&state.value()) : nullptr;
+                if (not state.has_value() or (light_state != nullptr and light_state->effect == "done"))
+                {
+                    break;
+                }
+                if (light_state != nullptr)
+                {
+                    const std::scoped_lock lock{received_mutex};
+                    received_effects.insert(light_state->effect);
+                }
+            }
+            receivers_running--;
+        };
+        const auto command = [&](std::size_t thread) -> asio::awaitable<void> {
+            for (std::size_t i = 0; i < kCommandsPerThread; i++)
+            {
+                if ((co_await client.async_light_command({.key = 0, .effect = std::format("sent_{}_{}", thread, i)}))
+                        .has_value())
+                {
+                    commands_sent++;
+                }
+                const LightCommand submitted{.key = 0, .effect = std::format("submitted_{}_{}", thread, i)};
+                while (not client.submit_command(submitted, [&](Result<void> result) {
+                    if (result.has_value())
+                    {
+                        submissions_completed++;
+                    }
+                }))
+                {
+                    // the submission queue is full, retry once the writer took some.
+                    co_await asio::post(co_await asio::this_coro::executor, asio::use_awaitable);
+                }
+            }
+        };
+        const auto send = [&]() -> asio::awaitable<void> {
+            co_await run_concurrently(kThreads, command);
+            // every echo was received by at least one receiver or dropped because none was waiting.
+            accounted = co_await eventually([&] {
+                const std::scoped_lock lock{received_mutex};
+                return submissions_completed == kCommands and
+                       received_effects.size() + client.metrics().unclaimed_messages == kEchoes;
+            });
+            unclaimed = client.metrics().unclaimed_messages;
+            // a receiver that is between two receives misses an echo, so the last one is repeated until all ended.
+            while (receivers_running > 0)
+            {
+                co_await client.async_light_command({.key = 0, .effect = "done"});
+                co_await eventually([&] { return receivers_running == 0; }, 1ms);
+            }
+        };
+        co_await (run_concurrently(kReceivers, receive) && send());
+        co_await client.async_disconnect();
+    }());
+
+    REQUIRE(connected);
+    CHECK(commands_sent == kCommands);
+    CHECK(submissions_completed == kCommands);
+    CHECK(device.light_commands() >= 2 * kCommands);
+    CHECK(accounted);
+    CHECK_FALSE(received_effects.empty());
+    CHECK(received_effects.size() + unclaimed == kEchoes);
+}
+
+TEST_CASE("service calls are batched into one send and use legacy_int before api 1.3", "[e2e][services]")
+{
+    const auto schema = ServiceSchema::compile(UserService{
+        .name = "set_level",
+        .key = 7,
+        .args =
+            {
+                UserServiceArg{.name = "level", .type = ServiceArgType::Int},
+                UserServiceArg{.name = "label", .type = ServiceArgType::String},
+            },
+    });
+    const auto call_of = [&schema](std::int32_t level) {
+        return ServiceCall{.schema = schema, .args = {level, std::format("level {}", level)}};
+    };
+
+    for (const std::uint32_t api_version_minor : {2U, 10U})
+    {
+        INFO(std::format("api version 1.{}", api_version_minor));
+        Loopback loopback;
+        FakeDevice device{loopback.executor(),
+                          FakeDeviceConfig{.api_version_minor = api_version_minor, .lights = 1, .sensors = 0}};
+        auto &client = loopback.add_client(device);
+        bool batch_sent{false};
+        std::optional<ApiError> invalid_batch_error;
+        std::uint64_t control_packets{};
+
+        loopback.run([&]() -> asio::awaitable<void> {
+            if (not(co_await client.async_connect()).has_value())
+            {
+                co_return;
+            }
+            const auto before = client.send_metrics()[std::to_underlying(SendPriority::Control)].packets;
+            batch_sent = (co_await client.async_execute_services({call_of(-1), call_of(2), call_of(-3)})).has_value();
+            control_packets = client.send_metrics()[std::to_underlying(SendPriority::Control)].packets - before;
+
+            // a call with a wrong argument fails the whole batch, the valid call before it is not sent either.
+            auto invalid = call_of(4);
+            invalid.args[0] = std::string{"not an int"};
+            const auto invalid_batch = co_await client.async_execute_services({call_of(5), invalid});
+            if (not invalid_batch.has_value())
+            {
+                invalid_batch_error = invalid_batch.error();
+            }
+            // written after the failed batch, so the device saw everything sent before once it arrived.
+            co_await client.async_execute_service(call_of(6));
+            co_await eventually([&device]() { return device.executed_services().size() >= 4; });
+            co_await client.async_disconnect();
+        }());
+
+        CHECK(batch_sent);
+        CHECK(control_packets == 1);
+        REQUIRE(invalid_batch_error.has_value());
+        CHECK(invalid_batch_error->code == ApiErrorCode::InvalidArgument);
+
+        const auto executed = device.executed_services();
+        REQUIRE(executed.size() == 4);
+        const std::array<std::int32_t, 4> levels{-1, 2, -3, 6};
+        for (std::size_t i = 0; i < executed.size(); i++)
+        {
+            const auto &request = executed[i];
+            CHECK(request.key() == 7);
+            REQUIRE(request.args_size() == 2);
+            if (api_version_minor < 3)
+            {
+                CHECK(request.args(0).legacy_int() == levels[i]);
+                CHECK(request.args(0).int_() == 0);
+            }
+            else
+            {
+                CHECK(request.args(0).int_() == levels[i]);
+                CHECK(request.args(0).legacy_int() == 0);
+            }
+            CHECK(request.args(1).string_() == std::format("level {}", levels[i]));
+        }
+    }
+}
+
+TEST_CASE("a command submitted while the command writer goes idle is written", "[e2e][commands]")
+{
+    constexpr std::size_t kCommands = 2000;
+    Loopback loopback;
+    FakeDevice device{loopback.executor(), FakeDeviceConfig{.lights = 1, .sensors = 0}};
+    auto &client = loopback.add_client(device);
+    std::atomic<std::size_t> completed{};
+    std::atomic<std::size_t> submitted{};
+    std::atomic<std::size_t> lost{};
+    std::atomic<bool> submitter_done{false};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            co_return;
+        }
+        // every command is submitted by another thread right after the callback of the previous one, while the
+        // writer checks the queue a last time and goes idle. A lost wakeup leaves the command unwritten.
+        const std::jthread submitter{[&]() {
+            for (std::size_t i = 0; i < kCommands; i++)
+            {
+                if (not client.submit_command(LightCommand{.key = 0},
+                                              [&completed](Result<void> /*result*/) { completed++; }))
+                {
+                    break;
+                }
+                submitted++;
+                const auto give_up_at = std::chrono::steady_clock::now() + 1s;
+                while (completed <= i and std::chrono::steady_clock::now() < give_up_at)
+                {
+                    std::this_thread::yield();
+                }
+                if (completed <= i)
+                {
+                    lost++;
+                    break;
+                }
+            }
+            submitter_done = true;
+        }};
+        co_await eventually([&] { return submitter_done.load(); }, 60s);
+        co_await client.async_disconnect();
+    }());
+
+    CHECK(submitted == kCommands);
+    CHECK(lost == 0);
+    CHECK(completed == kCommands);
+    CHECK(device.light_commands() == kCommands);
+}
+
+TEST_CASE("a fleet bootstrap bounds the concurrent handshakes and paces the admissions", "[e2e][fleet]")
+{
+    constexpr std::size_t kDevices = 6;
+    const FleetOptions options{.max_concurrent = 2, .admission_interval = 10ms, .device_timeout = 5s};
+    Loopback loopback;
+    // every handshake takes longer than an admission interval, so the admissions are limited by the concurrency.
+    std::vector<std::unique_ptr<FakeDevice>> devices;
+    std::vector<FleetDevice> fleet_devices;
+    for (std::size_t i = 0; i < kDevices; i++)
+    {
+        devices.emplace_back(std::make_unique<FakeDevice>(
+            loopback.executor(), FakeDeviceConfig{.lights = 2, .sensors = 2, .latency = 30ms}));
+        fleet_devices.emplace_back(FleetDevice{.hostname = "127.0.0.1", .port = devices.back()->port()});
+    }
+    std::stop_source stop_source;
+    FleetManager fleet{loopback.executor(), stop_source, options};
+    FleetReport report;
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        report = co_await fleet.async_bootstrap(fleet_devices);
+        co_await fleet.async_close();
+    }());
+
+    REQUIRE(report.devices.size() == kDevices);
+    CHECK(report.ready_count == kDevices);
+    for (auto &&device : report.devices)
+    {
+        INFO("device " << device.index);
+        REQUIRE(device.admitted.has_value());
+        REQUIRE(device.ready.has_value());
+        CHECK_FALSE(device.error.has_value());
+        CHECK(device.snapshot.entities.size() == 4);
+        // the admission slots are fixed, a device is never admitted before its slot.
+        CHECK(*device.admitted >= options.admission_interval * static_cast<std::int64_t>(device.index));
+        CHECK(*device.ready > *device.admitted);
+        CHECK(*device.ready <= report.time_to_all_ready);
+    }
+    CHECK(std::ranges::is_sorted(report.devices, {}, [](auto &&device) { return *device.admitted; }));
+
+    // the handshakes in flight when a device is admitted, including its own.
+    std::size_t max_in_flight{};
+    for (auto &&device : report.devices)
+    {
+        const auto admitted_at = *device.admitted;
+        const auto in_flight = std::ranges::count_if(report.devices, [admitted_at](auto &&other) {
+            return *other.admitted <= admitted_at and *other.ready > admitted_at;
+        });
+        max_in_flight = std::max(max_in_flight, static_cast<std::size_t>(in_flight));
+    }
+    CHECK(max_in_flight == options.max_concurrent);
+}
+
+TEST_CASE("receives abandoned by their deadline leave no pending handlers", "[e2e][deadline]")
+{
+    constexpr std::size_t kRounds = 100;
+    constexpr std::size_t kConcurrentReceives = 32;
+    Loopback loopback{4};
+    FakeDevice device{loopback.executor(), FakeDeviceConfig{}};
+    auto &client = loopback.add_client(device);
+    std::size_t expired{};
+    std::size_t pending_after_expiry{};
+
+    loopback.run([&]() -> asio::awaitable<void> {
+        if (not(co_await client.async_connect_pipelined()).has_value())
+        {
+            co_return;
+        }
+        std::atomic<std::size_t> expired_receives{};
+        for (std::size_t i = 0; i < kRounds; i++)
+        {
+            const auto deadline = Clock::now() + 1ms;
+            co_await run_concurrently(kConcurrentReceives, [&](std::size_t /*index*/) -> asio::awaitable<void> {
+                const auto state = co_await client.async_receive_state(deadline);
+                if (not state.has_value() and state.error().code == ApiErrorCode::DeadlineExceeded)
+                {
+                    expired_receives++;
+                }
+            });
+        }
+        expired = expired_receives.load();
+        pending_after_expiry = client.pending_receive_handlers();
+        co_await client.async_disconnect();
+    }());
+
+    CHECK(expired == kRounds * kConcurrentReceives);
+    CHECK(pending_after_expiry == 0);
+}
@@ -0,0 +1,531 @@
+#include "fake_device.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include "payloads.hpp"
+#include "plain_text_protocol.hpp"
+
+namespace asio = boost::asio;
+
+namespace cppesphomeapi::testing
+{
+namespace
+{
+constexpr std::size_t kMaxQueuedPackets = 1024;
+
+struct Packet
+{
+    Clock::time_point due;
+    std::vector<std::byte> bytes;
+};
+} // namespace
+
+struct FakeDevice::State
+{
+    State(const asio::any_io_executor &executor, FakeDeviceConfig device_config)
+        : executor{executor}
+        , acceptor{asio::make_strand(executor), net::Endpoint{asio::ip::address_v4::loopback(), 0}}
+        , config{std::move(device_config)}
+    {}
+
+    asio::any_io_executor executor;
+    net::Acceptor acceptor;
+    const FakeDeviceConfig config;
+    std::atomic<std::size_t> light_commands{};
+    std::atomic<std::size_t> pings{};
+    std::atomic<std::size_t> open_connections{};
+    std::atomic<bool> responsive{true};
+    mutable std::mutex executed_services_mutex;
+    std::vector<proto::ExecuteServiceRequest> executed_services;
+    mutable std::mutex voice_audio_mutex;
+    std::vector<ReceivedVoiceAudio> voice_audio;
+    std::mutex sessions_mutex;
+    std::vector<std::weak_ptr<Session>> sessions;
+};
+
+class FakeDevice::Session : public std::enable_shared_from_this<Session>
+{
+  public:
+    explicit Session(std::shared_ptr<State> state)
+        : state_{std::move(state)}
+        , config_{state_->config}
+        , strand_{asio::make_strand(state_->executor)}
+        , socket_{strand_}
+        , wake_timer_{strand_}
+        , drained_timer_{strand_}
+    {}
+
+    net::Socket &socket()
+    {
+        return socket_;
+    }
+
+    void start()
+    {
+        state_->open_connections.fetch_add(1, std::memory_order_relaxed);
+        asio::co_spawn(strand_, reader_loop(shared_from_this()), asio::detached);
+        asio::co_spawn(strand_, writer_loop(shared_from_this()), asio::detached);
+    }
+
+    void stop()
+    {
+        asio::post(strand_, [self = shared_from_this()]() { self->close(); });
+    }
+
+  private:
+    void close()
+    {
+        if (not std::exchange(closed_, true))
+        {
+            state_->open_connections.fetch_sub(1, std::memory_order_relaxed);
+        }
+        net::close(socket_);
+        wake_timer_.cancel();
+        drained_timer_.cancel();
+    }
+
+    void enqueue(const google::protobuf::Message &message)
+    {
+        queue_.emplace_back(Packet{
+            .due = Clock::now() + config_.latency,
+            .bytes = frame_of(message),
+        });
+        wake_timer_.cancel();
+    }
+
+    // keeps the streams from queueing more packets than the socket can take.
+    asio::awaitable<bool> wait_until_drained()
+    {
+        while (not closed_ and queue_.size() >= kMaxQueuedPackets)
+        {
+            drained_timer_.expires_at(Clock::time_point::max());
+            co_await drained_timer_.async_wait();
+        }
+        co_return not closed_;
+    }
+
+    asio::awaitable<void> reader_loop(std::shared_ptr<Session> /*self*/)
+    {
+        std::vector<std::byte> buffer(4096);
+        std::size_t buffered{};
+        while (not closed_)
+        {
+            const auto [error, received_bytes] =
+                co_await socket_.async_read_some(asio::buffer(std::span{buffer}.subspan(buffered)));
+            if (error)
+            {
+                break;
+            }
+            buffered += received_bytes;
+
+            auto pending = std::span<const std::byte>{buffer}.first(buffered);
+            while (not pending.empty())
+            {
+                const auto header = PlainTextProtocol::read_frame_header(pending);
+                if (not header.has_value())
+                {
+                    close();
+                    co_return;
+                }
+                if (not header->has_value() or pending.size() < header->value().frame_size())
+                {
+                    break;
+                }
+                const auto &frame_header = header->value();
+                const auto decoded = PlainTextProtocol::decode<proto::HelloRequest,
+                                                               proto::ConnectRequest,
+                                                               proto::DeviceInfoRequest,
+                                                               proto::ListEntitiesRequest,
+                                                               proto::SubscribeStatesRequest,
+                                                               proto::SubscribeLogsRequest,
+                                                               proto::PingRequest,
+                                                               proto::DisconnectRequest,
+                                                               proto::LightCommandRequest,
+                                                               proto::CameraImageRequest,
+                                                               proto::ExecuteServiceRequest,
+                                                               proto::SubscribeVoiceAssistantRequest,
+                                                               proto::VoiceAssistantResponse,
+                                                               proto::VoiceAssistantAudio>(
+                    Frame{
+                        .message_type = frame_header.message_type,
+                        .payload = pending.subspan(frame_header.header_size, frame_header.payload_size),
+                    },
+                    [this](MessageWrapper message) { handle_request(message); });
+                if (not decoded.has_value())
+                {
+                    close();
+                    co_return;
+                }
+                pending = pending.subspan(frame_header.frame_size());
+            }
+            std::ranges::copy(pending, buffer.begin());
+            buffered = pending.size();
+            if (buffered == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+        }
+        close();
+    }
+
+    asio::awaitable<void> writer_loop(std::shared_ptr<Session> /*self*/)
+    {
+        net::Timer latency_timer{strand_};
+        while (not closed_)
+        {
+            if (queue_.empty())
+            {
+                if (disconnecting_)
+                {
+                    break;
+                }
+                wake_timer_.expires_at(Clock::time_point::max());
+                co_await wake_timer_.async_wait();
+                continue;
+            }
+            auto packet = std::move(queue_.front());
+            queue_.pop_front();
+            drained_timer_.cancel();
+
+            if (packet.due > Clock::now())
+            {
+                latency_timer.expires_at(packet.due);
+                co_await latency_timer.async_wait();
+            }
+            const auto fragment_size = config_.fragment_size == 0 ? packet.bytes.size() : config_.fragment_size;
+            for (std::size_t offset = 0; offset < packet.bytes.size() and not closed_; offset += fragment_size)
+            {
+                const auto size = std::min(fragment_size, packet.bytes.size() - offset);
+                const auto [error, written] =
+                    co_await asio::async_write(socket_, asio::buffer(packet.bytes.data() + offset, size));
+                if (error)
+                {
+                    close();
+                    co_return;
+                }
+            }
+        }
+        close();
+    }
+
+    void handle_request(const MessageWrapper &message)
+    {
+        if (message.holds_message<proto::PingRequest>())
+        {
+            state_->pings.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (not state_->responsive.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (message.holds_message<proto::HelloRequest>())
+        {
+            proto::HelloResponse response;
+            response.set_api_version_major(config_.api_version_major);
+            response.set_api_version_minor(config_.api_version_minor);
+            response.set_server_info("cppesphomeapi fake device");
+            response.set_name(config_.name);
+            enqueue(response);
+        }
+        else if (const auto *connect = message.get_if<proto::ConnectRequest>(); connect != nullptr)
+        {
+            proto::ConnectResponse response;
+            response.set_invalid_password(connect->password() != config_.password);
+            enqueue(response);
+        }
+        else if (message.holds_message<proto::DeviceInfoRequest>())
+        {
+            proto::DeviceInfoResponse response;
+            response.set_name(config_.name);
+            response.set_mac_address("00:00:5E:00:53:00");
+            response.set_esphome_version("2024.6.0");
+            response.set_compilation_time("Jun 12 2024, 20:15:00");
+            response.set_model("fake");
+            enqueue(response);
+        }
+        else if (message.holds_message<proto::ListEntitiesRequest>())
+        {
+            list_entities();
+        }
+        else if (message.holds_message<proto::SubscribeStatesRequest>())
+        {
+            asio::co_spawn(strand_, stream_states(shared_from_this()), asio::detached);
+        }
+        else if (message.holds_message<proto::SubscribeLogsRequest>())
+        {
+            asio::co_spawn(strand_, stream_logs(shared_from_this()), asio::detached);
+        }
+        else if (message.holds_message<proto::PingRequest>())
+        {
+            enqueue(proto::PingResponse{});
+        }
+        else if (message.holds_message<proto::DisconnectRequest>())
+        {
+            enqueue(proto::DisconnectResponse{});
+            disconnecting_ = true;
+        }
+        else if (const auto *light_command = message.get_if<proto::LightCommandRequest>(); light_command != nullptr)
+        {
+            state_->light_commands.fetch_add(1, std::memory_order_relaxed);
+            auto light_state = make_light_state();
+            light_state.set_key(light_command->key());
+            light_state.set_effect(light_command->has_effect() ? light_command->effect() : "None");
+            enqueue(light_state);
+        }
+        else if (message.holds_message<proto::CameraImageRequest>())
+        {
+            asio::co_spawn(strand_, stream_camera_image(shared_from_this()), asio::detached);
+        }
+        else if (const auto *execute = message.get_if<proto::ExecuteServiceRequest>(); execute != nullptr)
+        {
+            const std::scoped_lock lock{state_->executed_services_mutex};
+            state_->executed_services.emplace_back(*execute);
+        }
+        else if (const auto *subscribe = message.get_if<proto::SubscribeVoiceAssistantRequest>();
+                 subscribe != nullptr and subscribe->subscribe())
+        {
+            // starts a run right away, as if the wake word was detected.
+            proto::VoiceAssistantRequest request;
+            request.set_start(true);
+            request.set_conversation_id("fake-conversation");
+            enqueue(request);
+        }
+        else if (const auto *response = message.get_if<proto::VoiceAssistantResponse>();
+                 response != nullptr and not response->error())
+        {
+            asio::co_spawn(strand_, stream_voice_audio(shared_from_this()), asio::detached);
+        }
+        else if (const auto *audio = message.get_if<proto::VoiceAssistantAudio>(); audio != nullptr)
+        {
+            const auto data = std::as_bytes(std::span{audio->data()});
+            const std::scoped_lock lock{state_->voice_audio_mutex};
+            state_->voice_audio.emplace_back(ReceivedVoiceAudio{
+                .received_at = Clock::now(),
+                .data = {data.begin(), data.end()},
+                .end = audio->end(),
+            });
+        }
+    }
+
+    // the same keys as entity_list_frames(), so the streamed states belong to listed entities.
+    void list_entities()
+    {
+        auto light = make_light_entity();
+        for (std::size_t i = 0; i < config_.lights; i++)
+        {
+            light.set_key(static_cast<std::uint32_t>(i));
+            enqueue(light);
+        }
+        auto sensor = make_sensor_entity();
+        for (std::size_t i = 0; i < config_.sensors; i++)
+        {
+            sensor.set_key(static_cast<std::uint32_t>(config_.lights + i));
+            enqueue(sensor);
+        }
+        enqueue(proto::ListEntitiesDoneResponse{});
+    }
+
+    asio::awaitable<void> stream_states(std::shared_ptr<Session> /*self*/)
+    {
+        net::Timer interval_timer{strand_};
+        auto light_state = make_light_state();
+        auto sensor_state = make_sensor_state();
+        for (std::size_t i = 0; i < config_.streamed_states; i++)
+        {
+            if (not co_await wait_until_drained())
+            {
+                co_return;
+            }
+            if (i % 2 == 0 or config_.sensors == 0)
+            {
+                light_state.set_key(static_cast<std::uint32_t>(i % std::max<std::size_t>(config_.lights, 1)));
+                enqueue(light_state);
+            }
+            else
+            {
+                sensor_state.set_key(static_cast<std::uint32_t>(config_.lights + (i % config_.sensors)));
+                sensor_state.set_state(static_cast<float>(i));
+                enqueue(sensor_state);
+            }
+            if (config_.state_interval.count() > 0)
+            {
+                interval_timer.expires_after(config_.state_interval);
+                co_await interval_timer.async_wait();
+            }
+        }
+    }
+
+    asio::awaitable<void> stream_logs(std::shared_ptr<Session> /*self*/)
+    {
+        net::Timer interval_timer{strand_};
+        const auto log = make_log();
+        for (std::size_t i = 0; i < config_.streamed_logs; i++)
+        {
+            if (not co_await wait_until_drained())
+            {
+                co_return;
+            }
+            enqueue(log);
+            if (config_.log_interval.count() > 0)
+            {
+                interval_timer.expires_after(config_.log_interval);
+                co_await interval_timer.async_wait();
+            }
+        }
+    }
+
+    asio::awaitable<void> stream_camera_image(std::shared_ptr<Session> /*self*/)
+    {
+        const std::string image(config_.camera_image_size, '\xAB');
+        const auto chunk_size = std::max<std::size_t>(config_.camera_chunk_size, 1);
+        proto::CameraImageResponse response;
+        for (std::size_t offset = 0; offset < image.size(); offset += chunk_size)
+        {
+            if (not co_await wait_until_drained())
+            {
+                co_return;
+            }
+            const auto size = std::min(chunk_size, image.size() - offset);
+            response.set_data(image.substr(offset, size));
+            response.set_done(offset + size == image.size());
+            enqueue(response);
+        }
+    }
+
+    asio::awaitable<void> stream_voice_audio(std::shared_ptr<Session> /*self*/)
+    {
+        net::Timer interval_timer{strand_};
+        proto::VoiceAssistantAudio audio;
+        std::size_t offset{};
+        for (std::size_t i = 0; i < config_.voice_audio_chunks; i++)
+        {
+            if (not co_await wait_until_drained())
+            {
+                co_return;
+            }
+            auto &data = *audio.mutable_data();
+            data.resize(config_.voice_audio_chunk_size);
+            for (auto &byte : data)
+            {
+                byte = static_cast<char>(voice_audio_byte(offset++));
+            }
+            audio.set_end(i + 1 == config_.voice_audio_chunks);
+            enqueue(audio);
+            if (config_.voice_audio_interval.count() > 0)
+            {
+                interval_timer.expires_after(config_.voice_audio_interval);
+                co_await interval_timer.async_wait();
+            }
+        }
+    }
+
+  private:
+    std::shared_ptr<State> state_;
+    const FakeDeviceConfig &config_;
+    asio::strand<asio::any_io_executor> strand_;
+    net::Socket socket_;
+    // wakes the writer after a packet was queued.
+    net::Timer wake_timer_;
+    // wakes the streams after the writer took a packet.
+    net::Timer drained_timer_;
+    std::deque<Packet> queue_;
+    bool disconnecting_{false};
+    bool closed_{false};
+};
+
+FakeDevice::FakeDevice(const asio::any_io_executor &executor, FakeDeviceConfig config)
+    : state_{std::make_shared<State>(executor, std::move(config))}
+{
+    asio::co_spawn(state_->acceptor.get_executor(), accept_loop(state_), asio::detached);
+}
+
+FakeDevice::~FakeDevice()
+{
+    stop();
+}
+
+std::uint16_t FakeDevice::port() const
+{
+    return state_->acceptor.local_endpoint().port();
+}
+
+std::size_t FakeDevice::light_commands() const
+{
+    return state_->light_commands.load(std::memory_order_relaxed);
+}
+
+std::size_t FakeDevice::pings() const
+{
+    return state_->pings.load(std::memory_order_relaxed);
+}
+
+std::size_t FakeDevice::open_connections() const
+{
+    return state_->open_connections.load(std::memory_order_relaxed);
+}
+
+std::vector<proto::ExecuteServiceRequest> FakeDevice::executed_services() const
+{
+    const std::scoped_lock lock{state_->executed_services_mutex};
+    return state_->executed_services;
+}
+
+std::vector<ReceivedVoiceAudio> FakeDevice::received_voice_audio() const
+{
+    const std::scoped_lock lock{state_->voice_audio_mutex};
+    return state_->voice_audio;
+}
+
+void FakeDevice::set_responsive(bool responsive)
+{
+    state_->responsive.store(responsive, std::memory_order_relaxed);
+}
+
+void FakeDevice::stop()
+{
+    asio::post(state_->acceptor.get_executor(), [state = state_]() {
+        net::ErrorCode error;
+        state->acceptor.close(error);
+    });
+    const std::scoped_lock lock{state_->sessions_mutex};
+    for (auto &&weak_session : state_->sessions)
+    {
+        if (auto session = weak_session.lock(); session != nullptr)
+        {
+            session->stop();
+        }
+    }
+    state_->sessions.clear();
+}
+
+asio::awaitable<void> FakeDevice::accept_loop(std::shared_ptr<State> state)
+{
+    while (state->acceptor.is_open())
+    {
+        // the session socket is bound to its strand before accepting.
+        auto session = std::make_shared<Session>(state);
+        auto [error] = co_await state->acceptor.async_accept(session->socket());
+        if (error)
+        {
+            break;
+        }
+        session->socket().set_option(asio::ip::tcp::no_delay{true}, error);
+        {
+            const std::scoped_lock lock{state->sessions_mutex};
+            std::erase_if(state->sessions, [](auto &&weak_session) { return weak_session.expired(); });
+            state->sessions.emplace_back(session);
+        }
+        session->start();
+    }
+}
+} // namespace cppesphomeapi::testing
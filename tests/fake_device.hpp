@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include "api.pb.h"
+#include "net.hpp"
+
+namespace cppesphomeapi::testing
+{
+struct FakeDeviceConfig
+{
+    std::string name{"fake-device"};
+    std::uint32_t api_version_major{1};
+    std::uint32_t api_version_minor{10};
+    std::string password;
+
+    // served on ListEntitiesRequest.
+    std::size_t lights{4};
+    std::size_t sensors{8};
+
+    // one way delay added to every packet sent by the device.
+    std::chrono::microseconds latency{0};
+    // packets are written in chunks of this size, 0 writes them at once.
+    std::size_t fragment_size{0};
+
+    // streamed after SubscribeStatesRequest, alternating light and sensor states.
+    std::size_t streamed_states{0};
+    std::chrono::microseconds state_interval{0};
+    // streamed after SubscribeLogsRequest.
+    std::size_t streamed_logs{0};
+    std::chrono::microseconds log_interval{0};
+    // answered on CameraImageRequest.
+    std::size_t camera_image_size{64 * 1024};
+    std::size_t camera_chunk_size{1024};
+    // streamed as microphone audio once the client answered the VoiceAssistantRequest the device sends on
+    // SubscribeVoiceAssistantRequest. The last chunk ends the stream.
+    std::size_t voice_audio_chunks{0};
+    std::size_t voice_audio_chunk_size{512};
+    std::chrono::microseconds voice_audio_interval{0};
+};
+
+// the byte at the index of the microphone stream, so a client can check the order of the audio.
+constexpr std::byte voice_audio_byte(std::size_t index)
+{
+    return static_cast<std::byte>(index % 251);
+}
+
+// a VoiceAssistantAudio sent by the client.
+struct ReceivedVoiceAudio
+{
+    Clock::time_point received_at;
+    std::vector<std::byte> data;
+    bool end{};
+};
+
+/**
+ * An in process ESPHome device on a loopback port. It answers the handshake, serves the configured entities, echoes
+ * light commands as light states, records service calls and streams states, logs, camera images and voice assistant
+ * audio.
+ * Every connection runs on its own strand, all packets of a connection are written in order.
+ */
+class FakeDevice
+{
+  public:
+    FakeDevice(const boost::asio::any_io_executor &executor, FakeDeviceConfig config);
+    ~FakeDevice();
+
+    [[nodiscard]] std::uint16_t port() const;
+    // number of light commands received by all connections.
+    [[nodiscard]] std::size_t light_commands() const;
+    // ping requests received by all connections, answered or not.
+    [[nodiscard]] std::size_t pings() const;
+    [[nodiscard]] std::size_t open_connections() const;
+    // the ExecuteServiceRequests of all connections in the order they were received.
+    [[nodiscard]] std::vector<proto::ExecuteServiceRequest> executed_services() const;
+    // the response audio of all connections in the order it was received.
+    [[nodiscard]] std::vector<ReceivedVoiceAudio> received_voice_audio() const;
+    // an unresponsive device keeps its connections open but ignores every request, like a hung device.
+    void set_responsive(bool responsive);
+    void stop();
+
+    FakeDevice(const FakeDevice &) = delete;
+    FakeDevice &operator=(const FakeDevice &) = delete;
+
+  private:
+    struct State;
+    class Session;
+
+    static boost::asio::awaitable<void> accept_loop(std::shared_ptr<State> state);
+
+  private:
+    std::shared_ptr<State> state_;
+};
+} // namespace cppesphomeapi::testing
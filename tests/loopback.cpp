@@ -0,0 +1,94 @@
+#include "loopback.hpp"
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <variant>
+#include <boost/asio/co_spawn.hpp>
+
+namespace asio = boost::asio;
+
+namespace cppesphomeapi::testing
+{
+Loopback::Loopback(std::size_t io_threads)
+    : io_threads_{std::max<std::size_t>(io_threads, 1)}
+    , io_context_{static_cast<int>(io_threads_)}
+{}
+
+Loopback::~Loopback()
+{
+    // a connected client must be closed before it is destroyed. A failed close must not end the test run, the clients
+    // are destroyed after the io_context stopped either way.
+    asio::co_spawn(
+        io_context_,
+        [this]() -> asio::awaitable<void> {
+            for (auto &&client : clients_)
+            {
+                co_await client->async_close();
+            }
+        },
+        [this](std::exception_ptr /*failure*/) { io_context_.stop(); });
+    run_io_threads();
+    clients_.clear();
+}
+
+asio::any_io_executor Loopback::executor()
+{
+    return io_context_.get_executor();
+}
+
+ApiClient &Loopback::add_client(std::uint16_t port, std::string password)
+{
+    return *clients_.emplace_back(
+        std::make_unique<ApiClient>(executor(), stop_source_, "127.0.0.1", port, std::move(password)));
+}
+
+ApiClient &Loopback::add_client(const FakeDevice &device, std::string password)
+{
+    return add_client(device.port(), std::move(password));
+}
+
+void Loopback::run(asio::awaitable<void> operation)
+{
+    std::exception_ptr failure;
+    asio::co_spawn(io_context_, std::move(operation), [this, &failure](std::exception_ptr exception) {
+        failure = exception;
+        io_context_.stop();
+    });
+    run_io_threads();
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+void Loopback::run_io_threads()
+{
+    if (io_context_.stopped())
+    {
+        io_context_.restart();
+    }
+    std::vector<std::jthread> io_threads;
+    for (std::size_t i = 1; i < io_threads_; i++)
+    {
+        io_threads.emplace_back([this]() { io_context_.run(); });
+    }
+    io_context_.run();
+}
+
+asio::awaitable<bool> receive_light_state(ApiClient &client, std::string effect, Deadline deadline)
+{
+    while (true)
+    {
+        const auto state = co_await client.async_receive_state(deadline);
+        if (not state.has_value())
+        {
+            co_return false;
+        }
+        if (const auto *light_state = std::get_if<LightState>(&state.value());
+            light_state != nullptr and light_state->effect == effect)
+        {
+            co_return true;
+        }
+    }
+}
+} // namespace cppesphomeapi::testing
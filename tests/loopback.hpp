@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <vector>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/deferred.hpp>
+#include <boost/asio/experimental/parallel_group.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <cppesphomeapi/api_client.hpp>
+#include <cppesphomeapi/deadline.hpp>
+#include "fake_device.hpp"
+
+namespace cppesphomeapi::testing
+{
+/**
+ * An io_context with clients for FakeDevice instances of the same test, run on one or more threads under real time.
+ * The destructor closes the clients with async_close and destroys them after the io_context stopped but before it is
+ * destroyed, so no connection loop is resumed on a destroyed connection.
+ */
+class Loopback
+{
+  public:
+    explicit Loopback(std::size_t io_threads = 1);
+    ~Loopback();
+
+    [[nodiscard]] boost::asio::any_io_executor executor();
+    ApiClient &add_client(std::uint16_t port, std::string password = "");
+    ApiClient &add_client(const FakeDevice &device, std::string password = "");
+
+    // runs the coroutine on all io threads until it completed. An exception of the coroutine is rethrown. May be
+    // called again, the clients and devices keep their state between the runs.
+    void run(boost::asio::awaitable<void> operation);
+
+    Loopback(const Loopback &) = delete;
+    Loopback &operator=(const Loopback &) = delete;
+
+  private:
+    // runs the io_context on all io threads until it is stopped.
+    void run_io_threads();
+
+  private:
+    std::size_t io_threads_;
+    std::stop_source stop_source_;
+    boost::asio::io_context io_context_;
+    std::vector<std::unique_ptr<ApiClient>> clients_;
+};
+
+// completes once the light state with the effect was received.
+boost::asio::awaitable<bool> receive_light_state(ApiClient &client, std::string effect, Deadline deadline);
+
+// runs operation(0) to operation(count - 1) concurrently and completes once all of them completed.
+template <typename TOperation>
+boost::asio::awaitable<void> run_concurrently(std::size_t count, TOperation &&operation)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    using Operation = decltype(boost::asio::co_spawn(executor, operation(std::size_t{}), boost::asio::deferred));
+    std::vector<Operation> operations;
+    operations.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        operations.emplace_back(boost::asio::co_spawn(executor, operation(i), boost::asio::deferred));
+    }
+    co_await boost::asio::experimental::make_parallel_group(std::move(operations))
+        .async_wait(boost::asio::experimental::wait_for_all(), boost::asio::use_awaitable);
+}
+} // namespace cppesphomeapi::testing
@@ -0,0 +1,67 @@
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <catch2/catch_test_macros.hpp>
+#include <google/protobuf/descriptor.h>
+#include "api_options.pb.h"
+#include "message_traits.hpp"
+
+using namespace cppesphomeapi;
+
+namespace
+{
+detail::MessageSource source_of(proto::APISourceType source)
+{
+    switch (source)
+    {
+    case proto::SOURCE_SERVER:
+        return detail::MessageSource::Server;
+    case proto::SOURCE_CLIENT:
+        return detail::MessageSource::Client;
+    default:
+        return detail::MessageSource::Both;
+    }
+}
+
+// the device sends the entity key as fixed32 field 1.
+bool has_entity_key(const google::protobuf::Descriptor &descriptor)
+{
+    const auto *field = descriptor.FindFieldByNumber(1);
+    return field != nullptr and field->name() == "key" and
+           field->type() == google::protobuf::FieldDescriptor::TYPE_FIXED32;
+}
+
+template <typename TMsg>
+void check_traits()
+{
+    using Traits = detail::MessageTraits<TMsg>;
+    const auto &descriptor = *TMsg::GetDescriptor();
+    const auto &options = descriptor.options();
+    INFO(descriptor.name());
+    CHECK(Traits::id == options.GetExtension(proto::id));
+    CHECK(Traits::source == source_of(options.GetExtension(proto::source)));
+    CHECK(Traits::no_delay == options.GetExtension(proto::no_delay));
+    CHECK(Traits::ifdef == options.GetExtension(proto::ifdef));
+    CHECK(Traits::has_entity_key == has_entity_key(descriptor));
+}
+} // namespace
+
+TEST_CASE("the generated message traits match the options of api.proto", "[protocol]")
+{
+    using Messages = detail::MessagesWithTraits;
+    [&]<std::size_t... Index>(std::index_sequence<Index...>) {
+        (check_traits<std::tuple_element_t<Index, Messages>>(), ...);
+    }(std::make_index_sequence<std::tuple_size_v<Messages>>{});
+
+    // no message with an id is missing from the generated list.
+    const auto &file = *proto::HelloRequest::GetDescriptor()->file();
+    std::size_t messages_with_id{};
+    for (int index = 0; index < file.message_type_count(); index++)
+    {
+        if (file.message_type(index)->options().GetExtension(proto::id) != 0)
+        {
+            messages_with_id++;
+        }
+    }
+    CHECK(messages_with_id == std::tuple_size_v<Messages>);
+}
@@ -0,0 +1,129 @@
+#include "payloads.hpp"
+#include <format>
+#include "plain_text_protocol.hpp"
+
+namespace cppesphomeapi::testing
+{
+proto::LightStateResponse make_light_state()
+{
+    proto::LightStateResponse light_state;
+    light_state.set_key(1111582032);
+    light_state.set_state(true);
+    light_state.set_brightness(0.8F);
+    light_state.set_color_mode(proto::ColorMode::COLOR_MODE_RGB);
+    light_state.set_color_brightness(1.0F);
+    light_state.set_red(1.0F);
+    light_state.set_green(0.5F);
+    light_state.set_blue(0.25F);
+    light_state.set_effect("Rainbow");
+    return light_state;
+}
+
+proto::SensorStateResponse make_sensor_state()
+{
+    proto::SensorStateResponse sensor_state;
+    sensor_state.set_key(3280215032);
+    sensor_state.set_state(21.5F);
+    return sensor_state;
+}
+
+proto::ListEntitiesLightResponse make_light_entity()
+{
+    proto::ListEntitiesLightResponse light;
+    light.set_object_id("living_room_ceiling");
+    light.set_key(1111582032);
+    light.set_name("Living Room Ceiling");
+    light.set_unique_id("livingroomlightlight_living_room_ceiling");
+    light.add_supported_color_modes(proto::ColorMode::COLOR_MODE_RGB);
+    light.add_supported_color_modes(proto::ColorMode::COLOR_MODE_COLOR_TEMPERATURE);
+    light.set_min_mireds(153.0F);
+    light.set_max_mireds(500.0F);
+    for (const auto *effect : {"None", "Rainbow", "Pulsate", "Strobe", "Flicker", "Random"})
+    {
+        light.add_effects(effect);
+    }
+    light.set_icon("mdi:ceiling-light");
+    return light;
+}
+
+proto::ListEntitiesSensorResponse make_sensor_entity()
+{
+    proto::ListEntitiesSensorResponse sensor;
+    sensor.set_object_id("living_room_temperature");
+    sensor.set_key(3280215032);
+    sensor.set_name("Living Room Temperature");
+    sensor.set_unique_id("livingroomsensorsensor_living_room_temperature");
+    sensor.set_icon("mdi:thermometer");
+    sensor.set_unit_of_measurement("°C");
+    sensor.set_accuracy_decimals(2);
+    sensor.set_device_class("temperature");
+    sensor.set_state_class(proto::SensorStateClass::STATE_CLASS_MEASUREMENT);
+    return sensor;
+}
+
+proto::SubscribeLogsResponse make_log()
+{
+    proto::SubscribeLogsResponse log;
+    log.set_level(proto::LogLevel::LOG_LEVEL_DEBUG);
+    log.set_message("[D][sensor:094]: 'Living Room Temperature': Sending state 21.50000 °C with 2 decimals of accuracy");
+    return log;
+}
+
+std::vector<std::byte> frame_of(const google::protobuf::Message &message)
+{
+    return PlainTextProtocol::serialize(message).value();
+}
+
+std::vector<std::byte> payload_of(const google::protobuf::Message &message)
+{
+    std::vector<std::byte> payload(message.ByteSizeLong());
+    message.SerializeToArray(payload.data(), static_cast<int>(payload.size()));
+    return payload;
+}
+
+Frame single_frame(std::span<const std::byte> frame_bytes)
+{
+    const auto header = PlainTextProtocol::read_frame_header(frame_bytes).value().value();
+    return Frame{
+        .message_type = header.message_type,
+        .payload = frame_bytes.subspan(header.header_size, header.payload_size),
+    };
+}
+
+std::vector<std::byte> entity_list_frames(std::size_t lights, std::size_t sensors)
+{
+    std::vector<std::byte> frames;
+    auto light = make_light_entity();
+    for (std::size_t i = 0; i < lights; i++)
+    {
+        light.set_key(static_cast<std::uint32_t>(i));
+        light.set_object_id(std::format("light_{}", i));
+        const auto frame = frame_of(light);
+        frames.insert(frames.end(), frame.cbegin(), frame.cend());
+    }
+    auto sensor = make_sensor_entity();
+    for (std::size_t i = 0; i < sensors; i++)
+    {
+        sensor.set_key(static_cast<std::uint32_t>(lights + i));
+        sensor.set_object_id(std::format("sensor_{}", i));
+        const auto frame = frame_of(sensor);
+        frames.insert(frames.end(), frame.cbegin(), frame.cend());
+    }
+    const auto done = frame_of(proto::ListEntitiesDoneResponse{});
+    frames.insert(frames.end(), done.cbegin(), done.cend());
+    return frames;
+}
+
+std::vector<std::byte> state_frames(std::size_t count)
+{
+    const auto light_frame = frame_of(make_light_state());
+    const auto sensor_frame = frame_of(make_sensor_state());
+    std::vector<std::byte> frames;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const auto &frame = (i % 2 == 0) ? light_frame : sensor_frame;
+        frames.insert(frames.end(), frame.cbegin(), frame.cend());
+    }
+    return frames;
+}
+} // namespace cppesphomeapi::testing
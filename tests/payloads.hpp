@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <span>
+#include "api.pb.h"
+#include "plain_text_protocol.hpp"
+
+namespace cppesphomeapi::testing
+{
+// payloads as sent by a typical ESPHome device.
+proto::LightStateResponse make_light_state();
+proto::SensorStateResponse make_sensor_state();
+proto::ListEntitiesLightResponse make_light_entity();
+proto::ListEntitiesSensorResponse make_sensor_entity();
+proto::SubscribeLogsResponse make_log();
+
+// the serialized frame of the message.
+std::vector<std::byte> frame_of(const google::protobuf::Message &message);
+// the serialized message without a frame header.
+std::vector<std::byte> payload_of(const google::protobuf::Message &message);
+// the frame of bytes that hold exactly one serialized frame.
+Frame single_frame(std::span<const std::byte> frame_bytes);
+// an entity list of a device with the given number of lights and sensors, terminated by ListEntitiesDoneResponse.
+std::vector<std::byte> entity_list_frames(std::size_t lights, std::size_t sensors);
+// count frames of mixed light and sensor states.
+std::vector<std::byte> state_frames(std::size_t count);
+} // namespace cppesphomeapi::testing
@@ -0,0 +1,62 @@
+#include <cstdint>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include "payloads.hpp"
+#include "plain_text_protocol.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+namespace
+{
+// the header of a plain text frame of message type 1 with the payload size.
+std::vector<std::byte> frame_header(std::uint64_t payload_size)
+{
+    std::vector<std::byte> header{std::byte{0x00}};
+    while (payload_size >= 0x80U)
+    {
+        header.push_back(static_cast<std::byte>((payload_size & 0x7FU) | 0x80U));
+        payload_size >>= 7U;
+    }
+    header.push_back(static_cast<std::byte>(payload_size));
+    header.push_back(std::byte{0x01});
+    return header;
+}
+} // namespace
+
+TEST_CASE("PlainTextProtocol rejects frames above the maximum size", "[protocol]")
+{
+    // the payload size of the largest frame takes three varint bytes, so its header has five bytes.
+    constexpr std::size_t kLargestPayload = PlainTextProtocol::kMaxFrameSize - 5;
+
+    const auto largest = PlainTextProtocol::read_frame_header(frame_header(kLargestPayload));
+    REQUIRE(largest.has_value());
+    REQUIRE(largest->has_value());
+    CHECK(largest->value().frame_size() == PlainTextProtocol::kMaxFrameSize);
+
+    CHECK_FALSE(PlainTextProtocol::read_frame_header(frame_header(kLargestPayload + 1)).has_value());
+    CHECK_FALSE(PlainTextProtocol::read_frame_header(frame_header(0xFFFFFFFFU)).has_value());
+}
+
+TEST_CASE("PlainTextProtocol frames a message the same with the generated id and its descriptor", "[protocol]")
+{
+    const auto light_state = make_light_state();
+    std::vector<std::byte> by_traits;
+    std::vector<std::byte> by_descriptor;
+    REQUIRE(PlainTextProtocol::serialize_to(light_state, by_traits).has_value());
+    REQUIRE(PlainTextProtocol::serialize_to(static_cast<const google::protobuf::Message &>(light_state), by_descriptor)
+                .has_value());
+    CHECK(by_traits == by_descriptor);
+
+    const auto header = PlainTextProtocol::read_frame_header(by_traits);
+    REQUIRE(header.has_value());
+    REQUIRE(header->has_value());
+    CHECK(header->value().message_type == detail::get_message_id<proto::LightStateResponse>());
+    CHECK(header->value().frame_size() == by_traits.size());
+
+    // a message without an id can not be framed.
+    const proto::VoiceAssistantAudioSettings settings;
+    std::vector<std::byte> buffer;
+    CHECK_FALSE(PlainTextProtocol::serialize_to(settings, buffer).has_value());
+    CHECK(buffer.empty());
+}
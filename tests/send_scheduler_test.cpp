@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include "send_scheduler.hpp"
+
+using namespace cppesphomeapi;
+using namespace std::chrono_literals;
+
+namespace
+{
+// the packets are told apart by their size.
+struct Packets
+{
+    std::array<std::byte, 64> bytes{};
+
+    [[nodiscard]] std::span<const std::byte> of_size(std::size_t size) const
+    {
+        return std::span{bytes}.first(size);
+    }
+};
+
+std::uint64_t push(SendScheduler &scheduler, SendPriority priority, std::span<const std::byte> packet)
+{
+    return scheduler.push(priority, packet, [](Result<void> /*result*/) {});
+}
+
+std::vector<std::size_t> pop_all(SendScheduler &scheduler)
+{
+    std::vector<std::size_t> sizes;
+    while (auto pending = scheduler.pop())
+    {
+        sizes.emplace_back(pending->packet.size());
+    }
+    return sizes;
+}
+
+SendLaneMetrics lane_metrics(const SendScheduler &scheduler, SendPriority priority)
+{
+    return scheduler.metrics()[std::to_underlying(priority)];
+}
+} // namespace
+
+TEST_CASE("SendScheduler pops control before interactive before bulk packets", "[send]")
+{
+    const Packets packets;
+    SendScheduler scheduler;
+    push(scheduler, SendPriority::Bulk, packets.of_size(1));
+    push(scheduler, SendPriority::Interactive, packets.of_size(2));
+    push(scheduler, SendPriority::Bulk, packets.of_size(3));
+    push(scheduler, SendPriority::Control, packets.of_size(4));
+    push(scheduler, SendPriority::Interactive, packets.of_size(5));
+    push(scheduler, SendPriority::Control, packets.of_size(6));
+
+    // the packets of a class keep their order.
+    CHECK(pop_all(scheduler) == std::vector<std::size_t>{4, 6, 2, 5, 1, 3});
+    CHECK(scheduler.empty());
+}
+
+TEST_CASE("SendScheduler records the queue depth and wait time per class", "[send]")
+{
+    const Packets packets;
+    SendScheduler scheduler;
+    push(scheduler, SendPriority::Bulk, packets.of_size(10));
+    push(scheduler, SendPriority::Bulk, packets.of_size(20));
+    push(scheduler, SendPriority::Control, packets.of_size(30));
+
+    CHECK(lane_metrics(scheduler, SendPriority::Control).queue_depth == 1);
+    CHECK(lane_metrics(scheduler, SendPriority::Interactive).queue_depth == 0);
+    CHECK(lane_metrics(scheduler, SendPriority::Bulk).queue_depth == 2);
+    CHECK(lane_metrics(scheduler, SendPriority::Bulk).max_queue_depth == 2);
+
+    std::this_thread::sleep_for(1ms);
+    REQUIRE(scheduler.pop().has_value());
+    const auto control = lane_metrics(scheduler, SendPriority::Control);
+    CHECK(control.queue_depth == 0);
+    CHECK(control.packets == 1);
+    CHECK(control.bytes == 30);
+    CHECK(control.total_wait >= 1ms);
+    CHECK(control.max_wait == control.total_wait);
+    // the bulk packets are still waiting.
+    CHECK(lane_metrics(scheduler, SendPriority::Bulk).packets == 0);
+
+    std::this_thread::sleep_for(1ms);
+    CHECK(pop_all(scheduler) == std::vector<std::size_t>{10, 20});
+    const auto bulk = lane_metrics(scheduler, SendPriority::Bulk);
+    CHECK(bulk.queue_depth == 0);
+    CHECK(bulk.max_queue_depth == 2);
+    CHECK(bulk.packets == 2);
+    CHECK(bulk.bytes == 30);
+    CHECK(bulk.total_wait >= 4ms);
+    CHECK(bulk.max_wait >= 2ms);
+    CHECK(bulk.max_wait <= bulk.total_wait);
+    CHECK(lane_metrics(scheduler, SendPriority::Interactive).packets == 0);
+}
+
+TEST_CASE("SendScheduler removes a queued packet", "[send]")
+{
+    const Packets packets;
+    SendScheduler scheduler;
+    push(scheduler, SendPriority::Interactive, packets.of_size(1));
+    const auto removed_id = push(scheduler, SendPriority::Interactive, packets.of_size(2));
+    push(scheduler, SendPriority::Interactive, packets.of_size(3));
+
+    const auto removed = scheduler.remove(removed_id);
+    REQUIRE(removed.has_value());
+    CHECK(removed->packet.size() == 2);
+    CHECK(lane_metrics(scheduler, SendPriority::Interactive).queue_depth == 2);
+    CHECK_FALSE(scheduler.remove(removed_id).has_value());
+    CHECK(pop_all(scheduler) == std::vector<std::size_t>{1, 3});
+    // a removed packet is not counted as written.
+    CHECK(lane_metrics(scheduler, SendPriority::Interactive).packets == 2);
+}
+
+TEST_CASE("SendScheduler keeps the order of a lane that never runs empty", "[send]")
+{
+    const Packets packets;
+    SendScheduler scheduler;
+    std::vector<std::size_t> popped;
+    std::size_t next_size{1};
+    // the lane is refilled before it runs empty, so its popped sends are dropped while packets are still queued.
+    for (std::size_t round = 0; round < 100; round++)
+    {
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            push(scheduler, SendPriority::Bulk, packets.of_size(next_size));
+            next_size = next_size % packets.bytes.size() + 1;
+        }
+        for (std::size_t i = 0; i < 2; i++)
+        {
+            popped.emplace_back(scheduler.pop()->packet.size());
+        }
+    }
+    std::ranges::copy(pop_all(scheduler), std::back_inserter(popped));
+
+    REQUIRE(popped.size() == 300);
+    for (std::size_t i = 0; i < popped.size(); i++)
+    {
+        CHECK(popped[i] == i % packets.bytes.size() + 1);
+    }
+    CHECK(lane_metrics(scheduler, SendPriority::Bulk).max_queue_depth == 102);
+}
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <catch2/catch_test_macros.hpp>
+#include "payloads.hpp"
+#include "state_conversion.hpp"
+#include "state_decoder.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+namespace
+{
+// floats are compared bitwise, so a NaN decoded by both sides counts as equal.
+bool same(float lhs, float rhs)
+{
+    return std::bit_cast<std::uint32_t>(lhs) == std::bit_cast<std::uint32_t>(rhs);
+}
+
+bool same(const LightState &lhs, const LightState &rhs)
+{
+    return lhs.key == rhs.key and lhs.state == rhs.state and same(lhs.brightness, rhs.brightness) and
+           lhs.color_mode == rhs.color_mode and same(lhs.color_brightness, rhs.color_brightness) and
+           same(lhs.red, rhs.red) and same(lhs.green, rhs.green) and same(lhs.blue, rhs.blue) and
+           same(lhs.white, rhs.white) and same(lhs.color_temperature, rhs.color_temperature) and
+           same(lhs.cold_white, rhs.cold_white) and same(lhs.warm_white, rhs.warm_white) and lhs.effect == rhs.effect;
+}
+
+bool same(const SensorState &lhs, const SensorState &rhs)
+{
+    return lhs.key == rhs.key and same(lhs.state, rhs.state) and lhs.missing_state == rhs.missing_state;
+}
+
+bool same(const BinarySensorState &lhs, const BinarySensorState &rhs)
+{
+    return lhs.key == rhs.key and lhs.state == rhs.state and lhs.missing_state == rhs.missing_state;
+}
+
+bool same(const SwitchState &lhs, const SwitchState &rhs)
+{
+    return lhs.key == rhs.key and lhs.state == rhs.state;
+}
+
+bool same(const TextSensorStateView &lhs, const TextSensorState &rhs)
+{
+    return lhs.key == rhs.key and lhs.state == rhs.state and lhs.missing_state == rhs.missing_state;
+}
+
+bool same(const LogEntryView &lhs, const LogEntryView &rhs)
+{
+    return lhs.log_level == rhs.log_level and lhs.message == rhs.message and lhs.send_failed == rhs.send_failed;
+}
+
+bool same(const VoiceAssistantAudioView &lhs, const VoiceAssistantAudioView &rhs)
+{
+    return std::ranges::equal(lhs.data, rhs.data) and lhs.end == rhs.end;
+}
+
+class StateFuzzer
+{
+  public:
+    explicit StateFuzzer(std::uint32_t seed)
+        : random_{seed}
+    {}
+
+    proto::LightStateResponse light_state()
+    {
+        proto::LightStateResponse state;
+        state.set_key(next());
+        state.set_state(chance(2));
+        state.set_brightness(any_float());
+        state.set_color_mode(static_cast<proto::ColorMode>(chance(8) ? next() % 1000 : next() % 128));
+        state.set_color_brightness(any_float());
+        state.set_red(any_float());
+        state.set_green(any_float());
+        state.set_blue(any_float());
+        state.set_white(any_float());
+        state.set_color_temperature(any_float());
+        state.set_cold_white(any_float());
+        state.set_warm_white(any_float());
+        state.set_effect(any_string());
+        return state;
+    }
+
+    proto::SensorStateResponse sensor_state()
+    {
+        proto::SensorStateResponse state;
+        state.set_key(next());
+        state.set_state(any_float());
+        state.set_missing_state(chance(4));
+        return state;
+    }
+
+    proto::BinarySensorStateResponse binary_sensor_state()
+    {
+        proto::BinarySensorStateResponse state;
+        state.set_key(next());
+        state.set_state(chance(2));
+        state.set_missing_state(chance(4));
+        return state;
+    }
+
+    proto::SwitchStateResponse switch_state()
+    {
+        proto::SwitchStateResponse state;
+        state.set_key(next());
+        state.set_state(chance(2));
+        return state;
+    }
+
+    proto::TextSensorStateResponse text_sensor_state()
+    {
+        proto::TextSensorStateResponse state;
+        state.set_key(next());
+        state.set_state(any_string());
+        state.set_missing_state(chance(4));
+        return state;
+    }
+
+    proto::SubscribeLogsResponse log()
+    {
+        proto::SubscribeLogsResponse log;
+        log.set_level(static_cast<proto::LogLevel>(next() % 8));
+        log.set_message(any_string());
+        log.set_send_failed(chance(8));
+        return log;
+    }
+
+    proto::VoiceAssistantAudio voice_assistant_audio()
+    {
+        proto::VoiceAssistantAudio audio;
+        std::string data(next() % 64, '\0');
+        std::ranges::generate(data, [this]() { return static_cast<char>(next()); });
+        audio.set_data(std::move(data));
+        audio.set_end(chance(8));
+        return audio;
+    }
+
+    // appends fields as another schema version or a broken sender could write them.
+    void append_noise(std::vector<std::byte> &payload)
+    {
+        const auto fields = next() % 4;
+        for (std::uint32_t i = 0; i < fields; i++)
+        {
+            // known and unknown field numbers with any wire type, including groups and invalid ones.
+            const auto number = chance(8) ? next() % 100000 : next() % 16;
+            const auto wire_type = next() % 8;
+            append_varint(payload, (std::uint64_t{number} << 3U) | wire_type);
+            switch (wire_type)
+            {
+            case 0:
+                append_varint(payload, chance(4) ? std::uint64_t{next()} << 32U | next() : next() % 4);
+                break;
+            case 1:
+                append_random(payload, 8);
+                break;
+            case 2: {
+                const auto length = next() % 12;
+                append_varint(payload, length);
+                append_random(payload, length);
+                break;
+            }
+            case 5:
+                append_random(payload, 4);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // flips bits, truncates or overwrites bytes.
+    void mutate(std::vector<std::byte> &payload)
+    {
+        if (payload.empty())
+        {
+            return;
+        }
+        switch (next() % 3)
+        {
+        case 0:
+            payload[next() % payload.size()] ^= static_cast<std::byte>(1U << (next() % 8));
+            break;
+        case 1:
+            payload.resize(next() % payload.size());
+            break;
+        default:
+            payload[next() % payload.size()] = static_cast<std::byte>(next());
+            break;
+        }
+    }
+
+    bool chance(std::uint32_t one_in)
+    {
+        return next() % one_in == 0;
+    }
+
+  private:
+    std::uint32_t next()
+    {
+        return static_cast<std::uint32_t>(random_());
+    }
+
+    float any_float()
+    {
+        // mostly plain values, sometimes any bit pattern including NaN and infinity.
+        return chance(4) ? std::bit_cast<float>(next()) : static_cast<float>(next() % 1000) / 1000.0F;
+    }
+
+    // mostly ASCII with some two, three and four byte UTF-8 sequences.
+    std::string any_string()
+    {
+        static constexpr std::array<std::string_view, 4> kMultiByte{"°", "ä", "€", "😀"};
+        std::string value;
+        const auto length = next() % 24;
+        for (std::uint32_t i = 0; i < length; i++)
+        {
+            if (chance(6))
+            {
+                value += kMultiByte[next() % kMultiByte.size()];
+            }
+            else
+            {
+                value += static_cast<char>(0x20 + next() % 0x5F);
+            }
+        }
+        return value;
+    }
+
+    void append_varint(std::vector<std::byte> &payload, std::uint64_t value)
+    {
+        while (value >= 0x80U)
+        {
+            payload.push_back(static_cast<std::byte>((value & 0x7FU) | 0x80U));
+            value >>= 7U;
+        }
+        payload.push_back(static_cast<std::byte>(value));
+    }
+
+    void append_random(std::vector<std::byte> &payload, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            payload.push_back(static_cast<std::byte>(next()));
+        }
+    }
+
+  private:
+    std::mt19937 random_;
+};
+
+// the message decoded by protobuf, in the form the fast decoder returns.
+template <typename TMsg>
+auto decoded_by_protobuf(const TMsg &message)
+{
+    return pb2state(message);
+}
+
+LogEntryView decoded_by_protobuf(const proto::SubscribeLogsResponse &message)
+{
+    return LogEntryView{
+        .log_level = EspHomeLogLevel{std::to_underlying(message.level())},
+        .message = message.message(),
+        .send_failed = message.send_failed(),
+        .frame = {},
+    };
+}
+
+VoiceAssistantAudioView decoded_by_protobuf(const proto::VoiceAssistantAudio &message)
+{
+    return VoiceAssistantAudioView{
+        .data = std::as_bytes(std::span{message.data()}),
+        .end = message.end(),
+    };
+}
+
+struct DifferentialResult
+{
+    std::size_t decoded{};
+    std::size_t left_to_protobuf{};
+};
+
+// the fast decoder must either give up or decode exactly what protobuf decodes.
+template <typename TMsg>
+DifferentialResult compare_with_protobuf(StateFuzzer &fuzzer, auto &&make_message, auto &&fast_decode)
+{
+    static constexpr std::size_t kInputs = 20000;
+    DifferentialResult result;
+    for (std::size_t i = 0; i < kInputs; i++)
+    {
+        const TMsg original = make_message();
+        auto payload = payload_of(original);
+        const bool untouched = fuzzer.chance(2);
+        if (not untouched)
+        {
+            fuzzer.append_noise(payload);
+            if (fuzzer.chance(2))
+            {
+                fuzzer.mutate(payload);
+            }
+        }
+
+        TMsg message;
+        const bool parsed = message.ParseFromArray(payload.data(), static_cast<int>(payload.size()));
+        const auto decoded = fast_decode(std::span<const std::byte>{payload});
+        if (decoded.has_value())
+        {
+            REQUIRE(parsed);
+            REQUIRE(same(decoded.value(), decoded_by_protobuf(message)));
+            result.decoded++;
+        }
+        else
+        {
+            // protobuf writes valid encodings only, they have to take the fast path.
+            REQUIRE_FALSE(untouched);
+            result.left_to_protobuf++;
+        }
+    }
+    return result;
+}
+} // namespace
+
+TEST_CASE("state decoders against protobuf on fuzzed payloads", "[differential]")
+{
+    StateFuzzer fuzzer{20240917};
+
+    const auto light = compare_with_protobuf<proto::LightStateResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.light_state(); }, decode_light_state);
+    const auto sensor = compare_with_protobuf<proto::SensorStateResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.sensor_state(); }, decode_sensor_state);
+    const auto binary_sensor = compare_with_protobuf<proto::BinarySensorStateResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.binary_sensor_state(); }, decode_binary_sensor_state);
+    const auto switch_state = compare_with_protobuf<proto::SwitchStateResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.switch_state(); }, decode_switch_state);
+    const auto text_sensor = compare_with_protobuf<proto::TextSensorStateResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.text_sensor_state(); }, decode_text_sensor_state);
+    const auto log = compare_with_protobuf<proto::SubscribeLogsResponse>(
+        fuzzer, [&fuzzer]() { return fuzzer.log(); }, decode_log_entry);
+    const auto voice_assistant_audio = compare_with_protobuf<proto::VoiceAssistantAudio>(
+        fuzzer, [&fuzzer]() { return fuzzer.voice_assistant_audio(); }, decode_voice_assistant_audio);
+
+    for (const auto &[name, result] : {std::pair{"light", light},
+                                       std::pair{"sensor", sensor},
+                                       std::pair{"binary sensor", binary_sensor},
+                                       std::pair{"switch", switch_state},
+                                       std::pair{"text sensor", text_sensor},
+                                       std::pair{"log", log},
+                                       std::pair{"voice audio", voice_assistant_audio}})
+    {
+        INFO(name);
+        // the fuzzed inputs have to reach both paths.
+        CHECK(result.decoded > 0);
+        CHECK(result.left_to_protobuf > 0);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <print>
+#include <string_view>
+#include "counting_allocator.hpp"
+
+namespace cppesphomeapi::testing
+{
+struct Throughput
+{
+    double messages_per_second{};
+    double bytes_per_second{};
+    double allocations_per_message{};
+};
+
+// runs the operation repeatedly and prints messages/s, bytes/s and allocations per message.
+template <typename TOperation>
+Throughput measure_throughput(std::string_view name,
+                              std::size_t iterations,
+                              std::size_t messages_per_iteration,
+                              std::size_t bytes_per_iteration,
+                              TOperation &&operation)
+{
+    // warm up caches and pools before counting.
+    operation();
+
+    const AllocationCounter allocations;
+    const auto started = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        operation();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+    const auto messages = static_cast<double>(iterations * messages_per_iteration);
+    const Throughput throughput{
+        .messages_per_second = messages / elapsed.count(),
+        .bytes_per_second = static_cast<double>(iterations * bytes_per_iteration) / elapsed.count(),
+        .allocations_per_message = static_cast<double>(allocations.allocations()) / messages,
+    };
+    std::println("{:<40} {:>14.0f} msg/s {:>10.2f} MiB/s {:>8.2f} allocs/msg",
+                 name,
+                 throughput.messages_per_second,
+                 throughput.bytes_per_second / (1024.0 * 1024.0),
+                 throughput.allocations_per_message);
+    return throughput;
+}
+} // namespace cppesphomeapi::testing
@@ -0,0 +1,66 @@
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "entity_conversion.hpp"
+#include "message_pool.hpp"
+#include "packet_buffer_pool.hpp"
+#include "payloads.hpp"
+#include "plain_text_protocol.hpp"
+#include "state_conversion.hpp"
+#include "throughput.hpp"
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+
+TEST_CASE("conversion throughput", "[throughput][conversion]")
+{
+    constexpr std::size_t kIterations = 100000;
+    const auto light_entity = make_light_entity();
+    const auto light_state = make_light_state();
+
+    measure_throughput("pb2entity_info light", kIterations, 1, light_entity.ByteSizeLong(), [&] {
+        (void)pb2entity_info(light_entity);
+    });
+    measure_throughput("pb2state light", kIterations, 1, light_state.ByteSizeLong(), [&] {
+        (void)pb2state(light_state);
+    });
+}
+
+TEST_CASE("PlainTextProtocol throughput", "[throughput][protocol]")
+{
+    constexpr std::size_t kIterations = 10000;
+    PlainTextProtocol protocol;
+    const auto light_state = make_light_state();
+    const auto light_state_size = frame_of(light_state).size();
+    const auto states = state_frames(64);
+    const auto entities = entity_list_frames(20, 40);
+    const auto ignore = [](MessageWrapper /*message*/) {};
+
+    measure_throughput("serialize light state", kIterations, 1, light_state_size, [&] {
+        (void)PlainTextProtocol::serialize(light_state);
+    });
+    const auto packet_pool = PacketBufferPool::create();
+    measure_throughput("serialize light state into a pooled buffer", kIterations, 1, light_state_size, [&] {
+        auto packet = packet_pool->acquire();
+        (void)PlainTextProtocol::serialize_to(light_state, packet.bytes());
+    });
+    measure_throughput("decode_multiple 64 state frames", kIterations, 64, states.size(), [&] {
+        (void)protocol.decode_multiple<proto::LightStateResponse, proto::SensorStateResponse>(states, ignore);
+    });
+    measure_throughput("decode_multiple 60 entities", kIterations / 10, 61, entities.size(), [&] {
+        (void)protocol.decode_multiple<proto::ListEntitiesDoneResponse,
+                                       proto::ListEntitiesLightResponse,
+                                       proto::ListEntitiesSensorResponse>(entities, ignore);
+    });
+
+    const auto pool = MessagePool::create();
+    const auto state_frame = frame_of(light_state);
+    const auto frame = single_frame(state_frame);
+    boost::asio::io_context io_context;
+    boost::asio::post(io_context, [&] {
+        measure_throughput("decode light state from the pool", kIterations, 1, state_frame.size(), [&] {
+            (void)PlainTextProtocol::decode<proto::LightStateResponse>(frame, *pool, ignore);
+        });
+    });
+    io_context.run();
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <optional>
+#include <print>
+#include <string_view>
+#include <boost/asio/awaitable.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cppesphomeapi/api_client.hpp>
+#include "fake_device.hpp"
+#include "rtt_estimator.hpp"
+#include "virtual_time_loop.hpp"
+
+namespace asio = boost::asio;
+
+using namespace cppesphomeapi;
+using namespace cppesphomeapi::testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+bool connect(VirtualTimeLoop &loop, ApiClient &client)
+{
+    bool connected{false};
+    loop.run([&]() -> asio::awaitable<void> { connected = (co_await client.async_connect()).has_value(); }());
+    return connected;
+}
+
+void print_real_time(std::string_view scenario,
+                     std::chrono::steady_clock::time_point started,
+                     Clock::duration virtual_time)
+{
+    std::println("{:<40} {:>8} virtual in {}",
+                 scenario,
+                 std::chrono::duration_cast<std::chrono::seconds>(virtual_time),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started));
+}
+} // namespace
+
+TEST_CASE("the heartbeat pings the device every 20 seconds", "[virtual-time]")
+{
+    const auto started = std::chrono::steady_clock::now();
+    VirtualTimeLoop loop;
+    FakeDevice device{loop.executor(), FakeDeviceConfig{}};
+    auto &client = loop.add_client(device.port());
+    REQUIRE(connect(loop, client));
+
+    loop.advance(19s);
+    CHECK(device.pings() == 0);
+    loop.advance(2s);
+    CHECK(device.pings() == 1);
+    loop.advance(40s);
+    CHECK(device.pings() == 3);
+    // the answered pings keep the receive watchdog from closing the connection.
+    loop.advance(60s);
+    CHECK(device.open_connections() == 1);
+    print_real_time("heartbeat", started, loop.elapsed());
+}
+
+TEST_CASE("a request to an unresponsive device fails after the adaptive timeout", "[virtual-time]")
+{
+    VirtualTimeLoop loop{1ms};
+    FakeDevice device{loop.executor(), FakeDeviceConfig{}};
+    auto &client = loop.add_client(device.port());
+    REQUIRE(connect(loop, client));
+    device.set_responsive(false);
+
+    std::optional<ApiErrorCode> error;
+    Clock::duration waited{};
+    REQUIRE(loop.run([&]() -> asio::awaitable<void> {
+        const auto sent_at = Clock::now();
+        const auto device_info = co_await client.async_device_info();
+        waited = Clock::now() - sent_at;
+        if (not device_info.has_value())
+        {
+            error = device_info.error().code;
+        }
+    }()));
+    // told apart from the deadline of the caller, the device did not answer in time.
+    CHECK(error == ApiErrorCode::ResponseTimeout);
+    // the loopback round trips of the handshake bring the timeout down to its lower bound.
+    CHECK(waited >= RttEstimator::kMinTimeout);
+    CHECK(waited < RttEstimator::kInitialTimeout);
+}
+
+TEST_CASE("an operation fails with DeadlineExceeded exactly at its deadline", "[virtual-time]")
+{
+    VirtualTimeLoop loop{1ms};
+    FakeDevice device{loop.executor(), FakeDeviceConfig{}};
+    auto &client = loop.add_client(device.port());
+    REQUIRE(connect(loop, client));
+
+    std::optional<ApiErrorCode> error;
+    Clock::duration waited{};
+    REQUIRE(loop.run([&]() -> asio::awaitable<void> {
+        const auto started = Clock::now();
+        // no state is ever streamed.
+        const auto state = co_await client.async_receive_state(started + 5s);
+        if (not state.has_value())
+        {
+            error = state.error().code;
+        }
+        waited = Clock::now() - started;
+    }()));
+    CHECK(error == ApiErrorCode::DeadlineExceeded);
+    CHECK(waited >= 5s);
+    CHECK(waited <= 5s + 1ms);
+}
+
+TEST_CASE("the receive watchdog closes a connection that stopped receiving", "[virtual-time]")
+{
+    const auto started = std::chrono::steady_clock::now();
+    VirtualTimeLoop loop;
+    FakeDevice device{loop.executor(), FakeDeviceConfig{}};
+    auto &client = loop.add_client(device.port());
+    REQUIRE(connect(loop, client));
+    device.set_responsive(false);
+
+    loop.advance(99s);
+    // the heartbeat keeps sending, but its pings are not answered anymore.
+    CHECK(device.pings() == 4);
+    CHECK(device.open_connections() == 1);
+    loop.advance(2s);
+    CHECK(device.open_connections() == 0);
+    print_real_time("receive watchdog", started, loop.elapsed());
+}
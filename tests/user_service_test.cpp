@@ -0,0 +1,156 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <cppesphomeapi/user_service.hpp>
+#include "service_conversion.hpp"
+
+using namespace cppesphomeapi;
+
+namespace
+{
+// a service with one argument of every known type, in the order of ServiceArgType.
+UserService service_of_every_type()
+{
+    return UserService{
+        .name = "every_type",
+        .key = 42,
+        .args =
+            {
+                UserServiceArg{.name = "bool", .type = ServiceArgType::Bool},
+                UserServiceArg{.name = "int", .type = ServiceArgType::Int},
+                UserServiceArg{.name = "float", .type = ServiceArgType::Float},
+                UserServiceArg{.name = "string", .type = ServiceArgType::String},
+                UserServiceArg{.name = "bool_array", .type = ServiceArgType::BoolArray},
+                UserServiceArg{.name = "int_array", .type = ServiceArgType::IntArray},
+                UserServiceArg{.name = "float_array", .type = ServiceArgType::FloatArray},
+                UserServiceArg{.name = "string_array", .type = ServiceArgType::StringArray},
+            },
+    };
+}
+
+std::vector<ServiceArgValue> args_of_every_type()
+{
+    return {
+        true,
+        std::int32_t{-7},
+        1.5F,
+        std::string{"text"},
+        std::vector<bool>{true, false, true},
+        std::vector<std::int32_t>{1, -2, 3},
+        std::vector<float>{0.25F, -0.5F},
+        std::vector<std::string>{"a", "b"},
+    };
+}
+} // namespace
+
+TEST_CASE("ServiceSchema::validate accepts arguments of the schema types", "[services]")
+{
+    const ServiceSchema schema{service_of_every_type()};
+    CHECK(schema.key() == 42);
+    CHECK(schema.name() == "every_type");
+    CHECK(schema.arg_types().size() == 8);
+    CHECK(schema.arg_index("float") == 2);
+    CHECK_FALSE(schema.arg_index("missing").has_value());
+
+    CHECK(schema.validate(args_of_every_type()).has_value());
+    // a service without arguments is called without any.
+    CHECK(ServiceSchema{UserService{.name = "no_args", .key = 1, .args = {}}}.validate({}).has_value());
+}
+
+TEST_CASE("ServiceSchema::validate rejects arguments that do not match the schema", "[services]")
+{
+    const ServiceSchema schema{service_of_every_type()};
+    const auto rejected = [&schema](const std::vector<ServiceArgValue> &args) {
+        const auto result = schema.validate(args);
+        return not result.has_value() and result.error().code == ApiErrorCode::InvalidArgument;
+    };
+
+    auto too_few = args_of_every_type();
+    too_few.pop_back();
+    CHECK(rejected(too_few));
+
+    auto too_many = args_of_every_type();
+    too_many.emplace_back(true);
+    CHECK(rejected(too_many));
+
+    for (std::size_t i = 0; i < 8; i++)
+    {
+        auto args = args_of_every_type();
+        // the next type in the list is always a different one.
+        args[i] = args_of_every_type()[(i + 1) % 8];
+        INFO(i);
+        CHECK(rejected(args));
+    }
+}
+
+TEST_CASE("ServiceSchema::validate rejects every argument of an unknown type", "[services]")
+{
+    const ServiceSchema schema{UserService{
+        .name = "newer_api",
+        .key = 2,
+        .args = {UserServiceArg{.name = "value", .type = ServiceArgType::Unknown}},
+    }};
+    // no value can match a type of a newer api version, whatever the caller passes.
+    for (auto &&arg : args_of_every_type())
+    {
+        const auto result = schema.validate(std::vector{arg});
+        REQUIRE_FALSE(result.has_value());
+        CHECK(result.error().code == ApiErrorCode::InvalidArgument);
+    }
+}
+
+TEST_CASE("service_call2pb writes every argument type", "[services]")
+{
+    const ServiceSchema schema{service_of_every_type()};
+    const auto args = args_of_every_type();
+    proto::ExecuteServiceRequest request;
+    service_call2pb(schema, args, false, request);
+
+    CHECK(request.key() == 42);
+    REQUIRE(request.args_size() == 8);
+    CHECK(request.args(0).bool_());
+    CHECK(request.args(1).int_() == -7);
+    CHECK(request.args(1).legacy_int() == 0);
+    CHECK(request.args(2).float_() == 1.5F);
+    CHECK(request.args(3).string_() == "text");
+    CHECK(std::vector<bool>(request.args(4).bool_array().begin(), request.args(4).bool_array().end()) ==
+          std::vector<bool>{true, false, true});
+    CHECK(std::vector<std::int32_t>(request.args(5).int_array().begin(), request.args(5).int_array().end()) ==
+          std::vector<std::int32_t>{1, -2, 3});
+    CHECK(std::vector<float>(request.args(6).float_array().begin(), request.args(6).float_array().end()) ==
+          std::vector<float>{0.25F, -0.5F});
+    CHECK(std::vector<std::string>(request.args(7).string_array().begin(), request.args(7).string_array().end()) ==
+          std::vector<std::string>{"a", "b"});
+}
+
+TEST_CASE("service_call2pb writes int arguments as legacy_int for devices before api 1.3", "[services]")
+{
+    const ServiceSchema schema{UserService{
+        .name = "ints",
+        .key = 3,
+        .args =
+            {
+                UserServiceArg{.name = "value", .type = ServiceArgType::Int},
+                UserServiceArg{.name = "values", .type = ServiceArgType::IntArray},
+            },
+    }};
+    const std::vector<ServiceArgValue> args{std::int32_t{-7}, std::vector<std::int32_t>{4, -5}};
+    proto::ExecuteServiceRequest request;
+    service_call2pb(schema, args, true, request);
+
+    REQUIRE(request.args_size() == 2);
+    CHECK(request.args(0).legacy_int() == -7);
+    CHECK(request.args(0).int_() == 0);
+    // only the single int had a legacy field, the arrays were added later.
+    CHECK(std::vector<std::int32_t>(request.args(1).int_array().begin(), request.args(1).int_array().end()) ==
+          std::vector<std::int32_t>{4, -5});
+
+    // a reused request is cleared by the caller, the arguments are appended.
+    request.Clear();
+    service_call2pb(schema, args, false, request);
+    REQUIRE(request.args_size() == 2);
+    CHECK(request.args(0).int_() == -7);
+    CHECK(request.args(0).legacy_int() == 0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <boost/asio/wait_traits.hpp>
+
+namespace cppesphomeapi::testing
+{
+/**
+ * The clock of the virtual time tests: the steady clock shifted by an offset that only VirtualTimeLoop advances.
+ * cppesphomeapi_virtual_time is the library built with this clock, see CPPESPHOMEAPI_CLOCK_HEADER.
+ */
+struct VirtualClock
+{
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    [[nodiscard]] static time_point now() noexcept
+    {
+        return std::chrono::steady_clock::now() + duration{offset().load(std::memory_order_relaxed)};
+    }
+
+    // while enabled, timers do not block until their expiry. Each run of the io_context checks them against now()
+    // instead, so they expire as soon as the clock was advanced past them.
+    static void enable(bool enabled) noexcept
+    {
+        enabled_flag().store(enabled, std::memory_order_relaxed);
+    }
+    [[nodiscard]] static bool enabled() noexcept
+    {
+        return enabled_flag().load(std::memory_order_relaxed);
+    }
+    // moves now() forward. Resetting moves it back to the steady clock, no timer may be pending then.
+    static void advance(duration step) noexcept
+    {
+        offset().fetch_add(step.count(), std::memory_order_relaxed);
+    }
+    static void reset() noexcept
+    {
+        offset().store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    static std::atomic<rep> &offset() noexcept
+    {
+        static std::atomic<rep> offset{0};
+        return offset;
+    }
+    static std::atomic<bool> &enabled_flag() noexcept
+    {
+        static std::atomic<bool> enabled{false};
+        return enabled;
+    }
+};
+} // namespace cppesphomeapi::testing
+
+namespace cppesphomeapi
+{
+using Clock = testing::VirtualClock;
+} // namespace cppesphomeapi
+
+// under virtual time the io_context must not sleep until the real expiry of a timer, the clock is advanced instead.
+template <>
+struct boost::asio::wait_traits<cppesphomeapi::testing::VirtualClock>
+{
+    using Clock = cppesphomeapi::testing::VirtualClock;
+
+    static Clock::duration to_wait_duration(const Clock::duration &duration)
+    {
+        return Clock::enabled() ? Clock::duration::zero() : duration;
+    }
+    static Clock::duration to_wait_duration(const Clock::time_point &expiry)
+    {
+        return to_wait_duration(expiry - Clock::now());
+    }
+};
@@ -0,0 +1,93 @@
+#include "virtual_time_loop.hpp"
+#include <algorithm>
+#include <exception>
+#include <type_traits>
+#include <boost/asio/co_spawn.hpp>
+#include "virtual_clock.hpp"
+
+namespace asio = boost::asio;
+
+namespace cppesphomeapi::testing
+{
+static_assert(std::is_same_v<Clock, VirtualClock>, "the virtual time tests must use cppesphomeapi_virtual_time");
+
+VirtualTimeLoop::VirtualTimeLoop(Clock::duration resolution)
+    : resolution_{resolution}
+{
+    VirtualClock::enable(true);
+    started_ = Clock::now();
+}
+
+VirtualTimeLoop::~VirtualTimeLoop()
+{
+    // the connections must not resume after the clock jumped back.
+    clients_.clear();
+    io_context_.stop();
+    VirtualClock::enable(false);
+    VirtualClock::reset();
+}
+
+asio::any_io_executor VirtualTimeLoop::executor()
+{
+    return io_context_.get_executor();
+}
+
+ApiClient &VirtualTimeLoop::add_client(std::uint16_t port, std::string password)
+{
+    return *clients_.emplace_back(
+        std::make_unique<ApiClient>(executor(), stop_source_, "127.0.0.1", port, std::move(password)));
+}
+
+Clock::duration VirtualTimeLoop::elapsed() const
+{
+    return Clock::now() - started_;
+}
+
+void VirtualTimeLoop::run_ready()
+{
+    if (io_context_.stopped())
+    {
+        io_context_.restart();
+    }
+    // a handler may complete a socket operation of the other end, which is only seen by the next poll.
+    while (io_context_.poll() > 0)
+    {
+    }
+}
+
+void VirtualTimeLoop::advance(Clock::duration duration)
+{
+    run_ready();
+    for (Clock::duration advanced{}; advanced < duration; advanced += resolution_)
+    {
+        VirtualClock::advance(std::min(resolution_, duration - advanced));
+        run_ready();
+    }
+}
+
+bool VirtualTimeLoop::run(asio::awaitable<void> operation, Clock::duration limit)
+{
+    struct Completion
+    {
+        bool completed{false};
+        std::exception_ptr failure;
+    };
+    // outlives this call if the operation did not complete within the limit.
+    auto completion = std::make_shared<Completion>();
+    asio::co_spawn(io_context_, std::move(operation), [completion](std::exception_ptr exception) {
+        completion->completed = true;
+        completion->failure = exception;
+    });
+    run_ready();
+    for (Clock::duration advanced{}; not completion->completed and advanced < limit; advanced += resolution_)
+    {
+        VirtualClock::advance(resolution_);
+        run_ready();
+    }
+    if (completion->failure)
+    {
+        std::rethrow_exception(completion->failure);
+    }
+    return completion->completed;
+}
+} // namespace cppesphomeapi::testing
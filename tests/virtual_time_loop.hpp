@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <vector>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <cppesphomeapi/api_client.hpp>
+#include <cppesphomeapi/clock.hpp>
+
+namespace cppesphomeapi::testing
+{
+/**
+ * Runs an io_context on the calling thread under virtual time: Clock::now() only moves when the loop advances it, and
+ * timers never sleep, so heartbeats, watchdogs and timeouts of minutes pass within milliseconds.
+ * The clock is advanced in steps of the resolution and all ready handlers run after each step, which keeps the order
+ * of timer expiries and loopback socket events the same on every run.
+ * Only one loop may exist at a time. Its destructor moves the clock back to the steady clock.
+ */
+class VirtualTimeLoop
+{
+  public:
+    explicit VirtualTimeLoop(Clock::duration resolution = std::chrono::milliseconds{10});
+    ~VirtualTimeLoop();
+
+    [[nodiscard]] boost::asio::any_io_executor executor();
+    ApiClient &add_client(std::uint16_t port, std::string password = "");
+    // virtual time passed since the loop was created.
+    [[nodiscard]] Clock::duration elapsed() const;
+
+    // runs the handlers that are ready without advancing the clock.
+    void run_ready();
+    // advances the clock by the duration and runs the handlers that become ready on the way.
+    void advance(Clock::duration duration);
+    // starts the coroutine and advances the clock until it completed. Returns false if it did not complete within the
+    // limit. An exception of the coroutine is rethrown.
+    bool run(boost::asio::awaitable<void> operation, Clock::duration limit = std::chrono::minutes{10});
+
+    VirtualTimeLoop(const VirtualTimeLoop &) = delete;
+    VirtualTimeLoop &operator=(const VirtualTimeLoop &) = delete;
+
+  private:
+    Clock::duration resolution_;
+    Clock::time_point started_;
+    std::stop_source stop_source_;
+    boost::asio::io_context io_context_;
+    std::vector<std::unique_ptr<ApiClient>> clients_;
+};
+} // namespace cppesphomeapi::testing